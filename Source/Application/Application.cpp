@@ -1,5 +1,6 @@
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
 #include "Application.h"
@@ -149,6 +150,7 @@ void Application::showFPS(GLFWwindow *pWindow)
 	if (delta >= 1.0) { // If last cout was more than 1 sec ago
 		double fps = double(nb_frames) / delta;
 		const char* mode = "No Cluste Shading";
+		char simdMode[64];
 		double cullTime = 0;
 		if (((VulkanRenderer*)renderer)->IsClusteShading())
 		{
@@ -160,13 +162,26 @@ void Application::showFPS(GLFWwindow *pWindow)
 			else
 			{
 				cullTime = ((VulkanRenderer*)renderer)->GetCpuCullTime();
-				if (!((VulkanRenderer*)renderer)->IsISPC())
+				if (((VulkanRenderer*)renderer)->IsISPC())
 				{
-					mode = "Raw C++ Culling";
+					mode = "ISPC Culling";
+				}
+				else if (((VulkanRenderer*)renderer)->IsSimdCull())
+				{
+					snprintf(simdMode, sizeof(simdMode), "SIMD(%s) C++ Culling", ClusteSimd::GetLevelName(((VulkanRenderer*)renderer)->GetSimdLevel()));
+					mode = simdMode;
+				}
+				else if (((VulkanRenderer*)renderer)->IsLightCentricCull())
+				{
+					mode = "Light-centric C++ Culling";
+				}
+				else if (((VulkanRenderer*)renderer)->IsMultiThreadCull())
+				{
+					mode = "Multi-thread C++ Culling";
 				}
 				else
 				{
-					mode = "ISPC Culling";
+					mode = "Raw C++ Culling";
 				}
 			}
 		}
@@ -179,6 +194,96 @@ void Application::showFPS(GLFWwindow *pWindow)
 				snprintf(title, 255, "[Vulkan][FPS: %3.2f] [ClusteShading: %s] [MeshShading: %s] [%s][Cull:%.4f(ms)]", fps, ((VulkanRenderer*)renderer)->IsClusteShading() ? "ON" : "OFF", ((VulkanRenderer*)renderer)->IsMeshShading() ? "ON" : "OFF", mode, cullTime);
 			else
 				snprintf(title, 255, "[Vulkan][FPS: %3.2f] [ClusteShading: %s] [MeshShading: %s] [%s]", fps, ((VulkanRenderer*)renderer)->IsClusteShading() ? "ON" : "OFF", ((VulkanRenderer*)renderer)->IsMeshShading() ? "ON" : "OFF", mode);
+
+			/// lights dropped by the per cluste cap
+			ClusteOverflow& overflow = ((VulkanRenderer*)renderer)->GetClusteOverflow();
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && overflow.lights > 0)
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Overflow: %u lights in %u clustes]", overflow.lights, overflow.clustes);
+			}
+
+			/// the gpu cull has a fixed per thread list
+			if (((VulkanRenderer*)renderer)->IsGpuLightCapClamped())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Gpu cap: %u of %u]", ((VulkanRenderer*)renderer)->GetGpuClusteLightCap(), ((VulkanRenderer*)renderer)->GetClusteLightCap());
+			}
+
+			/// grid picked by the auto tuner
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsAutoTuneGrid())
+			{
+				glm::uvec4 grid = ((VulkanRenderer*)renderer)->GetClusteGrid();
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Grid: %ux%ux%u]", grid.x, grid.y, grid.z);
+			}
+
+			/// clustes tested by the last cpu cull, stays at 0 while nothing moves
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsCpuClusteCull() && ((VulkanRenderer*)renderer)->IsIncrementalCull())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Recull: %d clustes]", ((VulkanRenderer*)renderer)->GetRecullClusteCount());
+			}
+
+			/// lights dropped by the frustum and depth bounds before the cpu cull
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsCpuClusteCull())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Rejected: %d lights%s]", ((VulkanRenderer*)renderer)->GetRejectedLightCount(), ((VulkanRenderer*)renderer)->IsDepthBoundsCull() ? ", depth" : "");
+			}
+
+			/// clustes holding geometry in the last frame, the only ones given lights
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsCpuClusteCull() && ((VulkanRenderer*)renderer)->IsActiveCull())
+			{
+				glm::uvec4 grid = ((VulkanRenderer*)renderer)->GetClusteGrid();
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Active: %d/%u clustes]", (int)((VulkanRenderer*)renderer)->GetActiveClustes().size(), grid.x * grid.y * grid.z);
+			}
+			else if (((VulkanRenderer*)renderer)->IsActiveCullIgnored())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Active: cpu culls only]");
+			}
+
+			/// 16-bit light indices and packed light grids
+			if (((VulkanRenderer*)renderer)->IsCompactLightList())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Compact lists]");
+			}
+
+			/// light bitmasks instead of light lists
+			if (((VulkanRenderer*)renderer)->IsBitmaskCull())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Bitmask: %u words]", ((VulkanRenderer*)renderer)->GetLightMaskWords());
+			}
+
+			/// part of the background cpu cull the submit still waited for
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsCpuClusteCull() && ((VulkanRenderer*)renderer)->IsAsyncCull())
+			{
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Cull wait: %.4f(ms)]", ((VulkanRenderer*)renderer)->GetCullWaitTime());
+			}
+
+			/// occupancy of the last culled frame
+			if (((VulkanRenderer*)renderer)->IsClusteShading() && ((VulkanRenderer*)renderer)->IsCullStats())
+			{
+				ClusteCullStats& stats = ((VulkanRenderer*)renderer)->GetCullStats();
+				size_t len = strlen(title);
+				snprintf(title + len, 255 - len, "[Lights/cluste avg %.1f p95 %u max %u, capped %u, %u KB]", stats.avgClusteLights, stats.p95ClusteLights, stats.maxClusteLights, stats.cappedClustes, stats.uploadBytes / 1024);
+			}
+
+			/// cpu cull compared with raw c++ culling
+			if (((VulkanRenderer*)renderer)->IsValidateCull() && ((VulkanRenderer*)renderer)->IsCpuClusteCull())
+			{
+				ClusteValidation& validation = ((VulkanRenderer*)renderer)->GetCullValidation();
+				size_t len = strlen(title);
+				if (validation.mismatchClustes == 0)
+					snprintf(title + len, 255 - len, "[Validate: OK, %u boundary lights]", validation.boundaryLights);
+				else
+					snprintf(title + len, 255 - len, "[Validate: %u clustes differ]", validation.mismatchClustes);
+			}
 		}
 		else
 		{
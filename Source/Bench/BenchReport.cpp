@@ -0,0 +1,93 @@
+#include <math.h>
+#include <algorithm>
+
+#include "BenchReport.h"
+
+BenchReport::BenchReport()
+{
+}
+
+BenchReport::~BenchReport()
+{
+}
+
+void BenchReport::ComputeTimes(std::vector<double>& frameMs, BenchResult& result)
+{
+	result.frameCount = (int)frameMs.size();
+	if (frameMs.empty())
+	{
+		result.minMs = result.medianMs = result.p99Ms = result.meanMs = 0;
+		return;
+	}
+
+	std::sort(frameMs.begin(), frameMs.end());
+	double sum = 0;
+	for (size_t i = 0; i < frameMs.size(); i++)
+		sum += frameMs[i];
+
+	/// nearest rank
+	size_t p99Idx = (size_t)ceil(frameMs.size() * 0.99) - 1;
+	result.minMs = frameMs[0];
+	result.medianMs = frameMs[frameMs.size() / 2];
+	result.p99Ms = frameMs[std::min(p99Idx, frameMs.size() - 1)];
+	result.meanMs = sum / frameMs.size();
+}
+
+int BenchReport::GetHistogramBucket(glm::uint lightCount)
+{
+	int bucket = 0;
+	while (lightCount > 0 && bucket < BENCH_HISTOGRAM_BUCKETS - 1)
+	{
+		lightCount >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void BenchReport::AddHistogram(LightGrid* lightGrids, int clusteCount, BenchResult& result)
+{
+	for (int i = 0; i < clusteCount; i++)
+	{
+		glm::uint count = lightGrids[i].count;
+		result.histogram[GetHistogramBucket(count)]++;
+		result.maxClusteLights = std::max(result.maxClusteLights, count);
+	}
+}
+
+void BenchReport::WriteCsv(FILE* file)
+{
+	fprintf(file, "backend,distribution,camera,lights,spots,tile_size,z_slices,clustes,frames,min_ms,median_ms,p99_ms,mean_ms,avg_indices,avg_view_lights,max_cluste_lights,overflow_lights,mismatch_clustes,boundary_lights");
+	for (int i = 0; i < BENCH_HISTOGRAM_BUCKETS; i++)
+		fprintf(file, ",hist_%d", i);
+	fprintf(file, "\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		BenchResult& r = results[i];
+		fprintf(file, "%s,%s,%s,%d,%.2f,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%u,%u,%u,%u", r.backend.c_str(), r.distribution.c_str(), r.camera.c_str(),
+			r.lightCount, r.spotRatio, r.tileSize, r.zSlices, r.clusteCount, r.frameCount, r.minMs, r.medianMs, r.p99Ms, r.meanMs, r.avgIndexCount, r.avgViewLights, r.maxClusteLights, r.overflowLights,
+			r.mismatchClustes, r.boundaryLights);
+		for (int j = 0; j < BENCH_HISTOGRAM_BUCKETS; j++)
+			fprintf(file, ",%llu", r.histogram[j]);
+		fprintf(file, "\n");
+	}
+}
+
+void BenchReport::WriteJson(FILE* file)
+{
+	fprintf(file, "[\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		BenchResult& r = results[i];
+		fprintf(file, "\t{\"backend\": \"%s\", \"distribution\": \"%s\", \"camera\": \"%s\", \"lights\": %d, \"spots\": %.2f, \"tile_size\": %d, \"z_slices\": %d, \"clustes\": %d, \"frames\": %d,\n",
+			r.backend.c_str(), r.distribution.c_str(), r.camera.c_str(), r.lightCount, r.spotRatio, r.tileSize, r.zSlices, r.clusteCount, r.frameCount);
+		fprintf(file, "\t\"min_ms\": %.4f, \"median_ms\": %.4f, \"p99_ms\": %.4f, \"mean_ms\": %.4f, \"avg_indices\": %.1f, \"avg_view_lights\": %.1f, \"max_cluste_lights\": %u, \"overflow_lights\": %u,\n",
+			r.minMs, r.medianMs, r.p99Ms, r.meanMs, r.avgIndexCount, r.avgViewLights, r.maxClusteLights, r.overflowLights);
+		fprintf(file, "\t\"mismatch_clustes\": %u, \"boundary_lights\": %u,\n", r.mismatchClustes, r.boundaryLights);
+		fprintf(file, "\t\"histogram\": [");
+		for (int j = 0; j < BENCH_HISTOGRAM_BUCKETS; j++)
+			fprintf(file, j == 0 ? "%llu" : ", %llu", r.histogram[j]);
+		fprintf(file, "]}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "]\n");
+}
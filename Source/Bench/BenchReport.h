@@ -0,0 +1,62 @@
+#ifndef __BENCH_REPORT_H__
+#define __BENCH_REPORT_H__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Renderer/ClusteData.h"
+
+/// lights per cluste histogram, bucket 0 is empty clusters, bucket i holds 2^(i-1) to 2^i - 1 lights
+#define BENCH_HISTOGRAM_BUCKETS 10
+
+/// one back end on one workload
+struct BenchResult
+{
+	std::string backend;
+	std::string distribution;
+	std::string camera;
+	int lightCount;
+	float spotRatio;	/// spots= of the run
+	int tileSize;
+	int zSlices;
+	int clusteCount;
+	int frameCount;
+
+	double minMs;
+	double medianMs;
+	double p99Ms;
+	double meanMs;
+
+	double avgIndexCount;	/// written light indices per frame
+	double avgViewLights;	/// lights left after the frustum rejection per frame
+	glm::uint maxClusteLights;
+	glm::uint overflowLights;	/// summed over all frames
+	unsigned long long histogram[BENCH_HISTOGRAM_BUCKETS];	/// summed over all frames
+
+	/// against raw culling, summed over all frames, only with validate=1
+	glm::uint mismatchClustes;
+	glm::uint boundaryLights;
+};
+
+class BenchReport
+{
+public:
+	BenchReport();
+	virtual ~BenchReport();
+
+	/// sorts frameMs
+	static void ComputeTimes(std::vector<double>& frameMs, BenchResult& result);
+	static void AddHistogram(LightGrid* lightGrids, int clusteCount, BenchResult& result);
+	static int GetHistogramBucket(glm::uint lightCount);
+
+	void AddResult(const BenchResult& result) { results.push_back(result); }
+
+	void WriteCsv(FILE* file);
+	void WriteJson(FILE* file);
+
+private:
+	std::vector<BenchResult> results;
+};
+
+#endif // !__BENCH_REPORT_H__
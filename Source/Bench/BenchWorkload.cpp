@@ -0,0 +1,192 @@
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "BenchWorkload.h"
+#include "Renderer/ClusteCulling.h"
+
+static const char* DISTRIBUTION_NAMES[BenchWorkload::LightDistributionNum] = { "uniform", "clustered", "corridor" };
+static const char* CAMERA_PATH_NAMES[BenchWorkload::CameraPathNum] = { "orbit", "fly" };
+
+/// roughly the sponza bounds of the sample scene
+static const glm::vec3 SCENE_MIN = glm::vec3(-1500.0f, 0.0f, -700.0f);
+static const glm::vec3 SCENE_MAX = glm::vec3(1500.0f, 1200.0f, 700.0f);
+static const float PI = 3.14159265f;
+
+/// same as the sample scene camera
+static const float CAMERA_FOV = 45.0f;
+static const float CAMERA_NEAR = 0.1f;
+static const float CAMERA_FAR = 10000.0f;
+
+BenchWorkload::BenchWorkload(unsigned int seed, int width, int height)
+	:seed(seed)
+	,random_state(1)
+	,width(width)
+	,height(height)
+{
+	glm::mat4x4 clipMtx = glm::mat4(1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, -1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+	glm::mat4x4 proj = glm::perspective(glm::radians(CAMERA_FOV), (float)width / (float)height, CAMERA_NEAR, CAMERA_FAR);
+	inverse_projection = glm::inverse(clipMtx * proj);
+}
+
+BenchWorkload::~BenchWorkload()
+{
+}
+
+const char* BenchWorkload::GetDistributionName(LightDistribution dist)
+{
+	return DISTRIBUTION_NAMES[dist];
+}
+
+const char* BenchWorkload::GetCameraPathName(CameraPath path)
+{
+	return CAMERA_PATH_NAMES[path];
+}
+
+bool BenchWorkload::ParseDistribution(const char* name, LightDistribution& dist)
+{
+	for (int i = 0; i < LightDistributionNum; i++)
+	{
+		if (strcmp(name, DISTRIBUTION_NAMES[i]) == 0)
+		{
+			dist = (LightDistribution)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BenchWorkload::ParseCameraPath(const char* name, CameraPath& path)
+{
+	for (int i = 0; i < CameraPathNum; i++)
+	{
+		if (strcmp(name, CAMERA_PATH_NAMES[i]) == 0)
+		{
+			path = (CameraPath)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned int BenchWorkload::NextRandom()
+{
+	/// xorshift32
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+float BenchWorkload::RandomRange(float minValue, float maxValue)
+{
+	float t = (float)(NextRandom() >> 8) / 16777216.0f;
+	return minValue + (maxValue - minValue) * t;
+}
+
+glm::vec3 BenchWorkload::RandomInBox(const glm::vec3& minPoint, const glm::vec3& maxPoint)
+{
+	float x = RandomRange(minPoint.x, maxPoint.x);
+	float y = RandomRange(minPoint.y, maxPoint.y);
+	float z = RandomRange(minPoint.z, maxPoint.z);
+	return glm::vec3(x, y, z);
+}
+
+void BenchWorkload::GenerateLights(LightDistribution dist, int lightCount, float spotRatio, std::vector<PointLightData>& lights, std::vector<LightShapeData>& shapes)
+{
+	/// every run has its own stream, results do not depend on the run order
+	random_state = (seed * 2654435761u) ^ ((unsigned int)dist * 40503u + (unsigned int)lightCount * 97u);
+	if (random_state == 0)
+		random_state = 1;
+
+	/// the sample scene has 16 lights of radius 1000, keep the lit volume about the same as the count grows
+	float radius = 1000.0f / cbrtf(std::max(lightCount, 16) / 16.0f);
+	radius = std::max(radius, 60.0f);
+
+	std::vector<glm::vec3> centers;
+	if (dist == Clustered)
+	{
+		int centerNum = std::max(lightCount / 64, 1);
+		for (int i = 0; i < centerNum; i++)
+			centers.push_back(RandomInBox(SCENE_MIN, SCENE_MAX));
+	}
+
+	lights.resize(lightCount);
+	shapes.resize(lightCount);
+	for (int i = 0; i < lightCount; i++)
+	{
+		PointLightData& light = lights[i];
+		light = {};
+
+		if (dist == Uniform)
+		{
+			light.pos = RandomInBox(SCENE_MIN, SCENE_MAX);
+			light.radius = RandomRange(radius * 0.5f, radius * 1.5f);
+		}
+		else if (dist == Clustered)
+		{
+			/// sum of uniforms is close enough to a normal spread around the center
+			glm::vec3 center = centers[NextRandom() % centers.size()];
+			glm::vec3 offset = RandomInBox(glm::vec3(-100.0f), glm::vec3(100.0f)) + RandomInBox(glm::vec3(-100.0f), glm::vec3(100.0f)) + RandomInBox(glm::vec3(-100.0f), glm::vec3(100.0f));
+			light.pos = glm::clamp(center + offset, SCENE_MIN, SCENE_MAX);
+			light.radius = RandomRange(radius * 0.25f, radius * 0.75f);
+		}
+		else
+		{
+			/// two rows on both sides of the nave
+			float side = (NextRandom() & 1) ? 1.0f : -1.0f;
+			light.pos = glm::vec3(RandomRange(SCENE_MIN.x + 100.0f, SCENE_MAX.x - 100.0f), RandomRange(80.0f, 500.0f), side * 200.0f + RandomRange(-50.0f, 50.0f));
+			light.radius = RandomRange(radius * 0.5f, radius * 1.0f);
+		}
+
+		light.color = glm::vec3(1.0f, 1.0f, 1.0f);
+		light.enabled = 1;
+		light.ambient_intensity = 0.1f;
+		light.diffuse_intensity = 1.0f;
+		light.specular_intensity = 0.2f;
+		light.attenuation_constant = 1.0f;
+		light.attenuation_exp = 0.00001f;
+
+		/// no extra draws without spot lights, the point light sets stay the same
+		LightShapeData& shape = shapes[i];
+		shape = {};
+		shape.type = LightType_Point;
+		if (spotRatio > 0.0f && RandomRange(0.0f, 1.0f) < spotRatio)
+		{
+			float outerAngle = RandomRange(15.0f, 45.0f) * PI / 180.0f;
+			shape.type = LightType_Spot;
+			shape.direction = glm::normalize(RandomInBox(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, -0.2f, 1.0f)));
+			shape.spot_cos_outer = cosf(outerAngle);
+			shape.spot_cos_inner = cosf(outerAngle * 0.75f);
+		}
+		RawCpu::light_bounds(light, shape);
+	}
+}
+
+void BenchWorkload::GetCameraFrame(CameraPath path, int frameIdx, int frameCount, ScreenToView& screenToView)
+{
+	float t = frameCount > 1 ? (float)frameIdx / (float)frameCount : 0.0f;
+	glm::vec3 center = (SCENE_MIN + SCENE_MAX) * 0.5f;
+	glm::vec3 eye, target;
+	if (path == Orbit)
+	{
+		float angle = t * 2.0f * PI;
+		eye = center + glm::vec3(cosf(angle) * 1100.0f, -350.0f, sinf(angle) * 550.0f);
+		target = center - glm::vec3(0.0f, 300.0f, 0.0f);
+	}
+	else
+	{
+		float x = SCENE_MIN.x + 200.0f + (SCENE_MAX.x - SCENE_MIN.x - 400.0f) * t;
+		eye = glm::vec3(x, 180.0f + 40.0f * sinf(t * 4.0f * PI), 60.0f * sinf(t * 2.0f * PI));
+		target = eye + glm::vec3(100.0f, -5.0f, 20.0f * cosf(t * 2.0f * PI));
+	}
+
+	screenToView.inverseProjection = inverse_projection;
+	screenToView.viewMatrix = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+	screenToView.screenDimensions = glm::uvec2(width, height);
+	screenToView.zNear = CAMERA_NEAR;
+	screenToView.zFar = CAMERA_FAR;
+}
@@ -0,0 +1,56 @@
+#ifndef __BENCH_WORKLOAD_H__
+#define __BENCH_WORKLOAD_H__
+
+#include <vector>
+
+#include "Renderer/ClusteData.h"
+
+/// reproducible culling input, same seed gives the same lights and cameras on every machine
+class BenchWorkload
+{
+public:
+	enum LightDistribution
+	{
+		Uniform = 0,	/// whole scene box
+		Clustered = 1,	/// small groups around random centers
+		Corridor = 2,	/// rows along the nave
+		LightDistributionNum,
+	};
+
+	enum CameraPath
+	{
+		Orbit = 0,	/// circles the scene center, looking at it
+		FlyThrough = 1,	/// walks down the nave, looking ahead
+		CameraPathNum,
+	};
+
+	BenchWorkload(unsigned int seed, int width, int height);
+	virtual ~BenchWorkload();
+
+	static const char* GetDistributionName(LightDistribution dist);
+	static const char* GetCameraPathName(CameraPath path);
+	static bool ParseDistribution(const char* name, LightDistribution& dist);
+	static bool ParseCameraPath(const char* name, CameraPath& path);
+
+	/// lights of one run, regenerated from the seed so every back end gets the same set,
+	/// about spotRatio of them are spot lights pointing downwards
+	void GenerateLights(LightDistribution dist, int lightCount, float spotRatio, std::vector<PointLightData>& lights, std::vector<LightShapeData>& shapes);
+
+	/// camera of frame frameIdx on a path of frameCount frames, same projection as the sample scene camera
+	void GetCameraFrame(CameraPath path, int frameIdx, int frameCount, ScreenToView& screenToView);
+
+private:
+	/// own generator, std distributions differ between standard libraries
+	unsigned int NextRandom();
+	float RandomRange(float minValue, float maxValue);
+	glm::vec3 RandomInBox(const glm::vec3& minPoint, const glm::vec3& maxPoint);
+
+private:
+	unsigned int seed;
+	unsigned int random_state;
+	int width;
+	int height;
+	glm::mat4 inverse_projection;
+};
+
+#endif // !__BENCH_WORKLOAD_H__
@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Common/ThreadPool.h"
+#include "Renderer/ClusteData.h"
+#include "Renderer/ClusteCuller.h"
+#include "Renderer/ClusteCulling.h"
+#include "Renderer/ClusteValidator.h"
+#include "BenchWorkload.h"
+#include "BenchReport.h"
+#include "MeshBench.h"
+
+#define __ISPC_STRUCT_LightGrid__
+#include "Ispc/cluste_culling_ispc.h"
+
+/// headless culling benchmark, links the cpu culling code only, no window and no gpu
+/// usage: ClusteBench [backend=raw,mt,lightcentric,ispc,simd,bitmask] [dist=uniform,clustered,corridor] [camera=orbit,fly]
+///        [lights=16,256,1024,4096] [grid=80x24,...] [frames=120] [warmup=5] [seed=1] [width=1920] [height=1080]
+///        [cap=128] [format=csv|json] [out=file] [validate=1] [simd=scalar|sse2|avx2|avx512] [frustum=1] [compact=0] [spots=0] [cone=1]
+///        ClusteBench mesh=file.obj [rounds=5] [out=file]
+/// simd= caps the level of the simd and bitmask back ends, default is the best level of the cpu
+/// bitmask builds one bit per light for every cluste, for the report it is turned into capped lists outside the timing
+/// frustum=0 keeps the lights outside the camera frustum in the cull like before the pre-rejection
+/// spots=0.8 makes about 80% of the lights spot lights, cone=0 culls them with their radius sphere like a point light
+/// compact=1 makes the non-ispc back ends write 16-bit light indices and packed light grids, when the run fits the packed widths
+/// validate=1 diffs every back end against raw culling each frame, outside the timing, exit code 2 on a mismatch
+/// mesh= times loading the obj and the vertex deduplication of GeoData instead of culling, the best of rounds=
+
+enum BenchBackend
+{
+	Backend_Raw = 0,
+	Backend_MultiThread = 1,
+	Backend_LightCentric = 2,
+	Backend_ISPC = 3,
+	Backend_Simd = 4,
+	Backend_Bitmask = 5,
+	Backend_Num,
+};
+static const char* BACKEND_NAMES[Backend_Num] = { "raw", "mt", "lightcentric", "ispc", "simd", "bitmask" };
+static const char* SIMD_LEVEL_NAMES[] = { "scalar", "sse2", "avx2", "avx512" };
+
+struct BenchOptions
+{
+	std::vector<int> backends;
+	std::vector<int> distributions;
+	std::vector<int> cameras;
+	std::vector<int> lightCounts;
+	std::vector<glm::uvec2> grids;	/// tile size, z slices
+	int frames;
+	int warmup;
+	unsigned int seed;
+	int width;
+	int height;
+	glm::uint cap;
+	bool isJson;
+	const char* out;
+	bool isValidate;
+	ClusteSimd::Level simdLevel;
+	bool isFrustum;
+	bool isCompact;
+	float spotRatio;
+	bool isCone;
+	const char* mesh;
+	int rounds;
+};
+
+static std::vector<std::string> SplitList(const char* value)
+{
+	std::vector<std::string> items;
+	std::string item;
+	for (const char* c = value; ; c++)
+	{
+		if (*c == ',' || *c == '\0')
+		{
+			if (!item.empty())
+				items.push_back(item);
+			item.clear();
+			if (*c == '\0')
+				break;
+		}
+		else
+			item += *c;
+	}
+	return items;
+}
+
+static bool ParseBackends(const char* value, std::vector<int>& backends)
+{
+	backends.clear();
+	std::vector<std::string> items = SplitList(value);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		int idx = 0;
+		while (idx < Backend_Num && items[i] != BACKEND_NAMES[idx])
+			idx++;
+		if (idx == Backend_Num)
+			return false;
+		backends.push_back(idx);
+	}
+	return !backends.empty();
+}
+
+static bool ParseOptions(int argc, char* argv[], BenchOptions& options)
+{
+	options.backends = { Backend_Raw, Backend_MultiThread, Backend_LightCentric, Backend_ISPC, Backend_Simd, Backend_Bitmask };
+	options.distributions = { BenchWorkload::Uniform, BenchWorkload::Clustered, BenchWorkload::Corridor };
+	options.cameras = { BenchWorkload::Orbit };
+	options.lightCounts = { 16, 256, 1024, 4096 };
+	options.grids = { glm::uvec2(80, 24) };
+	options.frames = 120;
+	options.warmup = 5;
+	options.seed = 1;
+	options.width = 1920;
+	options.height = 1080;
+	options.cap = DEFAULT_CLUSTE_LIGHT_CAP;
+	options.isJson = false;
+	options.out = NULL;
+	options.isValidate = false;
+	options.simdLevel = ClusteSimd::GetBestLevel();
+	options.isFrustum = true;
+	options.isCompact = false;
+	options.spotRatio = 0.0f;
+	options.isCone = true;
+	options.mesh = NULL;
+	options.rounds = 5;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = strchr(argv[i], '=');
+		if (value == NULL)
+			return false;
+		std::string key(argv[i], value - argv[i]);
+		value++;
+
+		if (key == "backend")
+		{
+			if (!ParseBackends(value, options.backends))
+				return false;
+		}
+		else if (key == "dist" || key == "camera")
+		{
+			std::vector<int>& list = key == "dist" ? options.distributions : options.cameras;
+			list.clear();
+			std::vector<std::string> items = SplitList(value);
+			for (size_t j = 0; j < items.size(); j++)
+			{
+				BenchWorkload::LightDistribution dist;
+				BenchWorkload::CameraPath path;
+				if (key == "dist" && BenchWorkload::ParseDistribution(items[j].c_str(), dist))
+					list.push_back(dist);
+				else if (key == "camera" && BenchWorkload::ParseCameraPath(items[j].c_str(), path))
+					list.push_back(path);
+				else
+					return false;
+			}
+			if (list.empty())
+				return false;
+		}
+		else if (key == "lights")
+		{
+			options.lightCounts.clear();
+			std::vector<std::string> items = SplitList(value);
+			for (size_t j = 0; j < items.size(); j++)
+			{
+				int count = atoi(items[j].c_str());
+				if (count <= 0)
+					return false;
+				options.lightCounts.push_back(count);
+			}
+			if (options.lightCounts.empty())
+				return false;
+		}
+		else if (key == "grid")
+		{
+			options.grids.clear();
+			std::vector<std::string> items = SplitList(value);
+			for (size_t j = 0; j < items.size(); j++)
+			{
+				unsigned int tileSize = 0, zSlices = 0;
+				if (sscanf(items[j].c_str(), "%ux%u", &tileSize, &zSlices) != 2 || tileSize == 0 || zSlices == 0)
+					return false;
+				options.grids.push_back(glm::uvec2(tileSize, zSlices));
+			}
+			if (options.grids.empty())
+				return false;
+		}
+		else if (key == "frames")
+			options.frames = std::max(atoi(value), 1);
+		else if (key == "warmup")
+			options.warmup = std::max(atoi(value), 0);
+		else if (key == "seed")
+			options.seed = (unsigned int)strtoul(value, NULL, 10);
+		else if (key == "width")
+			options.width = std::max(atoi(value), 1);
+		else if (key == "height")
+			options.height = std::max(atoi(value), 1);
+		else if (key == "cap")
+			options.cap = (glm::uint)std::max(atoi(value), 1);
+		else if (key == "format")
+		{
+			if (strcmp(value, "json") == 0)
+				options.isJson = true;
+			else if (strcmp(value, "csv") == 0)
+				options.isJson = false;
+			else
+				return false;
+		}
+		else if (key == "out")
+			options.out = value;
+		else if (key == "validate")
+			options.isValidate = atoi(value) != 0;
+		else if (key == "frustum")
+			options.isFrustum = atoi(value) != 0;
+		else if (key == "compact")
+			options.isCompact = atoi(value) != 0;
+		else if (key == "spots")
+			options.spotRatio = std::min(std::max((float)atof(value), 0.0f), 1.0f);
+		else if (key == "cone")
+			options.isCone = atoi(value) != 0;
+		else if (key == "mesh")
+			options.mesh = value;
+		else if (key == "rounds")
+			options.rounds = std::max(atoi(value), 1);
+		else if (key == "simd")
+		{
+			int level = 0;
+			while (level <= ClusteSimd::AVX512 && strcmp(value, SIMD_LEVEL_NAMES[level]) != 0)
+				level++;
+			if (level > ClusteSimd::AVX512)
+				return false;
+			options.simdLevel = std::min((ClusteSimd::Level)level, ClusteSimd::GetBestLevel());
+		}
+		else
+			return false;
+	}
+	return true;
+}
+
+/// same per frame work as the cpu paths of VulkanRenderer::RenderBegin, aabb cache, view lights, then the cull
+static bool RunBench(BenchOptions& options, int backend, BenchWorkload& workload, BenchWorkload::LightDistribution dist, BenchWorkload::CameraPath path,
+	int lightCount, glm::uvec2 grid, ThreadPool* pool, ClusteValidator& validator, BenchReport& report)
+{
+	glm::uvec3 groupNum = glm::uvec3((options.width + grid.x - 1) / grid.x, (options.height + grid.x - 1) / grid.x, grid.y);
+	int clusteCount = groupNum.x * groupNum.y * groupNum.z;
+
+	std::vector<PointLightData> lights;
+	std::vector<LightShapeData> shapes;
+	workload.GenerateLights(dist, lightCount, options.spotRatio, lights, shapes);
+
+	std::vector<LightGrid> lightGrids(clusteCount);
+	std::vector<glm::uint> lightIndices((size_t)clusteCount * std::min((glm::uint)lightCount, options.cap));
+	bool isValidate = options.isValidate && backend != Backend_Raw;
+	std::vector<LightGrid> refGrids(isValidate ? clusteCount : 0);
+	std::vector<glm::uint> refIndices(isValidate ? lightIndices.size() : 0);
+	bool isMatch = true;
+
+	/// compact output is unpacked into lightGrids and lightIndices outside the timing
+	bool isCompact = options.isCompact && backend != Backend_ISPC && backend != Backend_Bitmask && lightCount <= CLUSTE_PACKED_MAX_LIGHTS
+		&& lightIndices.size() <= CLUSTE_PACKED_MAX_OFFSET && options.cap <= CLUSTE_PACKED_MAX_COUNT;
+	std::vector<glm::uint> packedGrids(isCompact ? clusteCount : 0);
+	std::vector<unsigned short> packedIndices(isCompact ? lightIndices.size() : 0);
+	ClusteLightList output = isCompact ? ClusteLightList(packedGrids.data(), packedIndices.data()) : ClusteLightList(lightGrids.data(), lightIndices.data());
+	glm::uint maskWords = ClusteCuller::GetMaskWords(lightCount);
+	std::vector<glm::uint> lightMasks(backend == Backend_Bitmask ? (size_t)clusteCount * maskWords : 0);
+
+	BenchResult result;
+	memset(result.histogram, 0, sizeof(result.histogram));
+	result.backend = BACKEND_NAMES[backend];
+	if (backend == Backend_Simd || backend == Backend_Bitmask)
+		result.backend = result.backend + "_" + SIMD_LEVEL_NAMES[options.simdLevel];
+	if (isCompact)
+		result.backend = result.backend + "_compact";
+	if (!options.isCone)
+		result.backend = result.backend + "_sphere";
+	result.distribution = BenchWorkload::GetDistributionName(dist);
+	result.camera = BenchWorkload::GetCameraPathName(path);
+	result.lightCount = lightCount;
+	result.spotRatio = options.spotRatio;
+	result.tileSize = grid.x;
+	result.zSlices = grid.y;
+	result.clusteCount = clusteCount;
+	result.maxClusteLights = 0;
+	result.overflowLights = 0;
+	result.mismatchClustes = 0;
+	result.boundaryLights = 0;
+	double indexSum = 0;
+	double viewLightSum = 0;
+
+	/// own culler per run, the aabb cache is built in the warmup frames like after a resize
+	ClusteCuller culler(pool);
+	culler.SetSimdLevel(options.simdLevel);
+	std::vector<double> frameMs;
+	for (int frame = -options.warmup; frame < options.frames; frame++)
+	{
+		ScreenToView screenToView;
+		workload.GetCameraFrame(path, std::max(frame, 0), options.frames, screenToView);
+		screenToView.tileSizes = glm::uvec4(groupNum, grid.x);
+		/// same matrix as Camera::GetViewProjectMatrix
+		glm::mat4 viewProject = glm::inverse(screenToView.inverseProjection) * screenToView.viewMatrix;
+		ClusteOverflow overflow;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		VolumeTileAABB* aabbs = culler.UpdateAABBs(groupNum.x, groupNum.y, groupNum.z, screenToView, 0);
+		ViewSpaceLights* viewLights = culler.UpdateViewLights(screenToView, lights.data(), lightCount, options.isFrustum ? &viewProject : NULL, options.isCone ? shapes.data() : NULL);
+		if (backend == Backend_Raw)
+			RawCpu::cluste_culling(groupNum.x, groupNum.y, groupNum.z, aabbs, *viewLights, options.cap, output, overflow);
+		else if (backend == Backend_MultiThread)
+			culler.Cull(groupNum.x, groupNum.y, groupNum.z, aabbs, *viewLights, options.cap, output, overflow);
+		else if (backend == Backend_Simd)
+			culler.CullSimd(groupNum.x, groupNum.y, groupNum.z, aabbs, *viewLights, options.cap, output, overflow);
+		else if (backend == Backend_LightCentric)
+			culler.CullLightCentric(groupNum.x, groupNum.y, groupNum.z, *viewLights, options.cap, output, overflow);
+		else if (backend == Backend_Bitmask)
+			culler.CullBitmask(groupNum.x, groupNum.y, groupNum.z, aabbs, *viewLights, options.simdLevel, maskWords, lightMasks.data());
+		else
+		{
+			ispc::cluste_culling_ispc(groupNum.x, groupNum.y, groupNum.z, (ispc::VolumeTileAABB*)aabbs, viewLights->pos_x.data(), viewLights->pos_y.data(), viewLights->pos_z.data(), viewLights->radius_sq.data(), viewLights->indices.data(), viewLights->count, options.cap, (LightGrid*)lightGrids.data(), lightIndices.data(), (ispc::ClusteOverflow*)&overflow, NULL);
+			culler.RefineShapes(clusteCount, aabbs, *viewLights, lightGrids.data(), lightIndices.data(), output);
+		}
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		if (isCompact)
+			output.Unpack(clusteCount, lightGrids, lightIndices);
+		if (backend == Backend_Bitmask)
+			ClusteCuller::UnpackBitmask(groupNum.x, groupNum.y, groupNum.z, maskWords, lightMasks.data(), options.cap, output, overflow);
+
+		if (isValidate)
+		{
+			ClusteOverflow refOverflow;
+			ClusteValidation validation;
+			RawCpu::cluste_culling(groupNum.x, groupNum.y, groupNum.z, aabbs, *viewLights, options.cap, refGrids.data(), refIndices.data(), refOverflow);
+			validator.Compare(clusteCount, aabbs, *viewLights, options.cap, refGrids.data(), refIndices.data(), lightGrids.data(), lightIndices.data(), validation);
+			if (isMatch && !validator.IsMatch(validation))
+			{
+				fprintf(stderr, "%s frame %d: ", BACKEND_NAMES[backend], frame);
+				validator.Print(stderr, validation, refGrids.data(), refIndices.data(), lightGrids.data(), lightIndices.data());
+				isMatch = false;
+			}
+			if (frame >= 0)
+			{
+				result.mismatchClustes += validation.mismatchClustes;
+				result.boundaryLights += validation.boundaryLights;
+			}
+		}
+
+		if (frame < 0)
+			continue;
+		frameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		BenchReport::AddHistogram(lightGrids.data(), clusteCount, result);
+		result.overflowLights += overflow.lights;
+		viewLightSum += viewLights->count;
+		for (int i = 0; i < clusteCount; i++)
+			indexSum += lightGrids[i].count;
+	}
+
+	BenchReport::ComputeTimes(frameMs, result);
+	result.avgIndexCount = indexSum / options.frames;
+	result.avgViewLights = viewLightSum / options.frames;
+	report.AddResult(result);
+
+	fprintf(stderr, "%-12s %-9s %-5s lights %5d grid %3ux%-3u median %8.4f ms p99 %8.4f ms\n", result.backend.c_str(), result.distribution.c_str(), result.camera.c_str(),
+		lightCount, grid.x, grid.y, result.medianMs, result.p99Ms);
+	return isMatch;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "usage: ClusteBench [backend=raw,mt,lightcentric,ispc,simd,bitmask] [dist=uniform,clustered,corridor] [camera=orbit,fly]\n"
+			"       [lights=16,256,1024,4096] [grid=80x24,...] [frames=120] [warmup=5] [seed=1] [width=1920] [height=1080]\n"
+			"       [cap=128] [format=csv|json] [out=file] [validate=1] [simd=scalar|sse2|avx2|avx512] [frustum=1] [compact=0] [spots=0] [cone=1]\n"
+			"       ClusteBench mesh=file.obj [rounds=5] [out=file]\n");
+		return 1;
+	}
+
+	if (options.mesh != NULL)
+	{
+		FILE* file = stdout;
+		if (options.out != NULL && (file = fopen(options.out, "w")) == NULL)
+		{
+			fprintf(stderr, "failed to open %s\n", options.out);
+			return 1;
+		}
+		MeshBench meshBench;
+		bool isLoaded = meshBench.Run(options.mesh, options.rounds, file);
+		if (file != stdout)
+			fclose(file);
+		return isLoaded ? 0 : 1;
+	}
+
+	ThreadPool pool;
+	BenchWorkload workload(options.seed, options.width, options.height);
+	BenchReport report;
+	ClusteValidator validator;
+	bool isMatch = true;
+	for (size_t g = 0; g < options.grids.size(); g++)
+		for (size_t d = 0; d < options.distributions.size(); d++)
+			for (size_t c = 0; c < options.cameras.size(); c++)
+				for (size_t l = 0; l < options.lightCounts.size(); l++)
+					for (size_t b = 0; b < options.backends.size(); b++)
+						isMatch &= RunBench(options, options.backends[b], workload, (BenchWorkload::LightDistribution)options.distributions[d], (BenchWorkload::CameraPath)options.cameras[c],
+							options.lightCounts[l], options.grids[g], &pool, validator, report);
+
+	FILE* file = stdout;
+	if (options.out != NULL && (file = fopen(options.out, "w")) == NULL)
+	{
+		fprintf(stderr, "failed to open %s\n", options.out);
+		return 1;
+	}
+	if (options.isJson)
+		report.WriteJson(file);
+	else
+		report.WriteCsv(file);
+	if (file != stdout)
+		fclose(file);
+
+	return isMatch ? 0 : 2;
+}
@@ -0,0 +1,201 @@
+#include <chrono>
+#include <map>
+#include <string>
+#include <algorithm>
+
+#include "MeshBench.h"
+#include "Common/ThreadPool.h"
+#include "Renderer/MeshAsset.h"
+#include "Renderer/MeshCache.h"
+#include "Renderer/ObjLoader.h"
+#include "Renderer/VertexHash.h"
+
+MeshBench::MeshBench()
+{
+}
+
+MeshBench::~MeshBench()
+{
+}
+
+double MeshBench::DedupMap(std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount, size_t& wrongCorners)
+{
+	vertexCount = 0;
+	wrongCorners = 0;
+	double ms = 0.0;
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		std::vector<tinyobj::index_t>& corners = shapes[i].mesh.indices;
+		std::vector<tinyobj::index_t> vertexs;
+		std::vector<int> indices;
+		indices.reserve(corners.size());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::map<int, int> indexMap;
+		for (size_t j = 0; j < corners.size(); j++)
+		{
+			const tinyobj::index_t& corner = corners[j];
+			int hash = (corner.vertex_index * 31 + corner.texcoord_index) * 31 + corner.normal_index;
+			std::map<int, int>::iterator iter = indexMap.find(hash);
+			if (iter != indexMap.end())
+				indices.push_back(iter->second);
+			else
+			{
+				indices.push_back((int)vertexs.size());
+				indexMap.insert(std::make_pair(hash, (int)vertexs.size()));
+				vertexs.push_back(corner);
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+		vertexCount += vertexs.size();
+		for (size_t j = 0; j < corners.size(); j++)
+		{
+			const tinyobj::index_t& vertex = vertexs[indices[j]];
+			if (vertex.vertex_index != corners[j].vertex_index || vertex.texcoord_index != corners[j].texcoord_index || vertex.normal_index != corners[j].normal_index)
+				wrongCorners++;
+		}
+	}
+	return ms;
+}
+
+double MeshBench::DedupHash(std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount)
+{
+	vertexCount = 0;
+	double ms = 0.0;
+	VertexHash vertexHash;
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		std::vector<tinyobj::index_t>& corners = shapes[i].mesh.indices;
+		std::vector<tinyobj::index_t> vertexs;
+		std::vector<int> indices;
+		indices.reserve(corners.size());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		vertexHash.Reserve(shapes[i].mesh.num_face_vertices.size());
+		for (size_t j = 0; j < corners.size(); j++)
+		{
+			const tinyobj::index_t& corner = corners[j];
+			int vtxIdx = vertexHash.FindOrInsert(corner.vertex_index, corner.texcoord_index, corner.normal_index, (int)vertexs.size());
+			if (vtxIdx == (int)vertexs.size())
+				vertexs.push_back(corner);
+			indices.push_back(vtxIdx);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+		vertexCount += vertexs.size();
+	}
+	return ms;
+}
+
+double MeshBench::BuildAssets(ThreadPool* pool, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount)
+{
+	vertexCount = 0;
+	std::vector<MeshAsset> assets;
+	auto start = std::chrono::high_resolution_clock::now();
+	MeshBuilder::BuildShapes(pool, attrib, shapes, false, false, assets);
+	auto end = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < assets.size(); i++)
+		vertexCount += assets[i].vertexs.size();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool MeshBench::Run(const char* path, int repeat, FILE* file)
+{
+	std::string objPath = path;
+	std::string basePath = "";
+	size_t slashIdx = objPath.find_last_of("/");
+	if (slashIdx != std::string::npos)
+		basePath = objPath.substr(0, slashIdx);
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warn;
+	std::string err;
+	ThreadPool pool;
+	ObjLoader loader(&pool);
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!loader.Load(objPath, basePath, attrib, shapes, materials, warn, err))
+	{
+		fprintf(stderr, "failed to load %s: %s\n", path, err.c_str());
+		return false;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	double loadMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+	size_t cornerCount = 0;
+	for (size_t i = 0; i < shapes.size(); i++)
+		cornerCount += shapes[i].mesh.indices.size();
+
+	/// best of the rounds, the first round also pays for the page faults of the output
+	ThreadPool serialPool(0);
+	double mapMs = 0.0, hashMs = 0.0, buildMs = 0.0, parallelBuildMs = 0.0;
+	size_t mapVertexs = 0, hashVertexs = 0, wrongCorners = 0, assetVertexs = 0, parallelAssetVertexs = 0;
+	for (int r = 0; r < repeat; r++)
+	{
+		double ms = DedupMap(shapes, mapVertexs, wrongCorners);
+		mapMs = r == 0 ? ms : std::min(mapMs, ms);
+		ms = DedupHash(shapes, hashVertexs);
+		hashMs = r == 0 ? ms : std::min(hashMs, ms);
+		ms = BuildAssets(&serialPool, attrib, shapes, assetVertexs);
+		buildMs = r == 0 ? ms : std::min(buildMs, ms);
+		ms = BuildAssets(&pool, attrib, shapes, parallelAssetVertexs);
+		parallelBuildMs = r == 0 ? ms : std::min(parallelBuildMs, ms);
+	}
+	if (parallelAssetVertexs != assetVertexs)
+		fprintf(stderr, "parallel build gave %zu vertices, serial %zu\n", parallelAssetVertexs, assetVertexs);
+
+	/// the cache of the vulkan back end without mesh shading, written next to the obj like TOModel does
+	std::string cachePath = MeshCache::GetPath(objPath, false, false);
+	double bakeMs = 0.0, openMs = 0.0;
+	size_t cacheBytes = 0, cacheVertexs = 0;
+	{
+		std::vector<MeshAsset> assets;
+		MeshBuilder::BuildShapes(&pool, attrib, shapes, false, false, assets);
+		MeshCache cache;
+		start = std::chrono::high_resolution_clock::now();
+		cache.Bake(objPath, loader.GetMtlPaths(), assets, materials, false, false);
+		if (!cache.Write(cachePath))
+			fprintf(stderr, "failed to write %s\n", cachePath.c_str());
+		end = std::chrono::high_resolution_clock::now();
+		bakeMs = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	for (int r = 0; r < repeat; r++)
+	{
+		/// open with the source hash and copy the vertices and indices out like the back ends do before the upload
+		MeshCache cache;
+		std::vector<Vertex> vertexs;
+		std::vector<int> indices;
+		start = std::chrono::high_resolution_clock::now();
+		if (!cache.Open(cachePath, objPath, false, false))
+		{
+			fprintf(stderr, "failed to open %s\n", cachePath.c_str());
+			break;
+		}
+		cacheVertexs = 0;
+		for (int i = 0; i < cache.GetMeshCount(); i++)
+		{
+			const MeshCache::MeshRecord& mesh = cache.GetMesh(i);
+			vertexs.assign(cache.GetVertexs(mesh), cache.GetVertexs(mesh) + mesh.vertexCount);
+			indices.assign(cache.GetIndices(mesh), cache.GetIndices(mesh) + mesh.indexCount);
+			cacheVertexs += vertexs.size();
+		}
+		end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		openMs = r == 0 ? ms : std::min(openMs, ms);
+	}
+	MappedFile cacheFile;
+	if (cacheFile.Open(cachePath))
+		cacheBytes = cacheFile.GetSize();
+	if (cacheVertexs != assetVertexs)
+		fprintf(stderr, "cache has %zu vertices, build %zu\n", cacheVertexs, assetVertexs);
+
+	fprintf(file, "mesh,shapes,corners,load_ms,map_ms,hash_ms,speedup,map_vertices,hash_vertices,wrong_corners,build_ms,asset_vertices,threads,parallel_build_ms,build_speedup,cache_bake_ms,cache_open_ms,cache_bytes\n");
+	fprintf(file, "%s,%d,%zu,%.3f,%.3f,%.3f,%.2f,%zu,%zu,%zu,%.3f,%zu,%d,%.3f,%.2f,%.3f,%.3f,%zu\n", path, (int)shapes.size(), cornerCount, loadMs, mapMs, hashMs,
+		hashMs > 0.0 ? mapMs / hashMs : 0.0, mapVertexs, hashVertexs, wrongCorners, buildMs, assetVertexs, pool.GetWorkerCount() + 1, parallelBuildMs,
+		parallelBuildMs > 0.0 ? buildMs / parallelBuildMs : 0.0, bakeMs, openMs, cacheBytes);
+	return true;
+}
@@ -0,0 +1,29 @@
+#ifndef __MESH_BENCH_H__
+#define __MESH_BENCH_H__
+
+#include <stdio.h>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+class ThreadPool;
+
+/// obj loading, vertex deduplication and mesh asset timings, the same MeshBuilder and MeshCache as TOModel::LoadFromPath
+class MeshBench
+{
+public:
+	MeshBench();
+	virtual ~MeshBench();
+
+	/// loads the obj once, then times repeat rounds of the deduplication of every shape with the old std::map on the packed
+	/// (v * 31 + t) * 31 + n key and with VertexHash, the corners the packed key gives a wrong vertex are counted too,
+	/// and of the whole mesh asset build of every shape, on one thread and on all of them, then of baking and opening its mesh cache
+	bool Run(const char* path, int repeat, FILE* file);
+
+private:
+	static double DedupMap(std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount, size_t& wrongCorners);
+	static double DedupHash(std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount);
+	static double BuildAssets(ThreadPool* pool, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, size_t& vertexCount);
+};
+
+#endif // !__MESH_BENCH_H__
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "MeshBench.h"
+
+/// the mesh timings of ClusteBench without the culling back ends, so it builds without ispc
+/// usage: MeshBench file.obj [rounds=5] [out=file]
+
+int main(int argc, char* argv[])
+{
+	const char* path = NULL;
+	const char* out = NULL;
+	int rounds = 5;
+	bool isValid = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "rounds=", 7) == 0)
+			rounds = std::max(atoi(argv[i] + 7), 1);
+		else if (strncmp(argv[i], "out=", 4) == 0)
+			out = argv[i] + 4;
+		else if (path == NULL && strchr(argv[i], '=') == NULL)
+			path = argv[i];
+		else
+			isValid = false;
+	}
+	if (!isValid || path == NULL)
+	{
+		fprintf(stderr, "usage: MeshBench file.obj [rounds=5] [out=file]\n");
+		return 1;
+	}
+
+	FILE* file = stdout;
+	if (out != NULL && (file = fopen(out, "w")) == NULL)
+	{
+		fprintf(stderr, "failed to open %s\n", out);
+		return 1;
+	}
+	MeshBench meshBench;
+	bool isLoaded = meshBench.Run(path, rounds, file);
+	if (file != stdout)
+		fclose(file);
+	return isLoaded ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "AsyncJob.h"
+
+AsyncJob::AsyncJob()
+{
+	is_busy = false;
+	is_quit = false;
+	worker = std::thread(&AsyncJob::WorkerLoop, this);
+}
+
+AsyncJob::~AsyncJob()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cv.wait(lock, [this] { return !is_busy; });
+		is_quit = true;
+	}
+	wake_cv.notify_all();
+	worker.join();
+}
+
+void AsyncJob::Start(const std::function<void()>& func)
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job_func = func;
+		is_busy = true;
+	}
+	wake_cv.notify_all();
+}
+
+void AsyncJob::Wait()
+{
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cv.wait(lock, [this] { return !is_busy; });
+		error = job_error;
+		job_error = NULL;
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+bool AsyncJob::IsBusy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return is_busy;
+}
+
+void AsyncJob::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> func;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake_cv.wait(lock, [this] { return is_quit || is_busy; });
+			if (is_quit)
+				return;
+			func = job_func;
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			func();
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job_func = NULL;
+			job_error = error;
+			is_busy = false;
+		}
+		done_cv.notify_all();
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef __ASYNC_JOB_H__
+#define __ASYNC_JOB_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+/// one persistent background thread running one job at a time, the owner joins it with Wait
+class AsyncJob
+{
+public:
+	AsyncJob();
+	virtual ~AsyncJob();
+
+	/// waits for the last job first
+	void Start(const std::function<void()>& func);
+	/// returns at once when no job runs, rethrows what the job threw
+	void Wait();
+	bool IsBusy();
+
+private:
+	void WorkerLoop();
+
+private:
+	std::thread worker;
+
+	std::mutex mutex;
+	std::condition_variable wake_cv;
+	std::condition_variable done_cv;
+
+	std::function<void()> job_func;
+	std::exception_ptr job_error;
+	bool is_busy;
+	bool is_quit;
+};
+
+#endif // !__ASYNC_JOB_H__
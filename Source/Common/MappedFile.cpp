@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+#ifdef _WIN32
+	file_handle = INVALID_HANDLE_VALUE;
+	map_handle = NULL;
+#else
+	file_desc = -1;
+#endif
+	data = NULL;
+	size = 0;
+	is_open = false;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file_handle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	/// a zero sized mapping is not allowed
+	if (size > 0)
+	{
+		map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (map_handle == NULL)
+		{
+			Close();
+			return false;
+		}
+		data = (const char*)MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	file_desc = open(path.c_str(), O_RDONLY);
+	if (file_desc < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(file_desc, &fileStat) != 0)
+	{
+		Close();
+		return false;
+	}
+	size = (size_t)fileStat.st_size;
+
+	if (size > 0)
+	{
+		void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file_desc, 0);
+		if (view == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		data = (const char*)view;
+	}
+#endif
+
+	is_open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (map_handle != NULL)
+		CloseHandle(map_handle);
+	if (file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle);
+	file_handle = INVALID_HANDLE_VALUE;
+	map_handle = NULL;
+#else
+	if (data != NULL)
+		munmap((void*)data, size);
+	if (file_desc >= 0)
+		close(file_desc);
+	file_desc = -1;
+#endif
+	data = NULL;
+	size = 0;
+	is_open = false;
+}
@@ -0,0 +1,34 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <stddef.h>
+#include <string>
+
+/// read-only memory mapping of a whole file, the pages are read in by the os when they are first touched
+class MappedFile
+{
+public:
+	MappedFile();
+	virtual ~MappedFile();
+
+	/// an empty file opens with a NULL view
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() { return is_open; }
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+#ifdef _WIN32
+	void* file_handle;
+	void* map_handle;
+#else
+	int file_desc;
+#endif
+	const char* data;
+	size_t size;
+	bool is_open;
+};
+
+#endif // !__MAPPED_FILE_H__
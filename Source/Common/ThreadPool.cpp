@@ -0,0 +1,102 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int workerNum)
+{
+	job_func = NULL;
+	job_count = 0;
+	job_next = 0;
+	job_busy = 0;
+	job_generation = 0;
+	is_quit = false;
+
+	if (workerNum < 0)
+	{
+		workerNum = (int)std::thread::hardware_concurrency() - 1;
+		if (workerNum < 0)
+			workerNum = 0;
+	}
+
+	for (int i = 0; i < workerNum; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		is_quit = true;
+	}
+	wake_cv.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& func)
+{
+	if (count <= 0)
+		return;
+
+	/// not worth waking anyone
+	if (workers.size() == 0 || count == 1)
+	{
+		for (int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	std::lock_guard<std::mutex> callLock(call_mutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job_func = &func;
+		job_count = count;
+		job_next = 0;
+		job_busy = (int)workers.size();
+		job_generation++;
+	}
+	wake_cv.notify_all();
+
+	RunJob();
+
+	/// workers may still hold the last indices
+	std::unique_lock<std::mutex> lock(mutex);
+	done_cv.wait(lock, [this] { return job_busy == 0; });
+	job_func = NULL;
+}
+
+void ThreadPool::RunJob()
+{
+	int idx;
+	while ((idx = job_next.fetch_add(1)) < job_count)
+	{
+		(*job_func)(idx);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake_cv.wait(lock, [this, generation] { return is_quit || job_generation != generation; });
+			if (is_quit)
+				return;
+			generation = job_generation;
+		}
+
+		RunJob();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job_busy--;
+			if (job_busy == 0)
+				done_cv.notify_one();
+		}
+	}
+}
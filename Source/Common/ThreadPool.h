@@ -0,0 +1,43 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/// persistent worker threads, the calling thread takes part in the work too
+class ThreadPool
+{
+public:
+	ThreadPool(int workerNum = -1);	/// -1: hardware concurrency - 1
+	virtual ~ThreadPool();
+
+	int GetWorkerCount() { return (int)workers.size(); }
+
+	/// run func(0) ... func(count - 1) on all threads, return when every index is done
+	void ParallelFor(int count, const std::function<void(int)>& func);
+
+private:
+	void WorkerLoop();
+	void RunJob();
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex call_mutex;	/// one ParallelFor at a time
+	std::mutex mutex;
+	std::condition_variable wake_cv;
+	std::condition_variable done_cv;
+
+	const std::function<void(int)>* job_func;
+	int job_count;
+	std::atomic<int> job_next;
+	int job_busy;
+	unsigned int job_generation;
+	bool is_quit;
+};
+
+#endif // !__THREAD_POOL_H__
@@ -17,48 +17,12 @@ namespace ispc { /* namespace */
 // Vector types with external visibility from ispc code
 ///////////////////////////////////////////////////////////////////////////
 
-#ifndef __ISPC_VECTOR_float16__
-#define __ISPC_VECTOR_float16__
+#ifndef __ISPC_VECTOR_float4__
+#define __ISPC_VECTOR_float4__
 #ifdef _MSC_VER
-__declspec( align(64) ) struct float16 { float v[16]; };
+__declspec( align(16) ) struct float4 { float v[4]; };
 #else
-struct float16 { float v[16]; } __attribute__ ((aligned(64)));
-#endif
-#endif
-
-#ifndef __ISPC_VECTOR_int32_t4__
-#define __ISPC_VECTOR_int32_t4__
-#ifdef _MSC_VER
-__declspec( align(16) ) struct int32_t4 { int32_t v[4]; };
-#else
-struct int32_t4 { int32_t v[4]; } __attribute__ ((aligned(16)));
-#endif
-#endif
-
-#ifndef __ISPC_VECTOR_int32_t2__
-#define __ISPC_VECTOR_int32_t2__
-#ifdef _MSC_VER
-__declspec( align(16) ) struct int32_t2 { int32_t v[2]; };
-#else
-struct int32_t2 { int32_t v[2]; } __attribute__ ((aligned(16)));
-#endif
-#endif
-
-#ifndef __ISPC_VECTOR_float3__
-#define __ISPC_VECTOR_float3__
-#ifdef _MSC_VER
-__declspec( align(16) ) struct float3 { float v[3]; };
-#else
-struct float3 { float v[3]; } __attribute__ ((aligned(16)));
-#endif
-#endif
-
-#ifndef __ISPC_VECTOR_float2__
-#define __ISPC_VECTOR_float2__
-#ifdef _MSC_VER
-__declspec( align(16) ) struct float2 { float v[2]; };
-#else
-struct float2 { float v[2]; } __attribute__ ((aligned(16)));
+struct float4 { float v[4]; } __attribute__ ((aligned(16)));
 #endif
 #endif
 
@@ -76,32 +40,11 @@ struct float2 { float v[2]; } __attribute__ ((aligned(16)));
 #endif
 #endif
 
-#ifndef __ISPC_STRUCT_ScreenToViewISPC__
-#define __ISPC_STRUCT_ScreenToViewISPC__
-struct ScreenToViewISPC {
-    float16  inverseProjection;
-    float16  viewMatrix;
-    int32_t4  tileSizes;
-    int32_t2  screenDimensions;
-    float zNear;
-    float zFar;
-};
-#endif
-
-#ifndef __ISPC_STRUCT_PointLightDataISPC__
-#define __ISPC_STRUCT_PointLightDataISPC__
-struct PointLightDataISPC {
-    float3  pos;
-    float radius;
-    float3  color;
-    uint32_t enabled;
-    float ambient_intensity;
-    float diffuse_intensity;
-    float specular_intensity;
-    float attenuation_constant;
-    float attenuation_linear;
-    float attenuation_exp;
-    float2  padding;
+#ifndef __ISPC_STRUCT_VolumeTileAABB__
+#define __ISPC_STRUCT_VolumeTileAABB__
+struct VolumeTileAABB {
+    float4  minPoint;
+    float4  maxPoint;
 };
 #endif
 
@@ -113,6 +56,14 @@ struct LightGrid {
 };
 #endif
 
+#ifndef __ISPC_STRUCT_ClusteOverflow__
+#define __ISPC_STRUCT_ClusteOverflow__
+struct ClusteOverflow {
+    uint32_t clustes;
+    uint32_t lights;
+};
+#endif
+
 
 ///////////////////////////////////////////////////////////////////////////
 // Functions exported from ispc code
@@ -120,7 +71,7 @@ struct LightGrid {
 #if defined(__cplusplus) && (! defined(__ISPC_NO_EXTERN_C) || !__ISPC_NO_EXTERN_C )
 extern "C" {
 #endif // __cplusplus
-    extern void cluste_culling_ispc(const int32_t xSize, const int32_t ySize, int32_t zSize, struct ScreenToViewISPC &screenToView, struct PointLightDataISPC * pointLights, const int32_t lightCount, struct LightGrid * lightGrids, uint32_t * globalLightIndexList);
+    extern void cluste_culling_ispc(const int32_t xSize, const int32_t ySize, int32_t zSize, struct VolumeTileAABB * aabbs, float * lightPosX, float * lightPosY, float * lightPosZ, float * lightRadiusSq, uint32_t * lightIndices, const int32_t lightCount, const uint32_t maxLightsPerCluste, struct LightGrid * lightGrids, uint32_t * globalLightIndexList, struct ClusteOverflow * overflow, uint8_t * activeClustes);
 #if defined(__cplusplus) && (! defined(__ISPC_NO_EXTERN_C) || !__ISPC_NO_EXTERN_C )
 } /* end extern C */
 #endif // __cplusplus
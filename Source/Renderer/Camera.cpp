@@ -10,6 +10,8 @@
 Camera::Camera(float s_width, float s_height)
 	:screen_width(s_width)
 	,screen_height(s_height)
+	,project_version(0)
+	,project_mat(0.0f)
 {
 	glm::vec3 p = glm::vec3(1027,183,46);
 	SetPosition(p);
@@ -78,10 +80,16 @@ glm::mat4x4* Camera::UpdateProjectMatrix()
 {
 	if (project_changed)
 	{
+		glm::mat4x4 mat;
 		if (Renderer::GetType() == Renderer::Vulkan)
-			project_mat = glm::perspective(glm::radians(fov), screen_width/screen_height, near_clamp, far_clamp); /// vulkan is right-hand
+			mat = glm::perspective(glm::radians(fov), screen_width/screen_height, near_clamp, far_clamp); /// vulkan is right-hand
 		else
-			project_mat = glm::perspectiveLH_ZO(glm::radians(fov), screen_width / screen_height, near_clamp, far_clamp);
+			mat = glm::perspectiveLH_ZO(glm::radians(fov), screen_width / screen_height, near_clamp, far_clamp);
+		if (mat != project_mat)
+		{
+			project_mat = mat;
+			project_version++;
+		}
 		project_changed = false;
 	}
 	return &project_mat;
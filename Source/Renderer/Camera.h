@@ -23,6 +23,7 @@ public:
 	glm::mat4x4* GetProjectMatrix() { return &project_mat; }
 	glm::mat4x4* GetViewProjectMatrix() { return &view_project_mtx; }
 	glm::mat4x4* GetReProjectMatrix() { return &re_project_mtx; }
+	unsigned int GetProjectVersion() { return project_version; }	/// bumped every time project_mat really changes
 
 	glm::vec3 GetLookAtPosition() { return look_at; }
 
@@ -50,6 +51,7 @@ private:
 	float screen_height;
 
 	bool project_changed;
+	unsigned int project_version;
 	glm::mat4x4 project_mat;
 
 	glm::mat4x4 view_project_mtx;
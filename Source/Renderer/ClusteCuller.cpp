@@ -0,0 +1,920 @@
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Common/ThreadPool.h"
+#include "ClusteCuller.h"
+#include "ClusteCulling.h"
+
+ClusteCuller::ClusteCuller(ThreadPool* pool)
+	:thread_pool(pool)
+	,aabb_valid(false)
+	,aabb_project_version(0)
+	,aabb_screen_dimensions(0)
+	,aabb_tile_sizes(0)
+	,tile_depth_size(0)
+	,rejected_light_count(0)
+	,is_all_dirty(true)
+	,incremental_valid(false)
+	,incremental_serial(0)
+	,written_clustes(0)
+	,written_indices(0)
+{
+	simd_level = ClusteSimd::GetBestLevel();
+	view_lights.count = 0;
+}
+
+ClusteCuller::~ClusteCuller()
+{
+}
+
+VolumeTileAABB* ClusteCuller::UpdateAABBs(int xSize, int ySize, int zSize, ScreenToView& screenToView, unsigned int projectVersion)
+{
+	int clusteCount = xSize * ySize * zSize;
+	if (aabb_valid && cluste_aabbs.size() == (size_t)clusteCount && aabb_project_version == projectVersion
+		&& aabb_screen_dimensions == screenToView.screenDimensions && aabb_tile_sizes == screenToView.tileSizes)
+		return cluste_aabbs.data();
+
+	cluste_aabbs.resize(clusteCount);
+	RawCpu::cluste_aabbs(xSize, ySize, zSize, screenToView, cluste_aabbs.data());
+	BuildAxisBounds(xSize, ySize, zSize);
+	is_all_dirty = true;
+
+	aabb_valid = true;
+	aabb_project_version = projectVersion;
+	aabb_screen_dimensions = screenToView.screenDimensions;
+	aabb_tile_sizes = screenToView.tileSizes;
+	return cluste_aabbs.data();
+}
+
+ViewSpaceLights* ClusteCuller::UpdateViewLights(ScreenToView& screenToView, PointLightData* pointLights, int lightCount, const glm::mat4* viewProject, const LightShapeData* lightShapes)
+{
+	glm::vec4 planes[6];
+	if (viewProject != NULL)
+		RawCpu::frustum_planes(*viewProject, planes);
+	RawCpu::view_space_lights(screenToView, pointLights, lightCount, view_lights, viewProject != NULL ? planes : NULL, lightShapes);
+
+	/// the tile grid has to be the one of the cached aabbs
+	if (!tile_depths.empty() && tile_depth_size.x == aabb_tile_sizes.x && tile_depth_size.y == aabb_tile_sizes.y)
+		RejectDepthLights(view_lights);
+
+	int enabledCount = 0;
+	for (int light = 0; light < lightCount; light++)
+		enabledCount += pointLights[light].enabled == 1 ? 1 : 0;
+	rejected_light_count = enabledCount - view_lights.count;
+	return &view_lights;
+}
+
+void ClusteCuller::UpdateTileDepths(const float* depths, int width, int height, int tileSize, ScreenToView& screenToView)
+{
+	int xSize = (width + tileSize - 1) / tileSize;
+	int ySize = (height + tileSize - 1) / tileSize;
+	tile_depth_scratch.resize(xSize * ySize);
+
+	/// raw depth range of each tile, a tile row per task
+	thread_pool->ParallelFor(ySize, [&](int ty) {
+		glm::vec2* tiles = &tile_depth_scratch[ty * xSize];
+		for (int tx = 0; tx < xSize; tx++)
+			tiles[tx] = glm::vec2(FLT_MAX, -FLT_MAX);
+		int rowEnd = std::min((ty + 1) * tileSize, height);
+		for (int row = ty * tileSize; row < rowEnd; row++)
+		{
+			const float* line = depths + (size_t)row * width;
+			for (int col = 0; col < width; col++)
+			{
+				glm::vec2& tile = tiles[col / tileSize];
+				tile.x = std::min(tile.x, line[col]);
+				tile.y = std::max(tile.y, line[col]);
+			}
+		}
+	});
+
+	/// to view depth, depth only depends on z so x and y can be anything
+	bool isChanged = tile_depths.size() != tile_depth_scratch.size();
+	tile_depths.resize(tile_depth_scratch.size());
+	for (size_t i = 0; i < tile_depth_scratch.size(); i++)
+	{
+		glm::vec4 nearPoint = screenToView.inverseProjection * glm::vec4(0.0f, 0.0f, tile_depth_scratch[i].x, 1.0f);
+		glm::vec4 farPoint = screenToView.inverseProjection * glm::vec4(0.0f, 0.0f, tile_depth_scratch[i].y, 1.0f);
+		glm::vec2 range = glm::vec2(-nearPoint.z / nearPoint.w, -farPoint.z / farPoint.w);
+		isChanged = isChanged || range != tile_depths[i];
+		tile_depths[i] = range;
+	}
+	tile_depth_size = glm::uvec2(xSize, ySize);
+
+	/// the view lights depend on the tile depths now, cached cluste lists are stale
+	if (isChanged)
+		is_all_dirty = true;
+}
+
+void ClusteCuller::UpdateActiveClustes(const float* depths, int width, int height, int tileSize, ScreenToView& screenToView)
+{
+	int xSize = screenToView.tileSizes.x;
+	int ySize = screenToView.tileSizes.y;
+	int zSize = screenToView.tileSizes.z;
+	int clusteCount = xSize * ySize * zSize;
+
+	/// 0..1 depth of the inner slice borders at 0.1% nearer and farther, a pixel close to a border marks both slices
+	/// whatever rounding the shader's log2 does
+	int edgeCount = zSize - 1;
+	glm::mat4 projection = glm::inverse(screenToView.inverseProjection);
+	slice_edges.resize(edgeCount * 2);
+	for (int z = 1; z < zSize; z++)
+	{
+		float dist = screenToView.zNear * powf(screenToView.zFar / screenToView.zNear, (float)z / zSize);
+		glm::vec4 nearClip = projection * glm::vec4(0.0f, 0.0f, -dist * 0.999f, 1.0f);
+		glm::vec4 farClip = projection * glm::vec4(0.0f, 0.0f, -dist * 1.001f, 1.0f);
+		slice_edges[z - 1] = nearClip.z / nearClip.w;
+		slice_edges[edgeCount + z - 1] = farClip.z / farClip.w;
+	}
+	const float* nearEdges = slice_edges.data();
+	const float* farEdges = nearEdges + edgeCount;
+
+	/// a tile row per task, it owns the flags of its clusters
+	active_scratch.assign(clusteCount, 0);
+	thread_pool->ParallelFor(ySize, [&](int ty) {
+		int rowEnd = std::min((ty + 1) * tileSize, height);
+		int colEnd = std::min(xSize * tileSize, width);
+		for (int row = ty * tileSize; row < rowEnd; row++)
+		{
+			const float* line = depths + (size_t)row * width;
+			for (int col = 0; col < colEnd; col++)
+			{
+				float depth = line[col];
+				if (depth >= 1.0f)
+					continue;	/// cleared, nothing drawn
+
+				int z0 = (int)(std::upper_bound(farEdges, farEdges + edgeCount, depth) - farEdges);
+				int z1 = (int)(std::upper_bound(nearEdges, nearEdges + edgeCount, depth) - nearEdges);
+				unsigned char* flags = &active_scratch[col / tileSize + ty * xSize];
+				for (int z = z0; z <= z1; z++)
+					flags[z * xSize * ySize] = 1;
+			}
+		}
+	});
+
+	if (active_scratch == active_flags)
+		return;
+
+	/// other clusters lose or gain lights, cached cluste lists are stale
+	active_flags.swap(active_scratch);
+	active_clustes.clear();
+	for (int i = 0; i < clusteCount; i++)
+	{
+		if (active_flags[i] != 0)
+			active_clustes.push_back(i);
+	}
+	is_all_dirty = true;
+}
+
+void ClusteCuller::ClearActiveClustes()
+{
+	if (!active_flags.empty())
+		is_all_dirty = true;
+	active_flags.clear();
+	active_clustes.clear();
+}
+
+void ClusteCuller::CheckActiveGrid(int clusteCount)
+{
+	/// flags of an older grid, nothing is known about the new one
+	if (!active_flags.empty() && active_flags.size() != (size_t)clusteCount)
+		ClearActiveClustes();
+}
+
+const unsigned char* ClusteCuller::GetActiveFlags()
+{
+	CheckActiveGrid(aabb_tile_sizes.x * aabb_tile_sizes.y * aabb_tile_sizes.z);
+	return active_flags.empty() ? NULL : active_flags.data();
+}
+
+void ClusteCuller::ClearTileDepths()
+{
+	if (!tile_depths.empty())
+		is_all_dirty = true;
+	tile_depths.clear();
+	tile_depth_size = glm::uvec2(0);
+}
+
+bool ClusteCuller::IsLightInDepth(ViewSpaceLights& viewLights, int light)
+{
+	int xSize = aabb_tile_sizes.x;
+	int ySize = aabb_tile_sizes.y;
+	int zSize = aabb_tile_sizes.z;
+	glm::vec3 center = glm::vec3(viewLights.pos_x[light], viewLights.pos_y[light], viewLights.pos_z[light]);
+	float radius = sqrtf(viewLights.radius_sq[light]);
+	float depth = -center.z;
+	float padX = radius + (fabsf(center.x) + radius) * 1e-5f;
+	float padY = radius + (fabsf(center.y) + radius) * 1e-5f;
+	float padZ = radius + (fabsf(depth) + radius) * 1e-5f;
+
+	/// the light needs a cluste it may touch with last frame's geometry inside the cluste and the light's depth range
+	int z0, z1;
+	AxisRange(slice_bounds.data(), zSize, depth - padZ, depth + padZ, z0, z1);
+	for (int z = z0; z <= z1; z++)
+	{
+		float nearDepth = std::max(slice_depths[z].x, depth - padZ);
+		float farDepth = std::min(slice_depths[z].y, depth + padZ);
+		int x0, x1, y0, y1;
+		AxisRange(&column_bounds[z * xSize], xSize, center.x - padX, center.x + padX, x0, x1);
+		AxisRange(&row_bounds[z * ySize], ySize, center.y - padY, center.y + padY, y0, y1);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				glm::vec2& tile = tile_depths[x + y * xSize];
+				if (tile.x <= farDepth && tile.y >= nearDepth)
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ClusteCuller::RejectDepthLights(ViewSpaceLights& viewLights)
+{
+	light_keeps.resize(viewLights.count);
+	thread_pool->ParallelFor(viewLights.count, [&](int light) {
+		light_keeps[light] = IsLightInDepth(viewLights, light) ? 1 : 0;
+	});
+
+	/// compact in place, light order stays
+	int count = 0;
+	for (int light = 0; light < viewLights.count; light++)
+	{
+		if (light_keeps[light] == 0)
+			continue;
+		viewLights.pos_x[count] = viewLights.pos_x[light];
+		viewLights.pos_y[count] = viewLights.pos_y[light];
+		viewLights.pos_z[count] = viewLights.pos_z[light];
+		viewLights.radius_sq[count] = viewLights.radius_sq[light];
+		viewLights.indices[count] = viewLights.indices[light];
+		if (viewLights.shape_count > 0)
+			viewLights.shapes[count] = viewLights.shapes[light];
+		count++;
+	}
+	viewLights.count = count;
+
+	if (viewLights.shape_count > 0)
+	{
+		viewLights.shape_count = 0;
+		for (int light = 0; light < count; light++)
+			viewLights.shape_count += viewLights.shapes[light].type != LightType_Point ? 1 : 0;
+	}
+}
+
+void ClusteCuller::CullRow(int row, int xSize, int ySize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level)
+{
+	RowScratch& scratch = row_scratchs[row];
+	scratch.indices.clear();
+	scratch.grids.resize(xSize);
+
+	int y = row % ySize;
+	int z = row / ySize;
+	for (int x = 0; x < xSize; x++)
+	{
+		glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+		glm::vec3 minPointAABB = glm::vec3(aabbs[tileIndex].minPoint);
+		glm::vec3 maxPointAABB = glm::vec3(aabbs[tileIndex].maxPoint);
+
+		glm::uint offset = (glm::uint)scratch.indices.size();
+		if (!IsActive(tileIndex))
+		{
+			/// no geometry, no lights
+			scratch.grids[x].offset = offset;
+			scratch.grids[x].count = 0;
+			continue;
+		}
+
+		if (level != ClusteSimd::None)
+		{
+			ClusteSimd::CullCluste(level, aabbs[tileIndex], viewLights, scratch.indices);
+		}
+		else
+		{
+			for (int light = 0; light < viewLights.count; light++)
+			{
+				glm::vec3 center = glm::vec3(viewLights.pos_x[light], viewLights.pos_y[light], viewLights.pos_z[light]);
+				if (RawCpu::testSphereAABB(center, viewLights.radius_sq[light], minPointAABB, maxPointAABB) && RawCpu::testLightShape(viewLights, light, minPointAABB, maxPointAABB))
+				{
+					scratch.indices.push_back(viewLights.indices[light]);
+				}
+			}
+		}
+
+		scratch.grids[x].offset = offset;
+		scratch.grids[x].count = (glm::uint)scratch.indices.size() - offset;
+	}
+}
+
+void ClusteCuller::Cull(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow)
+{
+	ClusteLightList output(lightGrids, globalLightIndexList);
+	CullGrid(xSize, ySize, zSize, aabbs, viewLights, ClusteSimd::None, maxLightsPerCluste, output, overflow);
+}
+
+void ClusteCuller::Cull(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow)
+{
+	CullGrid(xSize, ySize, zSize, aabbs, viewLights, ClusteSimd::None, maxLightsPerCluste, output, overflow);
+}
+
+void ClusteCuller::CullSimd(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow)
+{
+	ClusteLightList output(lightGrids, globalLightIndexList);
+	CullGrid(xSize, ySize, zSize, aabbs, viewLights, simd_level, maxLightsPerCluste, output, overflow);
+}
+
+void ClusteCuller::CullSimd(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow)
+{
+	CullGrid(xSize, ySize, zSize, aabbs, viewLights, simd_level, maxLightsPerCluste, output, overflow);
+}
+
+void ClusteCuller::CullGrid(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow)
+{
+	int rowCount = ySize * zSize;
+	if (row_scratchs.size() < (size_t)rowCount)
+		row_scratchs.resize(rowCount);
+	list_grids.resize(xSize * ySize * zSize);
+	CheckActiveGrid(xSize * ySize * zSize);
+
+	/// pass 1: count and collect visible lights per row
+	thread_pool->ParallelFor(rowCount, [&](int row) {
+		CullRow(row, xSize, ySize, aabbs, viewLights, level);
+	});
+
+	/// prefix sum, walk in the same x/y/z order as the serial version so offsets match
+	glm::uint globalIndexCount = 0;
+	overflow.clustes = 0;
+	overflow.lights = 0;
+	for (int x = 0; x < xSize; x++)
+	{
+		for (int y = 0; y < ySize; y++)
+		{
+			for (int z = 0; z < zSize; z++)
+			{
+				glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+				glm::uint count = ClampCount(row_scratchs[y + z * ySize].grids[x].count, maxLightsPerCluste, overflow);
+				list_grids[tileIndex].offset = globalIndexCount;
+				list_grids[tileIndex].count = count;
+				output.SetGrid(tileIndex, globalIndexCount, count);
+				globalIndexCount += count;
+			}
+		}
+	}
+
+	/// pass 2: compact into the global light index list, the output is only written
+	thread_pool->ParallelFor(rowCount, [&](int row) {
+		RowScratch& scratch = row_scratchs[row];
+		int y = row % ySize;
+		int z = row / ySize;
+		for (int x = 0; x < xSize; x++)
+		{
+			glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+			const LightGrid& grid = list_grids[tileIndex];
+			if (grid.count == 0)
+				continue;
+			output.SetLights(grid.offset, scratch.indices.data() + scratch.grids[x].offset, grid.count);
+		}
+	});
+}
+
+void ClusteCuller::CullBitmask(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maskWords, glm::uint* lightMasks)
+{
+	if (viewLights.count > 0 && viewLights.indices[viewLights.count - 1] >= maskWords * 32)
+		throw std::runtime_error("light index out of the cluste bitmask!");
+	level = std::min(level, ClusteSimd::GetBestLevel());
+	CheckActiveGrid(xSize * ySize * zSize);
+
+	/// a row of clusters per task, nothing is shared between clusters
+	thread_pool->ParallelFor(ySize * zSize, [&](int row) {
+		int y = row % ySize;
+		int z = row / ySize;
+		for (int x = 0; x < xSize; x++)
+		{
+			glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+			glm::uint* mask = lightMasks + (size_t)tileIndex * maskWords;
+			memset(mask, 0, maskWords * sizeof(glm::uint));
+			if (IsActive(tileIndex))
+				ClusteSimd::CullClusteMask(level, aabbs[tileIndex], viewLights, mask);
+		}
+	});
+}
+
+void ClusteCuller::UnpackBitmask(int xSize, int ySize, int zSize, glm::uint maskWords, const glm::uint* lightMasks, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow)
+{
+	/// serial x/y/z order like RawCpu::cluste_culling so the offsets match
+	glm::uint globalIndexCount = 0;
+	overflow.clustes = 0;
+	overflow.lights = 0;
+	for (int x = 0; x < xSize; x++)
+	{
+		for (int y = 0; y < ySize; y++)
+		{
+			for (int z = 0; z < zSize; z++)
+			{
+				glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+				const glm::uint* mask = lightMasks + (size_t)tileIndex * maskWords;
+				glm::uint count = 0;
+				glm::uint visibleCount = 0;
+				for (glm::uint word = 0; word < maskWords; word++)
+				{
+					glm::uint bits = mask[word];
+					for (glm::uint bit = 0; bits != 0; bit++, bits >>= 1)
+					{
+						if ((bits & 1) == 0)
+							continue;
+						if (count < maxLightsPerCluste)
+						{
+							output.SetLight(globalIndexCount + count, word * 32 + bit);
+							count++;
+						}
+						visibleCount++;
+					}
+				}
+				ClampCount(visibleCount, maxLightsPerCluste, overflow);
+				output.SetGrid(tileIndex, globalIndexCount, count);
+				globalIndexCount += count;
+			}
+		}
+	}
+}
+
+void ClusteCuller::RefineShapes(int clusteCount, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, const LightGrid* lightGrids, const glm::uint* globalLightIndexList, ClusteLightList& output)
+{
+	glm::uint slotCount = 0;
+	for (int light = 0; light < viewLights.count; light++)
+		slotCount = std::max(slotCount, viewLights.indices[light] + 1);
+	shape_slots.assign(viewLights.shape_count > 0 ? slotCount : 0, -1);
+	for (int light = 0; light < viewLights.count && viewLights.shape_count > 0; light++)
+	{
+		if (viewLights.shapes[light].type != LightType_Point)
+			shape_slots[viewLights.indices[light]] = light;
+	}
+
+	/// every cluste only touches its own list, a kept light never moves past the one it was read from
+	const int chunk = 64;
+	thread_pool->ParallelFor((clusteCount + chunk - 1) / chunk, [&](int task) {
+		int end = std::min((task + 1) * chunk, clusteCount);
+		for (int tileIndex = task * chunk; tileIndex < end; tileIndex++)
+		{
+			LightGrid grid = lightGrids[tileIndex];
+			const glm::uint* lights = globalLightIndexList + grid.offset;
+			glm::vec3 minPointAABB = glm::vec3(aabbs[tileIndex].minPoint);
+			glm::vec3 maxPointAABB = glm::vec3(aabbs[tileIndex].maxPoint);
+			glm::uint count = 0;
+			for (glm::uint i = 0; i < grid.count; i++)
+			{
+				int slot = lights[i] < shape_slots.size() ? shape_slots[lights[i]] : -1;
+				if (slot < 0 || RawCpu::testShapeAABB(viewLights.shapes[slot], minPointAABB, maxPointAABB))
+					output.SetLight(grid.offset + count++, lights[i]);
+			}
+			output.SetGrid(tileIndex, grid.offset, count);
+		}
+	});
+}
+
+void ClusteCuller::GatherBitmaskStats(int clusteCount, glm::uint maskWords, const glm::uint* lightMasks, glm::uint maxLightsPerCluste, ClusteCullStats& stats)
+{
+	std::vector<glm::uint> counts(clusteCount);
+	for (int i = 0; i < clusteCount; i++)
+	{
+		const glm::uint* mask = lightMasks + (size_t)i * maskWords;
+		glm::uint count = 0;
+		for (glm::uint word = 0; word < maskWords; word++)
+		{
+			/// clear the lowest set bit until none is left
+			for (glm::uint bits = mask[word]; bits != 0; bits &= bits - 1)
+				count++;
+		}
+		counts[i] = count;
+	}
+	GatherStats(counts, maxLightsPerCluste, stats);
+
+	/// no cap in the masks, capped counts the clusters a list would clamp
+	stats.indexCount = maskWords * clusteCount;
+}
+
+void ClusteCuller::GatherStats(const std::vector<glm::uint>& counts, glm::uint maxLightsPerCluste, ClusteCullStats& stats)
+{
+	stats.clustes = (glm::uint)counts.size();
+	stats.maxClusteLights = 0;
+	stats.cappedClustes = 0;
+	stats.indexCount = 0;
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		stats.maxClusteLights = std::max(stats.maxClusteLights, counts[i]);
+		stats.indexCount += counts[i];
+		if (counts[i] >= maxLightsPerCluste)
+			stats.cappedClustes++;
+	}
+	stats.avgClusteLights = counts.empty() ? 0.0f : (float)stats.indexCount / counts.size();
+
+	/// counting sort, the counts are bounded by the cap or the light count
+	std::vector<glm::uint> histogram(stats.maxClusteLights + 1, 0);
+	for (size_t i = 0; i < counts.size(); i++)
+		histogram[counts[i]]++;
+	size_t rank = (counts.size() * 95 + 99) / 100;
+	size_t seen = 0;
+	stats.p95ClusteLights = 0;
+	for (glm::uint count = 0; count < histogram.size(); count++)
+	{
+		seen += histogram[count];
+		if (seen >= rank)
+		{
+			stats.p95ClusteLights = count;
+			break;
+		}
+	}
+}
+
+glm::uint ClusteCuller::ClampCount(glm::uint count, glm::uint maxLightsPerCluste, ClusteOverflow& overflow)
+{
+	if (count <= maxLightsPerCluste)
+		return count;
+
+	/// lights are kept in light order, so the first ones win like in the serial version
+	overflow.clustes += 1;
+	overflow.lights += count - maxLightsPerCluste;
+	return maxLightsPerCluste;
+}
+
+void ClusteCuller::BuildAxisBounds(int xSize, int ySize, int zSize)
+{
+	slice_bounds.resize(zSize);
+	column_bounds.resize(zSize * xSize);
+	row_bounds.resize(zSize * ySize);
+
+	std::vector<glm::vec2> extents(std::max(std::max(xSize, ySize), zSize));
+	for (int z = 0; z < zSize; z++)
+	{
+		/// column extents over every row of the slice
+		for (int x = 0; x < xSize; x++)
+		{
+			extents[x] = glm::vec2(FLT_MAX, -FLT_MAX);
+			for (int y = 0; y < ySize; y++)
+			{
+				VolumeTileAABB& aabb = cluste_aabbs[x + y * xSize + z * xSize * ySize];
+				extents[x].x = std::min(extents[x].x, aabb.minPoint.x);
+				extents[x].y = std::max(extents[x].y, aabb.maxPoint.x);
+			}
+		}
+		for (int x = 0; x < xSize; x++)
+			column_bounds[z * xSize + x].x = x == 0 ? extents[x].y : std::max(column_bounds[z * xSize + x - 1].x, extents[x].y);
+		for (int x = xSize - 1; x >= 0; x--)
+			column_bounds[z * xSize + x].y = x == xSize - 1 ? extents[x].x : std::min(column_bounds[z * xSize + x + 1].y, extents[x].x);
+
+		/// row extents over every column of the slice
+		for (int y = 0; y < ySize; y++)
+		{
+			extents[y] = glm::vec2(FLT_MAX, -FLT_MAX);
+			for (int x = 0; x < xSize; x++)
+			{
+				VolumeTileAABB& aabb = cluste_aabbs[x + y * xSize + z * xSize * ySize];
+				extents[y].x = std::min(extents[y].x, aabb.minPoint.y);
+				extents[y].y = std::max(extents[y].y, aabb.maxPoint.y);
+			}
+		}
+		for (int y = 0; y < ySize; y++)
+			row_bounds[z * ySize + y].x = y == 0 ? extents[y].y : std::max(row_bounds[z * ySize + y - 1].x, extents[y].y);
+		for (int y = ySize - 1; y >= 0; y--)
+			row_bounds[z * ySize + y].y = y == ySize - 1 ? extents[y].x : std::min(row_bounds[z * ySize + y + 1].y, extents[y].x);
+	}
+
+	/// slice extents in -z
+	for (int z = 0; z < zSize; z++)
+	{
+		extents[z] = glm::vec2(FLT_MAX, -FLT_MAX);
+		for (int i = 0; i < xSize * ySize; i++)
+		{
+			VolumeTileAABB& aabb = cluste_aabbs[i + z * xSize * ySize];
+			extents[z].x = std::min(extents[z].x, -aabb.maxPoint.z);
+			extents[z].y = std::max(extents[z].y, -aabb.minPoint.z);
+		}
+	}
+	slice_depths.assign(extents.begin(), extents.begin() + zSize);
+	for (int z = 0; z < zSize; z++)
+		slice_bounds[z].x = z == 0 ? extents[z].y : std::max(slice_bounds[z - 1].x, extents[z].y);
+	for (int z = zSize - 1; z >= 0; z--)
+		slice_bounds[z].y = z == zSize - 1 ? extents[z].x : std::min(slice_bounds[z + 1].y, extents[z].x);
+}
+
+void ClusteCuller::AxisRange(const glm::vec2* bounds, int count, float minValue, float maxValue, int& first, int& last)
+{
+	/// first index whose prefix max reaches minValue, every index before lies fully below the range
+	int lo = 0, hi = count;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (bounds[mid].x < minValue)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	first = lo;
+
+	/// last index whose suffix min stays under maxValue, every index after lies fully above the range
+	lo = 0, hi = count;
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (bounds[mid].y <= maxValue)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	last = lo - 1;
+}
+
+void ClusteCuller::CullSlice(int z, int xSize, int ySize, ViewSpaceLights& viewLights)
+{
+	int sliceBase = z * xSize * ySize;
+	for (int i = 0; i < xSize * ySize; i++)
+		cluste_lights[sliceBase + i].clear();
+
+	std::vector<glm::uint>& lights = slice_lights[z];
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		int light = lights[i];
+		glm::vec3 center = glm::vec3(viewLights.pos_x[light], viewLights.pos_y[light], viewLights.pos_z[light]);
+		float radius = sqrtf(viewLights.radius_sq[light]);
+
+		/// widen a little so rounding never rejects a cluste the fine test would accept
+		float padX = radius + (fabsf(center.x) + radius) * 1e-5f;
+		float padY = radius + (fabsf(center.y) + radius) * 1e-5f;
+
+		int x0, x1, y0, y1;
+		AxisRange(&column_bounds[z * xSize], xSize, center.x - padX, center.x + padX, x0, x1);
+		AxisRange(&row_bounds[z * ySize], ySize, center.y - padY, center.y + padY, y0, y1);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				glm::uint tileIndex = sliceBase + x + y * xSize;
+				if (!IsActive(tileIndex))
+					continue;
+				glm::vec3 minPointAABB = glm::vec3(cluste_aabbs[tileIndex].minPoint);
+				glm::vec3 maxPointAABB = glm::vec3(cluste_aabbs[tileIndex].maxPoint);
+				if (RawCpu::testSphereAABB(center, viewLights.radius_sq[light], minPointAABB, maxPointAABB) && RawCpu::testLightShape(viewLights, light, minPointAABB, maxPointAABB))
+				{
+					cluste_lights[tileIndex].push_back(viewLights.indices[light]);
+				}
+			}
+		}
+	}
+}
+
+void ClusteCuller::CullLightCentric(int xSize, int ySize, int zSize, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow)
+{
+	ClusteLightList output(lightGrids, globalLightIndexList);
+	CullLightCentric(xSize, ySize, zSize, viewLights, maxLightsPerCluste, output, overflow);
+}
+
+void ClusteCuller::CullLightCentric(int xSize, int ySize, int zSize, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow)
+{
+	int clusteCount = xSize * ySize * zSize;
+	if (slice_lights.size() < (size_t)zSize)
+		slice_lights.resize(zSize);
+	if (cluste_lights.size() < (size_t)clusteCount)
+		cluste_lights.resize(clusteCount);
+	list_grids.resize(clusteCount);
+	CheckActiveGrid(clusteCount);
+
+	/// bin lights by z slice range, in light order so every cluste list stays sorted
+	for (int z = 0; z < zSize; z++)
+		slice_lights[z].clear();
+	for (int light = 0; light < viewLights.count; light++)
+	{
+		float radius = sqrtf(viewLights.radius_sq[light]);
+		float depth = -viewLights.pos_z[light];
+		float padZ = radius + (fabsf(depth) + radius) * 1e-5f;
+
+		int z0, z1;
+		AxisRange(slice_bounds.data(), zSize, depth - padZ, depth + padZ, z0, z1);
+		for (int z = z0; z <= z1; z++)
+			slice_lights[z].push_back(light);
+	}
+
+	/// fine sphere-aabb test inside each light's range, a slice owns its clusters so no locking
+	thread_pool->ParallelFor(zSize, [&](int z) {
+		CullSlice(z, xSize, ySize, viewLights);
+	});
+
+	/// prefix sum in the serial x/y/z order
+	glm::uint globalIndexCount = 0;
+	overflow.clustes = 0;
+	overflow.lights = 0;
+	for (int x = 0; x < xSize; x++)
+	{
+		for (int y = 0; y < ySize; y++)
+		{
+			for (int z = 0; z < zSize; z++)
+			{
+				glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
+				glm::uint count = ClampCount((glm::uint)cluste_lights[tileIndex].size(), maxLightsPerCluste, overflow);
+				list_grids[tileIndex].offset = globalIndexCount;
+				list_grids[tileIndex].count = count;
+				output.SetGrid(tileIndex, globalIndexCount, count);
+				globalIndexCount += count;
+			}
+		}
+	}
+
+	/// the output is only written
+	thread_pool->ParallelFor(zSize, [&](int z) {
+		for (int i = 0; i < xSize * ySize; i++)
+		{
+			glm::uint tileIndex = i + z * xSize * ySize;
+			const LightGrid& grid = list_grids[tileIndex];
+			if (grid.count > 0)
+				output.SetLights(grid.offset, cluste_lights[tileIndex].data(), grid.count);
+		}
+	});
+}
+
+void ClusteCuller::ClearDirty()
+{
+	is_all_dirty = false;
+	incremental_valid = false;
+	dirty_lights.clear();
+}
+
+void ClusteCuller::MarkSphereClustes(const glm::vec4& sphere, int xSize, int ySize, int zSize)
+{
+	if (sphere.w < 0)
+		return;
+
+	/// same padded ranges as CullLightCentric, a cluste outside them can never pass the fine test
+	glm::vec3 center = glm::vec3(sphere);
+	float radius = sqrtf(sphere.w);
+	float depth = -center.z;
+	float padX = radius + (fabsf(center.x) + radius) * 1e-5f;
+	float padY = radius + (fabsf(center.y) + radius) * 1e-5f;
+	float padZ = radius + (fabsf(depth) + radius) * 1e-5f;
+
+	int z0, z1;
+	AxisRange(slice_bounds.data(), zSize, depth - padZ, depth + padZ, z0, z1);
+	for (int z = z0; z <= z1; z++)
+	{
+		int x0, x1, y0, y1;
+		AxisRange(&column_bounds[z * xSize], xSize, center.x - padX, center.x + padX, x0, x1);
+		AxisRange(&row_bounds[z * ySize], ySize, center.y - padY, center.y + padY, y0, y1);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++)
+			{
+				int tileIndex = x + y * xSize + z * xSize * ySize;
+				if (cluste_dirty[tileIndex] == 0)
+				{
+					cluste_dirty[tileIndex] = 1;
+					dirty_clustes.push_back(tileIndex);
+				}
+			}
+		}
+	}
+}
+
+void ClusteCuller::UpdateLightSpheres(ViewSpaceLights& viewLights, bool isAll)
+{
+	if (isAll)
+	{
+		light_spheres.clear();
+		if (viewLights.count > 0)
+			light_spheres.resize(viewLights.indices[viewLights.count - 1] + 1, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+		for (int i = 0; i < viewLights.count; i++)
+			light_spheres[viewLights.indices[i]] = glm::vec4(viewLights.pos_x[i], viewLights.pos_y[i], viewLights.pos_z[i], viewLights.radius_sq[i]);
+		return;
+	}
+
+	/// view lights are in light order, find each dirty light with a binary search
+	glm::uint* first = viewLights.indices.data();
+	glm::uint* last = first + viewLights.count;
+	for (size_t i = 0; i < dirty_lights.size(); i++)
+	{
+		glm::uint light = dirty_lights[i];
+		if (light >= light_spheres.size())
+			light_spheres.resize(light + 1, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+		glm::uint* it = std::lower_bound(first, last, light);
+		if (it != last && *it == light)
+		{
+			int slot = (int)(it - first);
+			light_spheres[light] = glm::vec4(viewLights.pos_x[slot], viewLights.pos_y[slot], viewLights.pos_z[slot], viewLights.radius_sq[slot]);
+		}
+		else
+		{
+			light_spheres[light].w = -1.0f;
+		}
+	}
+}
+
+int ClusteCuller::CullIncremental(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow, int outputSlot)
+{
+	ClusteLightList output(lightGrids, globalLightIndexList);
+	return CullIncremental(xSize, ySize, zSize, aabbs, viewLights, level, maxLightsPerCluste, output, overflow, outputSlot);
+}
+
+int ClusteCuller::CullIncremental(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow, int outputSlot)
+{
+	int clusteCount = xSize * ySize * zSize;
+	level = std::min(level, ClusteSimd::GetBestLevel());
+	CheckActiveGrid(clusteCount);
+	bool isAll = is_all_dirty || !incremental_valid || incremental_lists.size() != (size_t)clusteCount;
+
+	dirty_clustes.clear();
+	if (isAll)
+	{
+		incremental_lists.resize(clusteCount);
+		incremental_grids.resize(clusteCount);
+		cluste_dirty.assign(clusteCount, 1);
+		for (int i = 0; i < clusteCount; i++)
+			dirty_clustes.push_back(i);
+		UpdateLightSpheres(viewLights, true);
+	}
+	else
+	{
+		/// clusters under the sphere of the last cull lose the light, clusters under the new one gain it
+		cluste_dirty.assign(clusteCount, 0);
+		for (size_t i = 0; i < dirty_lights.size(); i++)
+		{
+			if (dirty_lights[i] < light_spheres.size())
+				MarkSphereClustes(light_spheres[dirty_lights[i]], xSize, ySize, zSize);
+		}
+		UpdateLightSpheres(viewLights, false);
+		for (size_t i = 0; i < dirty_lights.size(); i++)
+			MarkSphereClustes(light_spheres[dirty_lights[i]], xSize, ySize, zSize);
+	}
+
+	/// re-test the dirty clusters against every light, in light order like Cull
+	int testCount = (int)dirty_clustes.size();
+	thread_pool->ParallelFor(testCount, [&](int i) {
+		int tileIndex = dirty_clustes[i];
+		incremental_lists[tileIndex].clear();
+		if (IsActive(tileIndex))
+			ClusteSimd::CullCluste(level, aabbs[tileIndex], viewLights, incremental_lists[tileIndex]);
+	});
+
+	/// prefix sum in the serial x/y/z order, clusters whose offset or count moved have to be rewritten too
+	glm::uint globalIndexCount = 0;
+	overflow.clustes = 0;
+	overflow.lights = 0;
+	for (int x = 0; x < xSize; x++)
+	{
+		for (int y = 0; y < ySize; y++)
+		{
+			for (int z = 0; z < zSize; z++)
+			{
+				int tileIndex = x + y * xSize + z * xSize * ySize;
+				glm::uint count = ClampCount((glm::uint)incremental_lists[tileIndex].size(), maxLightsPerCluste, overflow);
+				LightGrid& grid = incremental_grids[tileIndex];
+				if (cluste_dirty[tileIndex] != 0 || grid.offset != globalIndexCount || grid.count != count)
+				{
+					grid.offset = globalIndexCount;
+					grid.count = count;
+					if (cluste_dirty[tileIndex] == 0)
+					{
+						cluste_dirty[tileIndex] = 1;
+						dirty_clustes.push_back(tileIndex);
+					}
+				}
+				globalIndexCount += count;
+			}
+		}
+	}
+
+	/// a slot that missed some calls also needs the clusters those calls changed
+	incremental_serial++;
+	if (isAll)
+		cluste_serials.assign(clusteCount, incremental_serial);
+	for (size_t i = 0; i < dirty_clustes.size(); i++)
+		cluste_serials[dirty_clustes[i]] = incremental_serial;
+	if ((size_t)outputSlot >= slot_serials.size())
+		slot_serials.resize(outputSlot + 1, 0);
+	if (slot_serials[outputSlot] + 1 != incremental_serial)
+	{
+		for (int i = 0; i < clusteCount; i++)
+		{
+			if (cluste_dirty[i] == 0 && cluste_serials[i] > slot_serials[outputSlot])
+				dirty_clustes.push_back(i);
+		}
+	}
+	slot_serials[outputSlot] = incremental_serial;
+	written_clustes = (glm::uint)dirty_clustes.size();
+	written_indices = 0;
+	for (size_t i = 0; i < dirty_clustes.size(); i++)
+		written_indices += incremental_grids[dirty_clustes[i]].count;
+
+	thread_pool->ParallelFor((int)dirty_clustes.size(), [&](int i) {
+		int tileIndex = dirty_clustes[i];
+		LightGrid& grid = incremental_grids[tileIndex];
+		output.SetGrid(tileIndex, grid.offset, grid.count);
+		if (grid.count > 0)
+			output.SetLights(grid.offset, incremental_lists[tileIndex].data(), grid.count);
+	});
+
+	is_all_dirty = false;
+	incremental_valid = true;
+	dirty_lights.clear();
+	return testCount;
+}
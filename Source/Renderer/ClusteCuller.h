@@ -0,0 +1,171 @@
+#ifndef __CLUSTE_CULLER_H__
+#define __CLUSTE_CULLER_H__
+
+#include <vector>
+#include <algorithm>
+
+#include "ClusteData.h"
+#include "ClusteSimd.h"
+
+class ThreadPool;
+
+/// multi-thread cpu cluste culling, output is bit-identical to RawCpu::cluste_culling
+class ClusteCuller
+{
+public:
+	ClusteCuller(ThreadPool* pool);
+	virtual ~ClusteCuller();
+
+	/// rebuild the cached cluste aabbs only when projection, screen size or grid changed
+	VolumeTileAABB* UpdateAABBs(int xSize, int ySize, int zSize, ScreenToView& screenToView, unsigned int projectVersion);
+	void InvalidateAABBs() { aabb_valid = false; }
+
+	/// view space lights shared by all cpu culling paths, once per frame after UpdateAABBs.
+	/// lights outside the frustum of viewProject are left out, with tile depths also the lights that only reach
+	/// clusters with no geometry of the last frame in them. with lightShapes every test starts from the tight bounding sphere
+	/// of the light and spot and area lights are also tested with their cone or box
+	ViewSpaceLights* UpdateViewLights(ScreenToView& screenToView, PointLightData* pointLights, int lightCount, const glm::mat4* viewProject = NULL, const LightShapeData* lightShapes = NULL);
+	int GetRejectedLightCount() { return rejected_light_count; }	/// enabled lights left out by the last UpdateViewLights
+
+	/// min and max view depth of every screen tile from a 0..1 float depth buffer, rows top down
+	void UpdateTileDepths(const float* depths, int width, int height, int tileSize, ScreenToView& screenToView);
+	void ClearTileDepths();
+
+	/// marks the clusters a pixel of a 0..1 float depth buffer falls into, the cull paths of this class then only test
+	/// and write those, every other cluste gets no lights
+	void UpdateActiveClustes(const float* depths, int width, int height, int tileSize, ScreenToView& screenToView);
+	void ClearActiveClustes();
+	/// one flag per cluste of the cached aabb grid, NULL when every cluste is culled
+	const unsigned char* GetActiveFlags();
+	const std::vector<int>& GetActiveClustes() { return active_clustes; }	/// ascending cluste indices, for debugging
+
+	/// at most maxLightsPerCluste lights are written per cluste, the dropped ones are counted in overflow.
+	/// every cull also takes a ClusteLightList to write the compact format
+	void Cull(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow);
+	void Cull(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow);
+
+	/// same as Cull with the sphere-aabb tests done by the simd level, output is bit-identical to Cull
+	void CullSimd(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow);
+	void CullSimd(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow);
+	ClusteSimd::Level GetSimdLevel() { return simd_level; }
+	void SetSimdLevel(ClusteSimd::Level level) { simd_level = std::min(level, ClusteSimd::GetBestLevel()); }	/// never above what the cpu has
+
+	/// light-centric culling, every light only visits the clusters inside its tile rect and z slice range,
+	/// works on the aabbs of the last UpdateAABBs, output is bit-identical to Cull
+	void CullLightCentric(int xSize, int ySize, int zSize, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow);
+	void CullLightCentric(int xSize, int ySize, int zSize, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow);
+
+	/// bitmask output, maskWords words per cluste with one bit per light slot, lightMasks holds clusteCount * maskWords.
+	/// no light cap and no prefix sum, every cluste is filled on its own
+	void CullBitmask(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maskWords, glm::uint* lightMasks);
+	static glm::uint GetMaskWords(int lightCount) { return (glm::uint)(lightCount + 31) / 32; }
+	/// light lists of the first maxLightsPerCluste set bits, the same output as the capped list culls
+	static void UnpackBitmask(int xSize, int ySize, int zSize, glm::uint maskWords, const glm::uint* lightMasks, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow);
+
+	/// drops spot and area lights whose cone or box misses the cluste from lists culled with spheres only, like the ispc ones.
+	/// the sphere lists are read from host memory and only written to the output, counts shrink, offsets stay.
+	/// the output may be the sphere lists themselves
+	void RefineShapes(int clusteCount, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, const LightGrid* lightGrids, const glm::uint* globalLightIndexList, ClusteLightList& output);
+
+	/// stats of the per cluste light counts of a list output, like the ClusteLightList counts copy, upload bytes are left to the caller
+	static void GatherStats(const std::vector<glm::uint>& counts, glm::uint maxLightsPerCluste, ClusteCullStats& stats);
+	static void GatherBitmaskStats(int clusteCount, glm::uint maskWords, const glm::uint* lightMasks, glm::uint maxLightsPerCluste, ClusteCullStats& stats);
+
+	/// dirty tracking for CullIncremental, lights are PointLightData slots
+	void MarkAllDirty() { is_all_dirty = true; }
+	void MarkLightDirty(glm::uint light) { dirty_lights.push_back(light); }
+	bool IsDirty() { return is_all_dirty || !dirty_lights.empty(); }
+	/// another cull wrote the light grid, drop the dirty state and rebuild everything on the next CullIncremental
+	void ClearDirty();
+
+	/// keeps the unclamped light list of every cluste between frames and only re-tests the clusters inside the old
+	/// or new bounds of a dirty light, everything when all dirty, output is bit-identical to Cull.
+	/// the output must still hold what the last call with the same outputSlot wrote in the same format, a slot skipped by
+	/// some calls also gets the clusters those calls changed, so one output per frame in flight works. returns the re-tested cluste count
+	int CullIncremental(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow, int outputSlot = 0);
+	int CullIncremental(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow, int outputSlot = 0);
+	/// grids and light indices the last CullIncremental wrote
+	void GetIncrementalWrites(glm::uint& clustes, glm::uint& indices) { clustes = written_clustes; indices = written_indices; }
+
+private:
+	/// one task is a row of clusters along x with the same y and z
+	struct RowScratch
+	{
+		std::vector<glm::uint> indices;	/// visible lights of all clusters in the row
+		std::vector<LightGrid> grids;	/// offset is local to indices
+	};
+
+	void CullGrid(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow);
+	void CullRow(int row, int xSize, int ySize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteSimd::Level level);
+
+	static glm::uint ClampCount(glm::uint count, glm::uint maxLightsPerCluste, ClusteOverflow& overflow);
+
+	void BuildAxisBounds(int xSize, int ySize, int zSize);
+	static void AxisRange(const glm::vec2* bounds, int count, float minValue, float maxValue, int& first, int& last);
+	void CullSlice(int z, int xSize, int ySize, ViewSpaceLights& viewLights);
+
+	void MarkSphereClustes(const glm::vec4& sphere, int xSize, int ySize, int zSize);
+	bool IsLightInDepth(ViewSpaceLights& viewLights, int light);
+	void RejectDepthLights(ViewSpaceLights& viewLights);
+	bool IsActive(int tileIndex) { return active_flags.empty() || active_flags[tileIndex] != 0; }	/// only valid inside the cull calls
+	void CheckActiveGrid(int clusteCount);
+	void UpdateLightSpheres(ViewSpaceLights& viewLights, bool isAll);
+
+private:
+	ThreadPool* thread_pool;
+
+	std::vector<RowScratch> row_scratchs;
+	std::vector<LightGrid> list_grids;	/// offset and clamped count of every cluste, the mapped output is slow to read
+	ClusteSimd::Level simd_level;
+
+	/// cluste aabb cache
+	std::vector<VolumeTileAABB> cluste_aabbs;
+	bool aabb_valid;
+	unsigned int aabb_project_version;
+	glm::uvec2 aabb_screen_dimensions;
+	glm::uvec4 aabb_tile_sizes;
+
+	/// conservative axis bounds of the cached aabbs, x is prefix max of the max side, y is suffix min of the min side,
+	/// both are monotonic so a light range is two binary searches
+	std::vector<glm::vec2> slice_bounds;	/// along z, in -z so it grows with the slice index
+	std::vector<glm::vec2> column_bounds;	/// along x, per slice
+	std::vector<glm::vec2> row_bounds;	/// along y, per slice
+	std::vector<glm::vec2> slice_depths;	/// -z extents of each slice
+
+	/// view depth range per screen tile of the last frame, empty when not used
+	std::vector<glm::vec2> tile_depths;
+	std::vector<glm::vec2> tile_depth_scratch;	/// raw 0..1 depth range
+	glm::uvec2 tile_depth_size;
+	std::vector<unsigned char> light_keeps;
+	int rejected_light_count;
+
+	/// clusters with geometry of the last frame, empty when not used
+	std::vector<unsigned char> active_flags;
+	std::vector<int> active_clustes;
+	std::vector<unsigned char> active_scratch;
+	std::vector<float> slice_edges;	/// 0..1 depth just before and after each inner slice border, pairs
+
+	/// light-centric scratch
+	std::vector<std::vector<glm::uint> > slice_lights;	/// view light indices touching each slice, in light order
+	std::vector<std::vector<glm::uint> > cluste_lights;	/// visible lights of each cluste
+
+	ViewSpaceLights view_lights;
+	std::vector<int> shape_slots;	/// light index -> view light of a spot or area light, -1 for the rest
+
+	/// incremental state
+	bool is_all_dirty;
+	bool incremental_valid;	/// incremental_lists and incremental_grids match the light grid buffers
+	std::vector<glm::uint> dirty_lights;
+	std::vector<glm::vec4> light_spheres;	/// view space center and radius^2 of each light at the last cull, w < 0 when it was not a view light
+	std::vector<std::vector<glm::uint> > incremental_lists;	/// unclamped visible lights of each cluste
+	std::vector<LightGrid> incremental_grids;	/// copy of the written light grids, the mapped buffer is slow to read
+	std::vector<unsigned char> cluste_dirty;
+	std::vector<int> dirty_clustes;
+	unsigned int incremental_serial;	/// bumped by every CullIncremental
+	std::vector<unsigned int> cluste_serials;	/// serial of the call that last changed each cluste
+	std::vector<unsigned int> slot_serials;	/// serial of the call that last wrote each output slot, 0 never
+	glm::uint written_clustes;
+	glm::uint written_indices;
+};
+
+#endif // !__CLUSTE_CULLER_H__
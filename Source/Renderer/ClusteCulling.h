@@ -57,19 +57,189 @@ namespace RawCpu
 		return sqDist;
 	}
 
-	static bool testSphereAABB(ScreenToView& screenToView, glm::vec3& pos, float radius, glm::vec3& minPoint, glm::vec3& maxPoint)
+	static bool testSphereAABB(glm::vec3& center, float radiusSq, glm::vec3& minPoint, glm::vec3& maxPoint)
 	{
-		glm::vec3 center = glm::vec3(screenToView.viewMatrix*glm::vec4(pos, 1.0f));
 		float squaredDistance = sqDistPointAABB(center, minPoint, maxPoint);
 
-		bool ret = (squaredDistance <= (radius * radius));
+		bool ret = (squaredDistance <= radiusSq);
 		return ret;
 	}
 
-	static void cluste_culling(int xSize, int ySize, int zSize, ScreenToView& screenToView, PointLightData* pointLights, int lightCount, LightGrid* lightGrids, glm::uint* globalLightIndexList)
+	/// world space planes of a view project matrix with 0..1 depth, xyz normalized and pointing inside
+	static void frustum_planes(const glm::mat4& viewProject, glm::vec4* planes)
 	{
-		int globalIndexCount = 0;
+		glm::vec4 row[4];
+		for (int i = 0; i < 4; i++)
+			row[i] = glm::vec4(viewProject[0][i], viewProject[1][i], viewProject[2][i], viewProject[3][i]);
+
+		planes[0] = row[3] + row[0];	/// left
+		planes[1] = row[3] - row[0];	/// right
+		planes[2] = row[3] + row[1];	/// top, y is flipped by the clip matrix, the pair is symmetric anyway
+		planes[3] = row[3] - row[1];	/// bottom
+		planes[4] = row[2];	/// near
+		planes[5] = row[3] - row[2];	/// far
+		for (int i = 0; i < 6; i++)
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+
+	static bool testSphereFrustum(const glm::vec4* planes, glm::vec3& center, float radius)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	/// sphere around everything a light reaches, a spot cone needs much less than its radius sphere
+	static void light_bounds(const PointLightData& light, LightShapeData& shape)
+	{
+		shape.bound_center = light.pos;
+		shape.bound_radius = light.radius;
+		if (shape.type == LightType_Spot && shape.spot_cos_outer > 0.0f)
+		{
+			float cosAngle = std::min(shape.spot_cos_outer, 1.0f);
+			if (cosAngle >= 0.70710678f)
+			{
+				/// narrow cone, the sphere through the apex and the rim of the cap
+				shape.bound_radius = light.radius / (2.0f * cosAngle);
+				shape.bound_center = light.pos + shape.direction * shape.bound_radius;
+			}
+			else
+			{
+				/// wide cone, the sphere on the rim circle holds the apex and the cap too
+				shape.bound_radius = light.radius * sqrtf(1.0f - cosAngle * cosAngle);
+				shape.bound_center = light.pos + shape.direction * (light.radius * cosAngle);
+			}
+		}
+		else if (shape.type == LightType_Area)
+		{
+			shape.bound_radius = light.radius + sqrtf(shape.area_half_width * shape.area_half_width + shape.area_half_height * shape.area_half_height);
+		}
+	}
+
+	static void view_space_shape(const glm::mat4& viewMatrix, const PointLightData& light, const LightShapeData& shape, LightCullShape& cullShape)
+	{
+		glm::vec3 origin = glm::vec3(viewMatrix * glm::vec4(light.pos, 1.0f));
+		glm::vec3 direction = glm::vec3(viewMatrix * glm::vec4(shape.direction, 0.0f));
+		cullShape.type = shape.type;
+		cullShape.range = light.radius;
+		cullShape.cos_angle = std::min(shape.spot_cos_outer, 1.0f);
+		cullShape.sin_angle = sqrtf(std::max(1.0f - cullShape.cos_angle * cullShape.cos_angle, 0.0f));
+		if (shape.type == LightType_Spot)
+		{
+			cullShape.origin = origin;
+			cullShape.axes[0] = direction;
+			cullShape.axes[1] = glm::vec3(0.0f);
+			cullShape.axes[2] = glm::vec3(0.0f);
+		}
+		else
+		{
+			/// box from the rectangle to the radius in front of it
+			glm::vec3 tangent = glm::vec3(viewMatrix * glm::vec4(shape.tangent, 0.0f));
+			cullShape.origin = origin + direction * (light.radius * 0.5f);
+			cullShape.axes[0] = tangent * (shape.area_half_width + light.radius);
+			cullShape.axes[1] = glm::cross(direction, tangent) * (shape.area_half_height + light.radius);
+			cullShape.axes[2] = direction * (light.radius * 0.5f);
+		}
+	}
+
+	/// cone or box of a light against a cluste, only called once the bounding sphere touches the aabb
+	static bool testShapeAABB(const LightCullShape& shape, const glm::vec3& minPoint, const glm::vec3& maxPoint)
+	{
+		glm::vec3 center = (minPoint + maxPoint) * 0.5f;
+		glm::vec3 extent = (maxPoint - minPoint) * 0.5f;
+		if (shape.type == LightType_Spot)
+		{
+			glm::vec3 origin = shape.origin;
+			glm::vec3 aabbMin = minPoint, aabbMax = maxPoint;
+			if (sqDistPointAABB(origin, aabbMin, aabbMax) > shape.range * shape.range)
+				return false;
+			/// a cone wider than a half space is not convex, the radius sphere is all there is
+			if (shape.cos_angle <= 0.0f)
+				return true;
+
+			/// distance of the aabb's bounding sphere center to the cone surface, negative inside
+			float sphereRadius = glm::length(extent);
+			glm::vec3 v = center - shape.origin;
+			float axial = glm::dot(v, shape.axes[0]);
+			float lateral = sqrtf(std::max(glm::dot(v, v) - axial * axial, 0.0f));
+			return shape.cos_angle * lateral - shape.sin_angle * axial <= sphereRadius && axial >= -sphereRadius;
+		}
+		if (shape.type == LightType_Area)
+		{
+			/// separating axes of both boxes, without the edge cross axes it only errs on keeping the light
+			glm::vec3 d = center - shape.origin;
+			for (int i = 0; i < 3; i++)
+			{
+				float boxExtent = fabsf(shape.axes[0][i]) + fabsf(shape.axes[1][i]) + fabsf(shape.axes[2][i]);
+				if (fabsf(d[i]) > extent[i] + boxExtent)
+					return false;
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				/// axes are scaled by the half extents, both sides of the compare are scaled by the axis length
+				const glm::vec3& axis = shape.axes[i];
+				float aabbExtent = extent.x * fabsf(axis.x) + extent.y * fabsf(axis.y) + extent.z * fabsf(axis.z);
+				if (fabsf(glm::dot(d, axis)) > aabbExtent + glm::dot(axis, axis))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	/// shape test of view light slot light, true for point lights
+	static bool testLightShape(const ViewSpaceLights& viewLights, int light, const glm::vec3& minPoint, const glm::vec3& maxPoint)
+	{
+		return viewLights.shape_count == 0 || viewLights.shapes[light].type == LightType_Point || testShapeAABB(viewLights.shapes[light], minPoint, maxPoint);
+	}
+
+	/// transform enabled lights to view space once per frame, lights fully outside frustumPlanes are left out,
+	/// with lightShapes the bounding spheres are the ones of the shapes and spot and area lights get their cone or box
+	static void view_space_lights(ScreenToView& screenToView, PointLightData* pointLights, int lightCount, ViewSpaceLights& viewLights, const glm::vec4* frustumPlanes = NULL,
+		const LightShapeData* lightShapes = NULL)
+	{
+		viewLights.pos_x.resize(lightCount);
+		viewLights.pos_y.resize(lightCount);
+		viewLights.pos_z.resize(lightCount);
+		viewLights.radius_sq.resize(lightCount);
+		viewLights.indices.resize(lightCount);
+		if (lightShapes != NULL)
+			viewLights.shapes.resize(lightCount);
 
+		int count = 0;
+		int shapeCount = 0;
+		for (int light = 0; light < lightCount; light++)
+		{
+			glm::vec3 pos = lightShapes != NULL ? lightShapes[light].bound_center : pointLights[light].pos;
+			float radius = lightShapes != NULL ? lightShapes[light].bound_radius : pointLights[light].radius;
+			if (pointLights[light].enabled == 1 && (frustumPlanes == NULL || testSphereFrustum(frustumPlanes, pos, radius)))
+			{
+				glm::vec3 center = glm::vec3(screenToView.viewMatrix * glm::vec4(pos, 1.0f));
+				viewLights.pos_x[count] = center.x;
+				viewLights.pos_y[count] = center.y;
+				viewLights.pos_z[count] = center.z;
+				viewLights.radius_sq[count] = radius * radius;
+				viewLights.indices[count] = light;
+				if (lightShapes != NULL)
+				{
+					viewLights.shapes[count].type = LightType_Point;
+					if (lightShapes[light].type != LightType_Point)
+					{
+						view_space_shape(screenToView.viewMatrix, pointLights[light], lightShapes[light], viewLights.shapes[count]);
+						shapeCount++;
+					}
+				}
+				count++;
+			}
+		}
+		viewLights.count = count;
+		viewLights.shape_count = shapeCount;
+	}
+
+	static void cluste_aabb(int x, int y, int z, int zSize, ScreenToView& screenToView, glm::vec3& minPointAABB, glm::vec3& maxPointAABB)
+	{
 		//Eye position is zero in view space
 		glm::vec3 eyePos = glm::vec3(0.0);
 		float zNear = screenToView.zNear;
@@ -77,65 +247,112 @@ namespace RawCpu
 
 		//Per Tile variables
 		float tileSizePx = screenToView.tileSizes[3];
-		for (int x = 0; x < xSize; x++)
+
+		//Calculating the min and max point in screen space
+		glm::vec4 maxPoint_sS = glm::vec4(glm::vec2(x + 1, y + 1) * tileSizePx, -1.0, 1.0); // Top Right
+		glm::vec4 minPoint_sS = glm::vec4(glm::vec2(x, y) * tileSizePx, -1.0, 1.0); // Bottom left
+
+		//Pass min and max to view space
+		glm::vec3 maxPoint_vS = glm::vec3(screen2View(maxPoint_sS, screenToView));
+		glm::vec3 minPoint_vS = glm::vec3(screen2View(minPoint_sS, screenToView));
+
+		//Near and far values of the cluster in view space
+		float tileNear = -zNear * pow(zFar / zNear, (float)z / zSize);
+		float tileFar = -zNear * pow(zFar / zNear, (float)(z + 1) / zSize);
+
+		//Finding the 4 intersection points made from the maxPoint to the cluster near/far plane
+		glm::vec3 minPointNear = lineIntersectionToZPlane(eyePos, minPoint_vS, tileNear);
+		glm::vec3 minPointFar = lineIntersectionToZPlane(eyePos, minPoint_vS, tileFar);
+		glm::vec3 maxPointNear = lineIntersectionToZPlane(eyePos, maxPoint_vS, tileNear);
+		glm::vec3 maxPointFar = lineIntersectionToZPlane(eyePos, maxPoint_vS, tileFar);
+
+		minPointAABB = glm::min<3, float>(glm::min<3, float>(minPointNear, minPointFar), glm::min<3, float>(maxPointNear, maxPointFar));
+		maxPointAABB = glm::max<3, float>(glm::max<3, float>(minPointNear, minPointFar), glm::max<3, float>(maxPointNear, maxPointFar));
+	}
+
+	/// aabbs only depend on projection, screen size and near/far, build once and reuse across frames
+	static void cluste_aabbs(int xSize, int ySize, int zSize, ScreenToView& screenToView, VolumeTileAABB* aabbs)
+	{
+		for (int z = 0; z < zSize; z++)
 		{
 			for (int y = 0; y < ySize; y++)
 			{
-				for (int z = 0; z < zSize; z++)
+				for (int x = 0; x < xSize; x++)
 				{
 					glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
 
-					//Calculating the min and max point in screen space
-					glm::vec4 maxPoint_sS = glm::vec4(glm::vec2(x + 1, y + 1) * tileSizePx, -1.0, 1.0); // Top Right
-					glm::vec4 minPoint_sS = glm::vec4(glm::vec2(x, y) * tileSizePx, -1.0, 1.0); // Bottom left
-
-					//Pass min and max to view space
-					glm::vec3 maxPoint_vS = glm::vec3(screen2View(maxPoint_sS, screenToView));
-					glm::vec3 minPoint_vS = glm::vec3(screen2View(minPoint_sS, screenToView));
+					glm::vec3 minPointAABB, maxPointAABB;
+					cluste_aabb(x, y, z, zSize, screenToView, minPointAABB, maxPointAABB);
+					aabbs[tileIndex].minPoint = glm::vec4(minPointAABB, 0.0f);
+					aabbs[tileIndex].maxPoint = glm::vec4(maxPointAABB, 0.0f);
+				}
+			}
+		}
+	}
 
-					//Near and far values of the cluster in view space
-					float tileNear = -zNear * pow(zFar / zNear, (float)z / zSize);
-					float tileFar = -zNear * pow(zFar / zNear, (float)(z + 1) / zSize);
+	/// with activeClustes only the clusters with a non-zero flag get lights
+	static void cluste_culling(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, ClusteLightList& output, ClusteOverflow& overflow,
+		const unsigned char* activeClustes = NULL)
+	{
+		int globalIndexCount = 0;
+		overflow.clustes = 0;
+		overflow.lights = 0;
 
-					//Finding the 4 intersection points made from the maxPoint to the cluster near/far plane
-					glm::vec3 minPointNear = lineIntersectionToZPlane(eyePos, minPoint_vS, tileNear);
-					glm::vec3 minPointFar = lineIntersectionToZPlane(eyePos, minPoint_vS, tileFar);
-					glm::vec3 maxPointNear = lineIntersectionToZPlane(eyePos, maxPoint_vS, tileNear);
-					glm::vec3 maxPointFar = lineIntersectionToZPlane(eyePos, maxPoint_vS, tileFar);
+		for (int x = 0; x < xSize; x++)
+		{
+			for (int y = 0; y < ySize; y++)
+			{
+				for (int z = 0; z < zSize; z++)
+				{
+					glm::uint tileIndex = x + y * xSize + z * xSize * ySize;
 
-					glm::vec3 minPointAABB = glm::min<3, float>(glm::min<3, float>(minPointNear, minPointFar), glm::min<3, float>(maxPointNear, maxPointFar));
-					glm::vec3 maxPointAABB = glm::max<3, float>(glm::max<3, float>(minPointNear, minPointFar), glm::max<3, float>(maxPointNear, maxPointFar));
+					glm::vec3 minPointAABB = glm::vec3(aabbs[tileIndex].minPoint);
+					glm::vec3 maxPointAABB = glm::vec3(aabbs[tileIndex].maxPoint);
 
-					glm::uint visibleLightIndices[100];
+					/// write straight into the global list, the offset is known before the light loop
+					glm::uint offset = globalIndexCount;
 					glm::uint visibleLightCount = 0;
+					glm::uint droppedLightCount = 0;
+					int lightCount = activeClustes == NULL || activeClustes[tileIndex] != 0 ? viewLights.count : 0;
 
 					for (int light = 0; light < lightCount; light++)
 					{
-						if (pointLights[light].enabled == 1)
+						glm::vec3 center = glm::vec3(viewLights.pos_x[light], viewLights.pos_y[light], viewLights.pos_z[light]);
+						if (testSphereAABB(center, viewLights.radius_sq[light], minPointAABB, maxPointAABB) && testLightShape(viewLights, light, minPointAABB, maxPointAABB))
 						{
-							if (testSphereAABB(screenToView, pointLights[light].pos, pointLights[light].radius, minPointAABB, maxPointAABB))
+							if (visibleLightCount < maxLightsPerCluste)
 							{
-								visibleLightIndices[visibleLightCount] = light;
+								output.SetLight(offset + visibleLightCount, viewLights.indices[light]);
 								visibleLightCount += 1;
 							}
+							else
+							{
+								droppedLightCount += 1;
+							}
 						}
 					}
 
 					///glm::uint offset = atomic_add_global(&globalIndexCount, visibleLightCount);
-					glm::uint offset = globalIndexCount;
 					globalIndexCount += visibleLightCount;
 
-					for (glm::uint i = 0; i < visibleLightCount; ++i)
+					if (droppedLightCount > 0)
 					{
-						globalLightIndexList[offset + i] = visibleLightIndices[i];
+						overflow.clustes += 1;
+						overflow.lights += droppedLightCount;
 					}
 
-					lightGrids[tileIndex].offset = offset;
-					lightGrids[tileIndex].count = visibleLightCount;
+					output.SetGrid(tileIndex, offset, visibleLightCount);
 				}
 			}
 		}
 	}
+
+	static void cluste_culling(int xSize, int ySize, int zSize, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste, LightGrid* lightGrids, glm::uint* globalLightIndexList, ClusteOverflow& overflow,
+		const unsigned char* activeClustes = NULL)
+	{
+		ClusteLightList output(lightGrids, globalLightIndexList);
+		cluste_culling(xSize, ySize, zSize, aabbs, viewLights, maxLightsPerCluste, output, overflow, activeClustes);
+	}
 }
 
 #endif // !__CLUSTE_CULLING_H__
@@ -0,0 +1,236 @@
+#ifndef __CLUSTE_DATA_H__
+#define __CLUSTE_DATA_H__
+
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "GLMConfig.h"
+
+#define DEFAULT_CLUSTE_LIGHT_CAP 128	/// max visible lights of one cluste, the rest is counted as overflow
+#define CLUSTE_X 16	/// default grid, vulkan can change it at runtime
+#define CLUSTE_Y 9
+#define CLUSTE_Z 24
+#define CLUSTE_NUM (CLUSTE_X * CLUSTE_Y * CLUSTE_Z)
+#define CLUSTE_CULL_GROUP_SIZE 128	/// threads per group of cluste_culling.comp
+#define GPU_CLUSTE_LIGHT_CAP 128	/// per thread light list of cluste_culling.comp, the gpu cull clamps the cap to it
+
+/// light structure for shader
+struct PointLightData {
+	glm::vec3 pos;
+	float radius;
+	glm::vec3 color;
+	glm::uint enabled;
+	float ambient_intensity;
+	float diffuse_intensity;
+	float specular_intensity;
+	float attenuation_constant;
+	float attenuation_linear;
+	float attenuation_exp;
+	glm::vec2 padding;
+};
+
+/// kind of a light, LightShapeData::type
+enum ClusteLightType
+{
+	LightType_Point = 0,
+	LightType_Spot = 1,	/// cone of the outer angle, cut at the radius
+	LightType_Area = 2,	/// one-sided rectangle, lights what is within the radius in front of it
+};
+
+/// shape of a light, a second buffer next to the PointLightData one so shaders built before it still read their lights
+struct LightShapeData {
+	glm::vec3 bound_center;	/// world space sphere around everything the light reaches, the sphere tests use it
+	float bound_radius;
+	glm::vec3 direction;	/// spot axis or area light normal, unit length
+	glm::uint type;
+	glm::vec3 tangent;	/// area light width axis, unit length
+	float spot_cos_outer;
+	float spot_cos_inner;
+	float area_half_width;
+	float area_half_height;
+	float padding;
+};
+
+/// view space cone or box of a spot or area light, tested after its bounding sphere
+struct LightCullShape {
+	glm::uint type;
+	float range;	/// spot radius
+	float cos_angle;	/// spot outer angle
+	float sin_angle;
+	glm::vec3 origin;	/// spot apex, area box center
+	glm::vec3 axes[3];	/// spot axis in axes[0], area box axes scaled by the half extents
+};
+
+/// view space lights for cpu culling, enabled lights only, structure of arrays
+struct ViewSpaceLights {
+	std::vector<float> pos_x;
+	std::vector<float> pos_y;
+	std::vector<float> pos_z;
+	std::vector<float> radius_sq;
+	std::vector<glm::uint> indices;	/// index into light_infos
+	std::vector<LightCullShape> shapes;	/// same slots as pos_x, only read when shape_count is not 0
+	int count;
+	int shape_count;	/// spot and area lights among the view lights
+};
+
+/// lights dropped by the per cluste light cap
+struct ClusteOverflow {
+	glm::uint clustes;	/// clusters that hit the cap
+	glm::uint lights;	/// visible lights not written
+};
+
+/// counters of the compute culling pass
+struct ClusteCullCounter {
+	glm::uint globalIndexCount;
+	glm::uint maxLightsPerCluste;
+	ClusteOverflow overflow;
+};
+
+/// result of comparing one culling output against a reference
+struct ClusteValidation {
+	glm::uint clustes;	/// compared clusters
+	glm::uint mismatchClustes;	/// clusters with at least one light beyond the tolerance
+	glm::uint missingLights;	/// in the reference only, beyond the tolerance
+	glm::uint extraLights;	/// in the tested output only, beyond the tolerance
+	glm::uint boundaryLights;	/// differences within the tolerance, sphere just touching the aabb
+	glm::uint cappedClustes;	/// clusters at the light cap, the kept subset may differ
+	float maxBoundaryError;	/// largest tolerated error, relative to the light radius
+	int firstMismatch;	/// cluste index, -1 when there is none
+};
+
+/// light and cluste occupancy of one culled frame, sizes the buffers and tells when the gpu cull pays off
+struct ClusteCullStats {
+	glm::uint lightCount;	/// light slots in use
+	glm::uint activeLights;	/// lights left after the frustum and depth rejection, the ones culled
+	glm::uint clustes;
+	float avgClusteLights;
+	glm::uint maxClusteLights;
+	glm::uint p95ClusteLights;
+	glm::uint cappedClustes;	/// clusters at the light cap or above it
+	glm::uint indexCount;	/// light index list length, mask words for bitmasks
+	glm::uint uploadBytes;	/// light grid and index bytes the cpu wrote for the gpu, 0 when the cull was skipped
+};
+
+/// cluste AABB
+struct VolumeTileAABB {
+	glm::vec4 minPoint;
+	glm::vec4 maxPoint;
+};
+
+/// screen to view for cluste calculate
+struct ScreenToView
+{
+	glm::mat4 inverseProjection;
+	glm::mat4 viewMatrix;
+	glm::uvec4 tileSizes;
+	glm::uvec2 screenDimensions;
+	float zNear;
+	float zFar;
+};
+
+/// light grid
+struct LightGrid {
+	glm::uint offset;
+	glm::uint count;
+};
+
+/// light list layout the fragment shader decodes
+enum ClusteLightFormat
+{
+	LightFormat_List = 0,	/// LightGrid and 32-bit light indices
+	LightFormat_Compact = 1,	/// packed LightGrid and 16-bit light indices
+	LightFormat_Bitmask = 2,	/// a bit per light slot in every cluste, the index buffer holds the masks and the grid is unused
+};
+
+/// compact light list, offset and count of a cluste packed in one word and 16-bit light indices,
+/// tinyobj.frag decodes both from uint arrays
+#define CLUSTE_PACKED_COUNT_BITS 12
+#define CLUSTE_PACKED_OFFSET_BITS (32 - CLUSTE_PACKED_COUNT_BITS)
+#define CLUSTE_PACKED_MAX_COUNT ((1u << CLUSTE_PACKED_COUNT_BITS) - 1)
+#define CLUSTE_PACKED_MAX_OFFSET ((1u << CLUSTE_PACKED_OFFSET_BITS) - 1)
+#define CLUSTE_PACKED_MAX_LIGHTS 0x10000	/// light slots a 16-bit index reaches
+
+/// where a cull writes its light grid and global light index list, 32-bit or compact
+struct ClusteLightList {
+	ClusteLightList() : isCompact(false), grids(NULL), indices(NULL), counts(NULL) {}
+	ClusteLightList(LightGrid* lightGrids, glm::uint* globalLightIndexList) : isCompact(false), grids(lightGrids), indices(globalLightIndexList), counts(NULL) {}
+	ClusteLightList(glm::uint* packedGrids, unsigned short* globalLightIndexList) : isCompact(true), grids(packedGrids), indices(globalLightIndexList), counts(NULL) {}
+
+	/// offset in the low bits, count in the high bits
+	static glm::uint Pack(glm::uint offset, glm::uint count) { return offset | (count << CLUSTE_PACKED_OFFSET_BITS); }
+
+	void SetGrid(glm::uint tileIndex, glm::uint offset, glm::uint count)
+	{
+		if (counts != NULL)
+			counts[tileIndex] = count;
+		if (isCompact)
+		{
+			((glm::uint*)grids)[tileIndex] = Pack(offset, count);
+		}
+		else
+		{
+			((LightGrid*)grids)[tileIndex].offset = offset;
+			((LightGrid*)grids)[tileIndex].count = count;
+		}
+	}
+
+	LightGrid GetGrid(glm::uint tileIndex) const
+	{
+		if (!isCompact)
+			return ((LightGrid*)grids)[tileIndex];
+		glm::uint packed = ((glm::uint*)grids)[tileIndex];
+		LightGrid grid = { packed & CLUSTE_PACKED_MAX_OFFSET, packed >> CLUSTE_PACKED_OFFSET_BITS };
+		return grid;
+	}
+
+	void SetLight(glm::uint slot, glm::uint light)
+	{
+		if (isCompact)
+			((unsigned short*)indices)[slot] = (unsigned short)light;
+		else
+			((glm::uint*)indices)[slot] = light;
+	}
+
+	glm::uint GetLight(glm::uint slot) const
+	{
+		return isCompact ? ((unsigned short*)indices)[slot] : ((glm::uint*)indices)[slot];
+	}
+
+	void SetLights(glm::uint offset, const glm::uint* lights, glm::uint count)
+	{
+		if (!isCompact)
+		{
+			memcpy((glm::uint*)indices + offset, lights, count * sizeof(glm::uint));
+			return;
+		}
+		unsigned short* dst = (unsigned short*)indices + offset;
+		for (glm::uint i = 0; i < count; i++)
+			dst[i] = (unsigned short)lights[i];
+	}
+
+	size_t GetGridSize() const { return isCompact ? sizeof(glm::uint) : sizeof(LightGrid); }
+	size_t GetIndexSize() const { return isCompact ? sizeof(unsigned short) : sizeof(glm::uint); }
+
+	/// 32-bit copy for the validator and the benchmark histogram
+	void Unpack(int clusteCount, std::vector<LightGrid>& lightGrids, std::vector<glm::uint>& globalLightIndexList) const
+	{
+		lightGrids.resize(clusteCount);
+		glm::uint indexCount = 0;
+		for (int i = 0; i < clusteCount; i++)
+		{
+			lightGrids[i] = GetGrid(i);
+			indexCount = std::max(indexCount, lightGrids[i].offset + lightGrids[i].count);
+		}
+		globalLightIndexList.resize(indexCount);
+		for (glm::uint i = 0; i < indexCount; i++)
+			globalLightIndexList[i] = GetLight(i);
+	}
+
+	bool isCompact;
+	void* grids;
+	void* indices;
+	glm::uint* counts;	/// host copy of every count SetGrid writes, NULL for none, the grids may be slow to read
+};
+
+#endif // !__CLUSTE_DATA_H__
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include "ClusteGridTuner.h"
+
+/// candidate grids, in pixels per tile and depth slices
+static const unsigned int TILE_SIZES[] = { 32, 48, 64, 80, 96, 128, 160, 192, 240 };
+static const unsigned int Z_SLICES[] = { 8, 12, 16, 24, 32, 48, 64 };
+static const int TILE_SIZE_NUM = sizeof(TILE_SIZES) / sizeof(TILE_SIZES[0]);
+static const int Z_SLICE_NUM = sizeof(Z_SLICES) / sizeof(Z_SLICES[0]);
+
+static const int WARMUP_FRAMES = 8;	/// skip the frames right after a switch, buffers were just rebuilt
+static const int SAMPLE_FRAMES = 32;
+static const double MIN_GAIN = 0.02;	/// a neighbour has to be 2% faster to win, avoids chasing noise
+
+ClusteGridTuner::ClusteGridTuner()
+{
+	Reset(0, 0, 0);
+	Restart();
+}
+
+ClusteGridTuner::~ClusteGridTuner()
+{
+}
+
+void ClusteGridTuner::GuessGrid(int width, int height, int lightCount, unsigned int& tileSize, unsigned int& zSlices)
+{
+	/// 16x9 tiles on screen, smaller tiles when lights get dense so each cluste keeps a short list
+	float density = sqrtf((float)lightCount / 256.0f);
+	density = std::min(std::max(density, 1.0f), 4.0f);
+	float tile = (float)height / 9.0f / density;
+	tileSize = TILE_SIZES[NearestIndex(TILE_SIZES, TILE_SIZE_NUM, (unsigned int)tile)];
+
+	if (lightCount > 1024)
+		zSlices = 48;
+	else if (lightCount > 256)
+		zSlices = 32;
+	else
+		zSlices = 24;
+}
+
+int ClusteGridTuner::NearestIndex(const unsigned int* values, int count, unsigned int value)
+{
+	int nearest = 0;
+	for (int i = 1; i < count; i++)
+	{
+		if (abs((int)values[i] - (int)value) < abs((int)values[nearest] - (int)value))
+			nearest = i;
+	}
+	return nearest;
+}
+
+void ClusteGridTuner::Reset(int w, int h, int lightCount)
+{
+	width = w;
+	height = h;
+	light_count = lightCount;
+
+	unsigned int tileSize, zSlices;
+	GuessGrid(w, h, lightCount, tileSize, zSlices);
+	best_tile_idx = NearestIndex(TILE_SIZES, TILE_SIZE_NUM, tileSize);
+	best_slice_idx = NearestIndex(Z_SLICES, Z_SLICE_NUM, zSlices);
+	best_cost = 0;
+
+	costs.clear();
+	pending.clear();
+	is_converged = false;
+	StartMeasure(best_tile_idx, best_slice_idx);
+}
+
+void ClusteGridTuner::StartMeasure(int tileIdx, int sliceIdx)
+{
+	tile_idx = tileIdx;
+	slice_idx = sliceIdx;
+	frame_count = 0;
+	sample_count = 0;
+	frame_sum = 0;
+	cull_sum = 0;
+}
+
+void ClusteGridTuner::PushNeighbours(double cullShare)
+{
+	/// culling heavy frames try coarser grids first, shading heavy ones finer grids first
+	static const int coarser[2][2] = { { 1, 0 }, { 0, -1 } };
+	static const int finer[2][2] = { { -1, 0 }, { 0, 1 } };
+	const int (*order[2])[2] = { coarser, finer };
+	if (cullShare <= 0.5)
+		std::swap(order[0], order[1]);
+
+	pending.clear();
+	for (int i = 0; i < 2; i++)
+	{
+		for (int n = 0; n < 2; n++)
+		{
+			int t = best_tile_idx + order[i][n][0];
+			int z = best_slice_idx + order[i][n][1];
+			if (t < 0 || t >= TILE_SIZE_NUM || z < 0 || z >= Z_SLICE_NUM)
+				continue;
+			int key = t * 256 + z;
+			if (costs.find(key) == costs.end())
+				pending.push_back(key);
+		}
+	}
+
+	/// pending is popped from the back
+	std::reverse(pending.begin(), pending.end());
+}
+
+bool ClusteGridTuner::Update(int w, int h, int lightCount, double frameMs, double cullMs, unsigned int& tileSize, unsigned int& zSlices)
+{
+	if (w != width || h != height || lightCount != light_count)
+	{
+		Reset(w, h, lightCount);
+		tileSize = TILE_SIZES[tile_idx];
+		zSlices = Z_SLICES[slice_idx];
+		return true;
+	}
+
+	if (is_converged)
+		return false;
+
+	frame_count++;
+	if (frame_count <= WARMUP_FRAMES)
+		return false;
+
+	frame_sum += frameMs;
+	cull_sum += cullMs;
+	sample_count++;
+	if (sample_count < SAMPLE_FRAMES)
+		return false;
+
+	double cost = frame_sum / sample_count;
+	double cullShare = frame_sum > 0 ? cull_sum / frame_sum : 0;
+	costs[tile_idx * 256 + slice_idx] = cost;
+
+	bool isBest = tile_idx == best_tile_idx && slice_idx == best_slice_idx;
+	if (isBest)
+	{
+		best_cost = cost;
+		PushNeighbours(cullShare);
+	}
+	else if (cost < best_cost * (1.0 - MIN_GAIN))
+	{
+		best_tile_idx = tile_idx;
+		best_slice_idx = slice_idx;
+		best_cost = cost;
+		PushNeighbours(cullShare);
+	}
+
+	if (pending.empty())
+	{
+		/// nothing around the best grid is faster, stay on it
+		is_converged = true;
+		if (isBest)
+			return false;
+		StartMeasure(best_tile_idx, best_slice_idx);
+	}
+	else
+	{
+		int key = pending.back();
+		pending.pop_back();
+		StartMeasure(key / 256, key % 256);
+	}
+
+	tileSize = TILE_SIZES[tile_idx];
+	zSlices = Z_SLICES[slice_idx];
+	return true;
+}
@@ -0,0 +1,54 @@
+#ifndef __CLUSTE_GRID_TUNER_H__
+#define __CLUSTE_GRID_TUNER_H__
+
+#include <map>
+#include <vector>
+
+/// picks the cluste tile size and z slice count, starts from a guess by resolution and light density,
+/// then walks to the neighbour grid with the lowest measured frame time until nothing is better
+class ClusteGridTuner
+{
+public:
+	ClusteGridTuner();
+	virtual ~ClusteGridTuner();
+
+	/// first grid for a resolution and light count, snapped to the candidate lists
+	static void GuessGrid(int width, int height, int lightCount, unsigned int& tileSize, unsigned int& zSlices);
+
+	/// the next Update starts over from the guess
+	void Restart() { width = -1; }
+
+	/// feed one frame, resets itself when resolution or light count changed,
+	/// returns true when the grid should switch to tileSize and zSlices
+	bool Update(int width, int height, int lightCount, double frameMs, double cullMs, unsigned int& tileSize, unsigned int& zSlices);
+
+	bool IsConverged() { return is_converged; }
+
+private:
+	void Reset(int width, int height, int lightCount);
+	static int NearestIndex(const unsigned int* values, int count, unsigned int value);
+	void PushNeighbours(double cullShare);
+	void StartMeasure(int tileIdx, int sliceIdx);
+
+private:
+	int width;
+	int height;
+	int light_count;
+
+	int tile_idx;	/// grid being measured
+	int slice_idx;
+	int best_tile_idx;
+	int best_slice_idx;
+	double best_cost;
+
+	int frame_count;	/// frames since the last switch
+	int sample_count;
+	double frame_sum;
+	double cull_sum;
+
+	std::map<int, double> costs;	/// measured frame ms per grid, key is tile_idx * 256 + slice_idx
+	std::vector<int> pending;	/// grids still to measure around the best one
+	bool is_converged;
+};
+
+#endif // !__CLUSTE_GRID_TUNER_H__
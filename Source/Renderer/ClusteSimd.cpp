@@ -0,0 +1,344 @@
+#include <math.h>
+
+#include "ClusteSimd.h"
+#include "ClusteCulling.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CLUSTE_SIMD_X86
+#endif
+
+#ifdef CLUSTE_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+/// msvc takes intrinsics of any isa anywhere, gcc and clang need the target on the function.
+/// no fp contraction, a fused multiply-add would round differently from the scalar test
+#if defined(__GNUC__) && !defined(__clang__)
+#define SIMD_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#elif defined(__clang__)
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#pragma clang fp contract(off)
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+namespace ClusteSimd
+{
+	static const char* LEVEL_NAMES[] = { "Scalar", "SSE2", "AVX2", "AVX-512" };
+	static const int LEVEL_LANES[] = { 1, 4, 8, 16 };
+
+	static inline bool TestLight(const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, int light)
+	{
+		/// same steps as RawCpu::sqDistPointAABB
+		float sqDist = 0.0f;
+		float point[3] = { viewLights.pos_x[light], viewLights.pos_y[light], viewLights.pos_z[light] };
+		for (int i = 0; i < 3; i++)
+		{
+			float v = point[i];
+			if (v < aabb.minPoint[i])
+				sqDist += (aabb.minPoint[i] - v) * (aabb.minPoint[i] - v);
+			if (v > aabb.maxPoint[i])
+				sqDist += (v - aabb.maxPoint[i]) * (v - aabb.maxPoint[i]);
+		}
+		return sqDist <= viewLights.radius_sq[light];
+	}
+
+	/// appends visible lights to a light list
+	struct ListSink
+	{
+		ListSink(const ViewSpaceLights& _viewLights, std::vector<glm::uint>& _indices) : viewLights(_viewLights), indices(_indices) {}
+		void Add(int light) { indices.push_back(viewLights.indices[light]); }
+		void AddMask(unsigned int mask, int first);
+		const ViewSpaceLights& viewLights;
+		std::vector<glm::uint>& indices;
+	};
+
+	/// sets the bit of every visible light in a cluste bitmask
+	struct MaskSink
+	{
+		MaskSink(const ViewSpaceLights& _viewLights, glm::uint* _words) : viewLights(_viewLights), words(_words) {}
+		void Add(int light) { glm::uint idx = viewLights.indices[light]; words[idx >> 5] |= 1u << (idx & 31); }
+		void AddMask(unsigned int mask, int first);
+		const ViewSpaceLights& viewLights;
+		glm::uint* words;
+	};
+
+	template<class Sink>
+	static void CullClusteScalar(int first, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, Sink& sink)
+	{
+		glm::vec3 minPoint = glm::vec3(aabb.minPoint);
+		glm::vec3 maxPoint = glm::vec3(aabb.maxPoint);
+		for (int light = first; light < viewLights.count; light++)
+		{
+			if (TestLight(aabb, viewLights, light) && RawCpu::testLightShape(viewLights, light, minPoint, maxPoint))
+				sink.Add(light);
+		}
+	}
+
+#ifdef CLUSTE_SIMD_X86
+	static inline int FirstBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return (int)idx;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	/// clears the lanes of spot and area lights whose cone or box misses the cluste, the sphere test passed them
+	static unsigned int ShapeMask(const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, unsigned int mask, int first)
+	{
+		glm::vec3 minPoint = glm::vec3(aabb.minPoint);
+		glm::vec3 maxPoint = glm::vec3(aabb.maxPoint);
+		unsigned int bits = mask;
+		while (bits != 0)
+		{
+			int lane = FirstBit(bits);
+			bits &= bits - 1;
+			if (!RawCpu::testLightShape(viewLights, first + lane, minPoint, maxPoint))
+				mask &= ~(1u << lane);
+		}
+		return mask;
+	}
+
+	/// lights of the set bits, lowest bit first to keep the light order
+	inline void ListSink::AddMask(unsigned int mask, int first)
+	{
+		while (mask != 0)
+		{
+			indices.push_back(viewLights.indices[first + FirstBit(mask)]);
+			mask &= mask - 1;
+		}
+	}
+
+	static inline int LastBit(unsigned int mask)
+	{
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanReverse(&idx, mask);
+		return (int)idx;
+#else
+		return 31 - __builtin_clz(mask);
+#endif
+	}
+
+	inline void MaskSink::AddMask(unsigned int mask, int first)
+	{
+		if (mask == 0)
+			return;
+
+		/// indices ascend, when the lanes up to the last hit are consecutive light slots the lane mask is or-ed in shifted
+		const glm::uint* indices = viewLights.indices.data() + first;
+		int last = LastBit(mask);
+		if (indices[last] - indices[0] == (glm::uint)last)
+		{
+			glm::uint word = indices[0] >> 5;
+			unsigned long long bits = (unsigned long long)mask << (indices[0] & 31);
+			words[word] |= (glm::uint)bits;
+			if ((bits >> 32) != 0)
+				words[word + 1] |= (glm::uint)(bits >> 32);
+			return;
+		}
+
+		while (mask != 0)
+		{
+			Add(first + FirstBit(mask));
+			mask &= mask - 1;
+		}
+	}
+
+	static void CpuId(int info[4], int leaf, int subLeaf)
+	{
+#ifdef _MSC_VER
+		__cpuidex(info, leaf, subLeaf);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(leaf, subLeaf, a, b, c, d);
+		info[0] = (int)a; info[1] = (int)b; info[2] = (int)c; info[3] = (int)d;
+#endif
+	}
+
+	static unsigned long long XGetBv()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((unsigned long long)hi << 32) | lo;
+#endif
+	}
+
+	static Level DetectLevel()
+	{
+		int info[4];
+		CpuId(info, 0, 0);
+		int maxLeaf = info[0];
+
+		CpuId(info, 1, 0);
+		if ((info[3] & (1 << 26)) == 0)
+			return None;
+
+		/// the os has to save the ymm/zmm registers too
+		bool isOsXSave = (info[2] & (1 << 27)) != 0;
+		bool isAvx = (info[2] & (1 << 28)) != 0;
+		if (!isOsXSave || !isAvx || maxLeaf < 7)
+			return SSE2;
+		unsigned long long xcr0 = XGetBv();
+		if ((xcr0 & 0x6) != 0x6)
+			return SSE2;
+
+		CpuId(info, 7, 0);
+		bool isAvx2 = (info[1] & (1 << 5)) != 0;
+		bool isAvx512f = (info[1] & (1 << 16)) != 0;
+		if (isAvx512f && (xcr0 & 0xe6) == 0xe6)
+			return AVX512;
+		if (isAvx2)
+			return AVX2;
+		return SSE2;
+	}
+
+	template<class Sink>
+	SIMD_TARGET("sse2") static void CullClusteSSE2(const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, Sink& sink)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 minX = _mm_set1_ps(aabb.minPoint.x), minY = _mm_set1_ps(aabb.minPoint.y), minZ = _mm_set1_ps(aabb.minPoint.z);
+		const __m128 maxX = _mm_set1_ps(aabb.maxPoint.x), maxY = _mm_set1_ps(aabb.maxPoint.y), maxZ = _mm_set1_ps(aabb.maxPoint.z);
+
+		int light = 0;
+		for (; light + 4 <= viewLights.count; light += 4)
+		{
+			/// only one side of an axis is non-zero, adding the zero side changes nothing
+			__m128 p = _mm_loadu_ps(viewLights.pos_x.data() + light);
+			__m128 d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, p), zero), _mm_max_ps(_mm_sub_ps(p, maxX), zero));
+			__m128 sqDist = _mm_mul_ps(d, d);
+			p = _mm_loadu_ps(viewLights.pos_y.data() + light);
+			d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, p), zero), _mm_max_ps(_mm_sub_ps(p, maxY), zero));
+			sqDist = _mm_add_ps(sqDist, _mm_mul_ps(d, d));
+			p = _mm_loadu_ps(viewLights.pos_z.data() + light);
+			d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, p), zero), _mm_max_ps(_mm_sub_ps(p, maxZ), zero));
+			sqDist = _mm_add_ps(sqDist, _mm_mul_ps(d, d));
+
+			__m128 radiusSq = _mm_loadu_ps(viewLights.radius_sq.data() + light);
+			unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_cmple_ps(sqDist, radiusSq));
+			if (viewLights.shape_count > 0)
+				mask = ShapeMask(aabb, viewLights, mask, light);
+			sink.AddMask(mask, light);
+		}
+		CullClusteScalar(light, aabb, viewLights, sink);
+	}
+
+	template<class Sink>
+	SIMD_TARGET("avx2") static void CullClusteAVX2(const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, Sink& sink)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 minX = _mm256_set1_ps(aabb.minPoint.x), minY = _mm256_set1_ps(aabb.minPoint.y), minZ = _mm256_set1_ps(aabb.minPoint.z);
+		const __m256 maxX = _mm256_set1_ps(aabb.maxPoint.x), maxY = _mm256_set1_ps(aabb.maxPoint.y), maxZ = _mm256_set1_ps(aabb.maxPoint.z);
+
+		int light = 0;
+		for (; light + 8 <= viewLights.count; light += 8)
+		{
+			__m256 p = _mm256_loadu_ps(viewLights.pos_x.data() + light);
+			__m256 d = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minX, p), zero), _mm256_max_ps(_mm256_sub_ps(p, maxX), zero));
+			__m256 sqDist = _mm256_mul_ps(d, d);
+			p = _mm256_loadu_ps(viewLights.pos_y.data() + light);
+			d = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minY, p), zero), _mm256_max_ps(_mm256_sub_ps(p, maxY), zero));
+			sqDist = _mm256_add_ps(sqDist, _mm256_mul_ps(d, d));
+			p = _mm256_loadu_ps(viewLights.pos_z.data() + light);
+			d = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minZ, p), zero), _mm256_max_ps(_mm256_sub_ps(p, maxZ), zero));
+			sqDist = _mm256_add_ps(sqDist, _mm256_mul_ps(d, d));
+
+			__m256 radiusSq = _mm256_loadu_ps(viewLights.radius_sq.data() + light);
+			unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(sqDist, radiusSq, _CMP_LE_OQ));
+			if (viewLights.shape_count > 0)
+				mask = ShapeMask(aabb, viewLights, mask, light);
+			sink.AddMask(mask, light);
+		}
+		CullClusteScalar(light, aabb, viewLights, sink);
+	}
+
+	template<class Sink>
+	SIMD_TARGET("avx512f") static void CullClusteAVX512(const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, Sink& sink)
+	{
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 minX = _mm512_set1_ps(aabb.minPoint.x), minY = _mm512_set1_ps(aabb.minPoint.y), minZ = _mm512_set1_ps(aabb.minPoint.z);
+		const __m512 maxX = _mm512_set1_ps(aabb.maxPoint.x), maxY = _mm512_set1_ps(aabb.maxPoint.y), maxZ = _mm512_set1_ps(aabb.maxPoint.z);
+
+		int light = 0;
+		for (; light + 16 <= viewLights.count; light += 16)
+		{
+			__m512 p = _mm512_loadu_ps(viewLights.pos_x.data() + light);
+			__m512 d = _mm512_add_ps(_mm512_max_ps(_mm512_sub_ps(minX, p), zero), _mm512_max_ps(_mm512_sub_ps(p, maxX), zero));
+			__m512 sqDist = _mm512_mul_ps(d, d);
+			p = _mm512_loadu_ps(viewLights.pos_y.data() + light);
+			d = _mm512_add_ps(_mm512_max_ps(_mm512_sub_ps(minY, p), zero), _mm512_max_ps(_mm512_sub_ps(p, maxY), zero));
+			sqDist = _mm512_add_ps(sqDist, _mm512_mul_ps(d, d));
+			p = _mm512_loadu_ps(viewLights.pos_z.data() + light);
+			d = _mm512_add_ps(_mm512_max_ps(_mm512_sub_ps(minZ, p), zero), _mm512_max_ps(_mm512_sub_ps(p, maxZ), zero));
+			sqDist = _mm512_add_ps(sqDist, _mm512_mul_ps(d, d));
+
+			__m512 radiusSq = _mm512_loadu_ps(viewLights.radius_sq.data() + light);
+			unsigned int mask = (unsigned int)_mm512_cmp_ps_mask(sqDist, radiusSq, _CMP_LE_OQ);
+			if (viewLights.shape_count > 0)
+				mask = ShapeMask(aabb, viewLights, mask, light);
+			sink.AddMask(mask, light);
+		}
+		CullClusteScalar(light, aabb, viewLights, sink);
+	}
+#endif
+
+	Level GetBestLevel()
+	{
+#ifdef CLUSTE_SIMD_X86
+		static Level bestLevel = DetectLevel();
+		return bestLevel;
+#else
+		return None;
+#endif
+	}
+
+	const char* GetLevelName(Level level)
+	{
+		return LEVEL_NAMES[level];
+	}
+
+	int GetLaneCount(Level level)
+	{
+		return LEVEL_LANES[level];
+	}
+
+	template<class Sink>
+	static void CullClusteLevel(Level level, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, Sink& sink)
+	{
+#ifdef CLUSTE_SIMD_X86
+		if (level == AVX512)
+			CullClusteAVX512(aabb, viewLights, sink);
+		else if (level == AVX2)
+			CullClusteAVX2(aabb, viewLights, sink);
+		else if (level == SSE2)
+			CullClusteSSE2(aabb, viewLights, sink);
+		else
+#endif
+			CullClusteScalar(0, aabb, viewLights, sink);
+	}
+
+	void CullCluste(Level level, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, std::vector<glm::uint>& indices)
+	{
+		ListSink sink(viewLights, indices);
+		CullClusteLevel(level, aabb, viewLights, sink);
+	}
+
+	void CullClusteMask(Level level, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, glm::uint* lightMask)
+	{
+		MaskSink sink(viewLights, lightMask);
+		CullClusteLevel(level, aabb, viewLights, sink);
+	}
+};
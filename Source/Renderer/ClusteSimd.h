@@ -0,0 +1,32 @@
+#ifndef __CLUSTE_SIMD_H__
+#define __CLUSTE_SIMD_H__
+
+#include <vector>
+
+#include "ClusteData.h"
+
+/// sphere-aabb tests of 4/8/16 view lights at once with sse2/avx2/avx-512 intrinsics, picked by cpuid,
+/// output order and float math match RawCpu::testSphereAABB so results stay bit-identical,
+/// spot and area lights that pass get the scalar RawCpu::testLightShape
+namespace ClusteSimd
+{
+	enum Level
+	{
+		None = 0,	/// scalar, also the only level on non-x86 cpus
+		SSE2 = 1,
+		AVX2 = 2,
+		AVX512 = 3,
+	};
+
+	/// best level of this cpu and os, cpuid runs once
+	Level GetBestLevel();
+	const char* GetLevelName(Level level);
+	int GetLaneCount(Level level);
+
+	/// appends the visible lights of one cluste in light order, level must not be above GetBestLevel
+	void CullCluste(Level level, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, std::vector<glm::uint>& indices);
+	/// ors the bit of every visible light index into lightMask, one bit per light slot
+	void CullClusteMask(Level level, const VolumeTileAABB& aabb, const ViewSpaceLights& viewLights, glm::uint* lightMask);
+};
+
+#endif // !__CLUSTE_SIMD_H__
@@ -0,0 +1,122 @@
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+
+#include "ClusteValidator.h"
+#include "ClusteCulling.h"
+
+ClusteValidator::ClusteValidator(float tolerance)
+	:tolerance(tolerance)
+{
+}
+
+ClusteValidator::~ClusteValidator()
+{
+}
+
+void ClusteValidator::BuildViewLightSlots(ViewSpaceLights& viewLights)
+{
+	view_light_slots.clear();
+	for (int i = 0; i < viewLights.count; i++)
+	{
+		glm::uint light = viewLights.indices[i];
+		if (light >= view_light_slots.size())
+			view_light_slots.resize(light + 1, -1);
+		view_light_slots[light] = i;
+	}
+}
+
+float ClusteValidator::GetBoundaryError(VolumeTileAABB& aabb, ViewSpaceLights& viewLights, glm::uint light)
+{
+	if (light >= view_light_slots.size() || view_light_slots[light] < 0)
+		return FLT_MAX;
+
+	int slot = view_light_slots[light];
+	glm::vec3 center = glm::vec3(viewLights.pos_x[slot], viewLights.pos_y[slot], viewLights.pos_z[slot]);
+	glm::vec3 minPoint = glm::vec3(aabb.minPoint);
+	glm::vec3 maxPoint = glm::vec3(aabb.maxPoint);
+	float radius = sqrtf(viewLights.radius_sq[slot]);
+	if (radius <= 0)
+		return FLT_MAX;
+	return (sqrtf(RawCpu::sqDistPointAABB(center, minPoint, maxPoint)) - radius) / radius;
+}
+
+void ClusteValidator::Compare(int clusteCount, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste,
+	LightGrid* refGrids, glm::uint* refIndices, LightGrid* grids, glm::uint* indices, ClusteValidation& result)
+{
+	memset(&result, 0, sizeof(ClusteValidation));
+	result.clustes = clusteCount;
+	result.firstMismatch = -1;
+	BuildViewLightSlots(viewLights);
+
+	for (int i = 0; i < clusteCount; i++)
+	{
+		ref_list.assign(refIndices + refGrids[i].offset, refIndices + refGrids[i].offset + refGrids[i].count);
+		test_list.assign(indices + grids[i].offset, indices + grids[i].offset + grids[i].count);
+		std::sort(ref_list.begin(), ref_list.end());
+		std::sort(test_list.begin(), test_list.end());
+		if (ref_list == test_list)
+			continue;
+
+		/// with the cap both sides keep a subset of the visible lights, only lights that do not touch the cluste are wrong
+		bool isCapped = refGrids[i].count >= maxLightsPerCluste || grids[i].count >= maxLightsPerCluste;
+		if (isCapped)
+			result.cappedClustes++;
+		bool isMismatch = false;
+
+		for (int side = 0; side < 2; side++)
+		{
+			std::vector<glm::uint>& from = side == 0 ? ref_list : test_list;
+			std::vector<glm::uint>& other = side == 0 ? test_list : ref_list;
+			diff_list.clear();
+			std::set_difference(from.begin(), from.end(), other.begin(), other.end(), std::back_inserter(diff_list));
+
+			for (size_t j = 0; j < diff_list.size(); j++)
+			{
+				float error = GetBoundaryError(aabbs[i], viewLights, diff_list[j]);
+				if (isCapped && error <= tolerance)
+					continue;
+				if (fabsf(error) <= tolerance)
+				{
+					result.boundaryLights++;
+					result.maxBoundaryError = std::max(result.maxBoundaryError, fabsf(error));
+					continue;
+				}
+
+				isMismatch = true;
+				if (side == 0)
+					result.missingLights++;
+				else
+					result.extraLights++;
+			}
+		}
+
+		if (isMismatch)
+		{
+			if (result.firstMismatch < 0)
+				result.firstMismatch = i;
+			result.mismatchClustes++;
+		}
+	}
+}
+
+void ClusteValidator::Print(FILE* file, ClusteValidation& result, LightGrid* refGrids, glm::uint* refIndices, LightGrid* grids, glm::uint* indices)
+{
+	fprintf(file, "cluste validation: %u clustes, %u mismatch(%u missing, %u extra lights), %u boundary lights(max error %.6f), %u capped\n",
+		result.clustes, result.mismatchClustes, result.missingLights, result.extraLights, result.boundaryLights, result.maxBoundaryError, result.cappedClustes);
+	if (result.firstMismatch < 0)
+		return;
+
+	int i = result.firstMismatch;
+	LightGrid* lightGrids[2] = { refGrids + i, grids + i };
+	glm::uint* lightIndices[2] = { refIndices, indices };
+	for (int side = 0; side < 2; side++)
+	{
+		fprintf(file, "  %s cluste(%d) count(%u) offset(%u):", side == 0 ? "reference" : "tested", i, lightGrids[side]->count, lightGrids[side]->offset);
+		for (glm::uint j = 0; j < lightGrids[side]->count; j++)
+			fprintf(file, " %u", lightIndices[side][lightGrids[side]->offset + j]);
+		fprintf(file, "\n");
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef __CLUSTE_VALIDATOR_H__
+#define __CLUSTE_VALIDATOR_H__
+
+#include <stdio.h>
+#include <vector>
+
+#include "ClusteData.h"
+
+/// order-insensitive diff of two light grids and index lists built from the same aabbs and view lights,
+/// a light found by only one side is tolerated when its distance to the aabb is within tolerance * radius of the radius
+class ClusteValidator
+{
+public:
+	ClusteValidator(float tolerance = 1e-3f);
+	virtual ~ClusteValidator();
+
+	void SetTolerance(float _tolerance) { tolerance = _tolerance; }
+	float GetTolerance() { return tolerance; }
+
+	void Compare(int clusteCount, VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, glm::uint maxLightsPerCluste,
+		LightGrid* refGrids, glm::uint* refIndices, LightGrid* grids, glm::uint* indices, ClusteValidation& result);
+
+	bool IsMatch(ClusteValidation& result) { return result.mismatchClustes == 0; }
+
+	/// one line summary, plus the lists of the first mismatching cluste
+	void Print(FILE* file, ClusteValidation& result, LightGrid* refGrids, glm::uint* refIndices, LightGrid* grids, glm::uint* indices);
+
+private:
+	/// (distance to the aabb - radius) / radius, negative when the sphere overlaps, FLT_MAX when the light is not a view light
+	float GetBoundaryError(VolumeTileAABB& aabb, ViewSpaceLights& viewLights, glm::uint light);
+	void BuildViewLightSlots(ViewSpaceLights& viewLights);
+
+private:
+	float tolerance;
+	std::vector<int> view_light_slots;	/// light index -> view light, -1 for disabled lights
+	std::vector<glm::uint> ref_list;
+	std::vector<glm::uint> test_list;
+	std::vector<glm::uint> diff_list;
+};
+
+#endif // !__CLUSTE_VALIDATOR_H__
@@ -13,6 +13,9 @@
 
 #include "LinearizeDepth.h"
 #include "CameraVelocity.h"
+#include "Shader/shader_interface.h"
+
+#include <d3d12shader.h>
 
 const D3D12_INPUT_ELEMENT_DESC StandardVertexDescription[] =
 {
@@ -263,8 +266,8 @@ D12Renderer::D12Renderer(GLFWwindow* win)
         //ThrowIfFailed(D3DCompileFromFile(L"Data/shader/tinyobj.hlsl", nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
         //ThrowIfFailed(D3DCompileFromFile(L"Data/shader/tinyobj.hlsl", nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
 
-        std::vector<char> vertexShader = Utils::readFile("Data/shader/tinyobj_vert.cso");
-        std::vector<char> pixelShader = Utils::readFile("Data/shader/tinyobj_frag.cso");
+        std::vector<char> vertexShader = ReadShader("Data/shader/tinyobj_vert.cso");
+        std::vector<char> pixelShader = ReadShader("Data/shader/tinyobj_frag.cso");
 
         D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;
         inputLayoutDesc.pInputElementDescs = StandardVertexDescription;
@@ -802,6 +805,10 @@ void D12Renderer::UpdateTransformMatrix(TransformEntity* transform)
 
 void D12Renderer::AddLight(PointLight* light)
 {
+    /// light const buffer is fixed size, only vulkan grows its light buffers
+    if (light_infos.size() >= MAX_LIGHT_NUM)
+        throw std::runtime_error("too many lights for dx12 forward shading!");
+
     Renderer::AddLight(light);
 
     int idx = light_infos.size() - 1;
@@ -812,6 +819,24 @@ void D12Renderer::AddLight(PointLight* light)
     }
 }
 
+void D12Renderer::UpdateLight(int idx, PointLight* light)
+{
+    Renderer::UpdateLight(idx, light);
+    for (int i = 0; i < frameCount; i++)
+    {
+        memcpy((PointLightData*)m_lightConstBufferBegin[i] + idx, &light_infos[idx], sizeof(PointLightData));
+    }
+}
+
+void D12Renderer::RemoveLight(int idx)
+{
+    Renderer::RemoveLight(idx);
+    for (int i = 0; i < frameCount; i++)
+    {
+        memcpy((PointLightData*)m_lightConstBufferBegin[i] + idx, &light_infos[idx], sizeof(PointLightData));
+    }
+}
+
 void D12Renderer::ClearLight()
 {
     Renderer::ClearLight();
@@ -905,6 +930,26 @@ void D12Renderer::UpdateMaterial(Material* mat)
     m_commandList->SetGraphicsRootDescriptorTable(RootParameterIndex::SrvParameter1, srvT1Handle);
 }
 
+std::vector<char> D12Renderer::ReadShader(const std::string& path)
+{
+    std::vector<char> code = Utils::readFile(path);
+
+    /// the default of interfaceVersion in the Transform cbuffer, a binary from before the version has no such variable
+    int version = -1;
+    ComPtr<ID3D12ShaderReflection> reflection;
+    if (SUCCEEDED(D3DReflect(code.data(), code.size(), IID_PPV_ARGS(&reflection))))
+    {
+        D3D12_SHADER_VARIABLE_DESC desc;
+        ID3D12ShaderReflectionVariable* variable = reflection->GetConstantBufferByName("Transform")->GetVariableByName("interfaceVersion");
+        if (SUCCEEDED(variable->GetDesc(&desc)))
+            version = desc.DefaultValue != NULL ? (int)*(const UINT*)desc.DefaultValue : SHADER_INTERFACE_VERSION;
+    }
+
+    if (version != SHADER_INTERFACE_VERSION)
+        throw std::runtime_error(path + " was built for another shader interface version, rebuild the shaders!");
+    return code;
+}
+
 void D12Renderer::CreateGraphicsPipeLineState(void* vs, int vsSize, void* ps, int psSize, bool depthEnable, bool stencilEnable, D3D12_INPUT_LAYOUT_DESC& layoutDesc, ComPtr<ID3D12RootSignature>& rootSignature, ComPtr<ID3D12PipelineState>& pipelineState)
 {
     CD3DX12_DEPTH_STENCIL_DESC depthStencilDesc(D3D12_DEFAULT);
@@ -108,6 +108,8 @@ public:
 	virtual void UpdateTransformMatrix(TransformEntity* transform);
 
 	virtual void AddLight(PointLight* light);
+	virtual void UpdateLight(int idx, PointLight* light);
+	virtual void RemoveLight(int idx);
 	virtual void ClearLight();
 
 	virtual int GetFrameBufferCount() { return frameCount; }
@@ -126,6 +128,8 @@ public:
 
 	void CreateTexture(void* imageData, int width, int height, DXGI_FORMAT format, ComPtr<ID3D12Resource>& texture, ComPtr<ID3D12Resource>& textureUploadHeap, int& texId);
 
+	/// reads a cso, throws when it was built for another SHADER_INTERFACE_VERSION
+	std::vector<char> ReadShader(const std::string& path);
 	void CreateGraphicsPipeLineState(void* vs, int vsSize, void* ps, int psSize, bool depthEnable, bool stencilEnable, D3D12_INPUT_LAYOUT_DESC& layoutDesc, ComPtr<ID3D12RootSignature>& rootSignature, ComPtr<ID3D12PipelineState>& pipelineState);
 	void CreateComputePipeLineState(void* cs, int csSize, ComPtr<ID3D12RootSignature>& rootSignature, ComPtr<ID3D12PipelineState>& pipelineState);
 
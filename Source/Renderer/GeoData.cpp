@@ -14,8 +14,3 @@ const std::vector<Vertex> GeoData::test_vertices = {
 const std::vector<int> GeoData::test_indices = {
 	0, 1, 2, 3, 5, 4
 };
-
-int GeoData::CalculateHash(int idx1, int idx2, int idx3)
-{
-	return (idx1 * 31 + idx2) * 31 + idx3;
-}
\ No newline at end of file
@@ -10,6 +10,8 @@
 #include <vector>
 
 #include "Renderer.h"
+#include "MeshAsset.h"
+#include "MeshCache.h"
 
 #include <tiny_obj_loader.h>
 /*view https://github.com/syoyo/tinyobjloader for more informations*/
@@ -21,10 +23,12 @@ public:
 	virtual ~GeoData() {}
 
 	virtual void initTestData() = 0;
-	virtual void initTinyObjData(tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials) = 0;
+	/// uploads the baked meshes as they are, in cache order
+	virtual void initMeshCache(MeshCache& cache) = 0;
 
-protected:
-	int CalculateHash(int idx1, int idx2, int idx3);
+	/// what the back end needs baked into the mesh cache
+	virtual bool IsFlipWinding() { return false; }
+	virtual bool IsMeshletUsed() { return false; }
 
 protected:
 	Renderer* m_pRenderer;
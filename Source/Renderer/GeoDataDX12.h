@@ -16,7 +16,10 @@ public:
 	virtual ~GeoDataDX12();
 
 	virtual void initTestData();
-	virtual void initTinyObjData(tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials);
+	virtual void initMeshCache(MeshCache& cache);
+
+	/// directx12 takes the triangles in the other winding
+	virtual bool IsFlipWinding() { return true; }
 
 private:
 	/// struct
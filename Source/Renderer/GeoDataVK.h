@@ -18,7 +18,9 @@ public:
 	virtual ~GeoDataVK();
 
 	virtual void initTestData();
-	virtual void initTinyObjData(tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials);
+	virtual void initMeshCache(MeshCache& cache);
+
+	virtual bool IsMeshletUsed();
 
 private:
 	/// struct
@@ -61,7 +63,8 @@ private:
 	};
 
 private:
-	void GenerateMeshlets(MeshData* meshData);
+	/// uploads the baked meshlets of every sub mesh of the mesh
+	void GenerateMeshlets(MeshData* meshData, MeshCache& cache, const MeshCache::SubMeshRecord* subMeshes);
 
 	/// renderering data
 	std::vector<MeshData> meshDatas;
@@ -22,4 +22,22 @@ PointLight::PointLight()
 
 PointLight::~PointLight()
 {
+}
+
+SpotLight::SpotLight()
+	:direction(0.0f, -1.0f, 0.0f), inner_angle(0.0f), outer_angle(0.785398f)
+{
+}
+
+SpotLight::~SpotLight()
+{
+}
+
+AreaLight::AreaLight()
+	:normal(0.0f, -1.0f, 0.0f), tangent(1.0f, 0.0f, 0.0f), width(0.0f), height(0.0f)
+{
+}
+
+AreaLight::~AreaLight()
+{
 }
\ No newline at end of file
@@ -54,4 +54,48 @@ protected:
 	float attenuation_exp;
 };
 
+/// cone light at the position, reaches the radius inside the outer angle and fades out from the inner angle
+class SpotLight : public PointLight
+{
+public:
+	SpotLight();
+	virtual ~SpotLight();
+
+	void SetDirection(const glm::vec3& d) { direction = d; }
+	glm::vec3& GetDirection() { return direction; }
+	/// half angles from the direction in radians
+	void SetInnerAngle(float a) { inner_angle = a; }
+	float GetInnerAngle() { return inner_angle; }
+	void SetOuterAngle(float a) { outer_angle = a; }
+	float GetOuterAngle() { return outer_angle; }
+
+protected:
+	glm::vec3 direction;
+	float inner_angle;
+	float outer_angle;
+};
+
+/// one-sided rectangle centered at the position, facing the normal, lights what is within the radius in front of it
+class AreaLight : public PointLight
+{
+public:
+	AreaLight();
+	virtual ~AreaLight();
+
+	void SetNormal(const glm::vec3& n) { normal = n; }
+	glm::vec3& GetNormal() { return normal; }
+	/// width axis, made perpendicular to the normal
+	void SetTangent(const glm::vec3& t) { tangent = t; }
+	glm::vec3& GetTangent() { return tangent; }
+	void SetSize(float w, float h) { width = w; height = h; }
+	float GetWidth() { return width; }
+	float GetHeight() { return height; }
+
+protected:
+	glm::vec3 normal;
+	glm::vec3 tangent;
+	float width;
+	float height;
+};
+
 #endif // !__LIGHT_H__
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <float.h>
+#include <algorithm>
+#include <atomic>
+
+#include "MeshAsset.h"
+#include "Common/ThreadPool.h"
+
+MeshBuilder::MeshBuilder()
+{
+}
+
+MeshBuilder::~MeshBuilder()
+{
+}
+
+void MeshBuilder::BuildVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx, Vertex& vertex)
+{
+	int v = idx.vertex_index;
+	vertex.pos = glm::vec4(attrib.vertices[v * 3 + 0], attrib.vertices[v * 3 + 1], attrib.vertices[v * 3 + 2], 1.0f);
+	if (attrib.vertex_weights.size() > 0)
+		vertex.pos.w = attrib.vertex_weights[v];
+	if (attrib.colors.size() >= attrib.vertices.size())
+		vertex.color = glm::vec4(attrib.colors[v * 3 + 0], attrib.colors[v * 3 + 1], attrib.colors[v * 3 + 2], 1.0f);
+	else
+		vertex.color = glm::vec4(1.0f);
+
+	/// a missing texcoord or normal gives zeros
+	int t = idx.texcoord_index;
+	vertex.texcoord = glm::vec4(0.0f);
+	if (t >= 0)
+	{
+		vertex.texcoord.x = attrib.texcoords[t * 2 + 0];
+		vertex.texcoord.y = 1.0f - attrib.texcoords[t * 2 + 1];
+		if (attrib.texcoord_ws.size() > 0)
+			vertex.texcoord.z = attrib.texcoord_ws[t];
+	}
+
+	int n = idx.normal_index;
+	vertex.normal = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	if (n >= 0)
+	{
+		vertex.normal.x = attrib.normals[n * 3 + 0];
+		vertex.normal.y = attrib.normals[n * 3 + 1];
+		vertex.normal.z = attrib.normals[n * 3 + 2];
+	}
+
+	vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void MeshBuilder::Build(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, bool isFlipWinding, MeshAsset& asset)
+{
+	const tinyobj::mesh_t& mesh = shape.mesh;
+	assert(mesh.num_face_vertices.size() == mesh.indices.size() / 3);
+
+	asset.vertexs.clear();
+	asset.indices.clear();
+	asset.subMeshes.clear();
+	asset.meshlets.clear();
+
+	int triangleNum = (int)mesh.material_ids.size();
+	asset.indices.reserve((size_t)triangleNum * 3);
+	vertex_hash.Reserve(triangleNum);
+
+	///  vertex / indices generate, the vertices are shared by all sub meshes of the shape
+	for (int j = 0; j < triangleNum; j++)
+	{
+		if (j == 0 || mesh.material_ids[j] != mesh.material_ids[j - 1])
+		{
+			SubMeshRange subMesh;
+			subMesh.indexStart = j * 3;
+			subMesh.indexCount = 0;
+			subMesh.mid = mesh.material_ids[j];
+			asset.subMeshes.push_back(subMesh);
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			int corner = (isFlipWinding && k != 0) ? 3 - k : k;
+			const tinyobj::index_t& idx = mesh.indices[j * 3 + corner];
+			int vtxIdx = vertex_hash.FindOrInsert(idx.vertex_index, idx.texcoord_index, idx.normal_index, (int)asset.vertexs.size());
+			if (vtxIdx == (int)asset.vertexs.size())
+			{
+				Vertex vertex;
+				BuildVertex(attrib, idx, vertex);
+				asset.vertexs.push_back(vertex);
+			}
+			asset.indices.push_back(vtxIdx);
+		}
+		asset.subMeshes.back().indexCount += 3;
+	}
+
+	tangent_generator.Build(asset);
+	BuildBounds(asset);
+}
+
+void MeshBuilder::BuildShapes(ThreadPool* pool, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, bool isFlipWinding,
+	bool isMeshlet, std::vector<MeshAsset>& assets)
+{
+	assets.clear();
+	assets.resize(shapes.size());
+
+	/// biggest shapes first, so the last one taken is a small one
+	std::vector<int> order(shapes.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (int)i;
+	std::stable_sort(order.begin(), order.end(), [&shapes](int a, int b) { return shapes[a].mesh.indices.size() > shapes[b].mesh.indices.size(); });
+
+	/// every builder takes the next shape until none is left
+	int builderNum = std::min(pool->GetWorkerCount() + 1, (int)shapes.size());
+	std::vector<MeshBuilder> builders(builderNum);
+	std::atomic<int> next(0);
+	pool->ParallelFor(builderNum, [&](int b) {
+		int i;
+		while ((i = next.fetch_add(1)) < (int)order.size())
+			builders[b].Build(attrib, shapes[order[i]], isFlipWinding, assets[order[i]]);
+	});
+
+	if (!isMeshlet)
+		return;
+
+	/// shape and sub mesh of every task
+	std::vector<std::pair<int, int>> tasks;
+	for (int i = 0; i < (int)assets.size(); i++)
+	{
+		assets[i].meshlets.resize(assets[i].subMeshes.size());
+		for (int k = 0; k < (int)assets[i].subMeshes.size(); k++)
+			tasks.push_back(std::make_pair(i, k));
+	}
+
+	pool->ParallelFor((int)tasks.size(), [&](int task) {
+		MeshAsset& asset = assets[tasks[task].first];
+		const SubMeshRange& range = asset.subMeshes[tasks[task].second];
+		BuildMeshlets(asset.indices.data() + range.indexStart, range.indexCount, asset.vertexs.size(), asset.meshlets[tasks[task].second]);
+	});
+}
+
+void MeshBuilder::BuildMeshlets(const int* indices, int indexCount, size_t vertexNum, MeshletData& meshletData)
+{
+	std::vector<uint32_t>& vertexIndices = meshletData.vertexIndices;
+	std::vector<uint32_t>& primitiveIndices = meshletData.primitiveIndices;
+	std::vector<Meshlet>& meshlets = meshletData.meshlets;
+
+	glm::uint max_primitive = MAX_MESH_SHADER_PRIMITIVE;
+	glm::uint max_vtx = MAX_MESH_SHADER_VERTICES;
+	int triangleNum = indexCount / 3;
+
+	std::vector<uint32_t> vertexCheckArray(vertexNum, 0);
+
+	bool isFull = false;
+	Meshlet meshlet;
+	meshlet.primBegin = 0;
+	meshlet.vertexBegin = 0;
+	meshlet.primCount = 0;
+	meshlet.vertexCount = 0;
+
+	for (int j = 0; j < triangleNum; j++)
+	{
+		/// vertex full check
+		int offset = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			int indice = indices[j * 3 + k];
+			if (vertexCheckArray[indice] == 0)
+			{
+				if (meshlet.vertexCount + offset >= max_vtx)
+				{
+					isFull = true;
+					break;
+				}
+				offset++;
+			}
+		}
+		if (meshlet.primCount / 3 >= max_primitive)
+		{
+			isFull = true;
+		}
+		if (isFull)
+		{
+			j--;
+			isFull = false;
+			meshlets.push_back(meshlet);
+			std::fill(vertexCheckArray.begin(), vertexCheckArray.end(), 0);
+			meshlet.primBegin = meshlet.primBegin + meshlet.primCount;
+			meshlet.vertexBegin = meshlet.vertexBegin + meshlet.vertexCount;
+			meshlet.primCount = 0;
+			meshlet.vertexCount = 0;
+			continue;
+		}
+
+		/// record primitive
+		for (int k = 0; k < 3; k++)
+		{
+			int indice = indices[j * 3 + k];
+			if (vertexCheckArray[indice] == 0)
+			{
+				vertexCheckArray[indice] = meshlet.vertexCount;
+				vertexIndices.push_back(indice);
+				primitiveIndices.push_back(meshlet.vertexCount);
+				meshlet.vertexCount++;
+			}
+			else
+			{
+				primitiveIndices.push_back(vertexCheckArray[indice]);
+			}
+		}
+		meshlet.primCount += 3;
+	}
+	meshlets.push_back(meshlet);
+}
+
+void MeshBuilder::BuildBounds(MeshAsset& asset)
+{
+	asset.boundMin = glm::vec3(FLT_MAX);
+	asset.boundMax = glm::vec3(-FLT_MAX);
+	for (size_t i = 0; i < asset.vertexs.size(); i++)
+	{
+		glm::vec3 pos = glm::vec3(asset.vertexs[i].pos);
+		asset.boundMin = glm::min(asset.boundMin, pos);
+		asset.boundMax = glm::max(asset.boundMax, pos);
+	}
+}
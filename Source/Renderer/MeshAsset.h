@@ -0,0 +1,96 @@
+/*
+	Mesh asset, the cpu side of one obj shape without any graphics api
+*/
+
+#ifndef __MESH_ASSET_H__
+#define __MESH_ASSET_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "GLMConfig.h"
+#include "TangentGenerator.h"
+#include "VertexHash.h"
+
+#include <tiny_obj_loader.h>
+/*view https://github.com/syoyo/tinyobjloader for more informations*/
+
+class ThreadPool;
+
+#define MAX_MESH_SHADER_PRIMITIVE 126
+#define MAX_MESH_SHADER_VERTICES 64
+
+/// one buffers(simple first)
+struct Vertex {
+	glm::vec4 pos;
+	glm::vec4 color;
+	glm::vec4 texcoord;
+	glm::vec4 normal;
+	glm::vec4 tangent;
+};
+
+/// meshlet for mesh shading
+struct Meshlet {
+	glm::uint vertexCount;
+	glm::uint primCount;
+	glm::uint vertexBegin;
+	glm::uint primBegin;
+};
+
+/// cpu side meshlets of one sub mesh
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertexIndices;
+	std::vector<uint32_t> primitiveIndices;
+};
+
+/// the faces of one material, a range of MeshAsset::indices
+struct SubMeshRange
+{
+	int indexStart;
+	int indexCount;
+	int32_t mid;
+};
+
+/// deduplicated vertices and triangle lists of one shape, ready for the upload of a GeoData back end
+struct MeshAsset
+{
+	std::vector<Vertex> vertexs;
+	std::vector<int> indices;
+	std::vector<SubMeshRange> subMeshes;	/// in face order, a new range starts where the material changes
+	std::vector<MeshletData> meshlets;	/// one per sub mesh, only built for mesh shading
+
+	glm::vec3 boundMin;
+	glm::vec3 boundMax;
+};
+
+/// turns tinyobj shapes into mesh assets: sub meshes by material, (v, t, n) deduplication, tangents,
+/// keeps its tables between the shapes, so one builder per thread
+class MeshBuilder
+{
+public:
+	MeshBuilder();
+	virtual ~MeshBuilder();
+
+	/// isFlipWinding takes the corners of every triangle as 0, 2, 1 (directx12), an empty shape gives an empty asset
+	void Build(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, bool isFlipWinding, MeshAsset& asset);
+
+	/// one asset per shape built on all threads of the pool with a builder per thread, assets[i] is always shapes[i],
+	/// so the result is the same as building the shapes one after another, isMeshlet also splits every sub mesh into meshlets
+	static void BuildShapes(ThreadPool* pool, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, bool isFlipWinding,
+		bool isMeshlet, std::vector<MeshAsset>& assets);
+
+	/// meshlets of the triangles indices[0, indexCount) for mesh shading
+	static void BuildMeshlets(const int* indices, int indexCount, size_t vertexNum, MeshletData& meshletData);
+
+private:
+	static void BuildVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx, Vertex& vertex);
+	static void BuildBounds(MeshAsset& asset);
+
+private:
+	VertexHash vertex_hash;
+	TangentGenerator tangent_generator;
+};
+
+#endif // !__MESH_ASSET_H__
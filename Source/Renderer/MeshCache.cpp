@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "MeshCache.h"
+
+/// the texture names Material::InitWithTinyMat loads, in the order of MaterialRecord::textures
+static std::string tinyobj::material_t::* const MaterialTextures[MESH_CACHE_TEXTURE_NUM] = {
+	&tinyobj::material_t::ambient_texname,
+	&tinyobj::material_t::diffuse_texname,
+	&tinyobj::material_t::specular_texname,
+	&tinyobj::material_t::specular_highlight_texname,
+	&tinyobj::material_t::bump_texname,
+	&tinyobj::material_t::displacement_texname,
+	&tinyobj::material_t::alpha_texname,
+	&tinyobj::material_t::reflection_texname,
+	&tinyobj::material_t::normal_texname,
+};
+
+static uint64_t Mix(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/// 64-bit multiply and rotate over 8 byte words, four lanes so the multiplies of the lanes overlap, only detects changes
+static uint64_t HashBytes(const char* bytes, size_t count, uint64_t seed)
+{
+	const uint64_t k1 = 0x87c37b91114253d5ull;
+	const uint64_t k2 = 0x4cf5ad432745937full;
+	uint64_t lanes[4] = { seed, seed ^ k1, seed ^ k2, seed ^ (k1 * k2) };
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32)
+	{
+		for (int l = 0; l < 4; l++)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i + l * 8, 8);
+			uint64_t lane = lanes[l] ^ (word * k1);
+			lanes[l] = ((lane << 31) | (lane >> 33)) * k2;
+		}
+	}
+
+	uint64_t hash = Mix(count ^ seed);
+	for (int l = 0; l < 4; l++)
+		hash = Mix(hash ^ lanes[l]);
+	for (; i < count; i++)
+		hash = (hash ^ (uint8_t)bytes[i]) * 0x100000001b3ull;
+	return Mix(hash);
+}
+
+/// rounds the end of the bytes up to MESH_CACHE_ALIGN and appends the array there
+static uint64_t Append(std::vector<char>& bytes, const void* src, size_t count)
+{
+	bytes.resize((bytes.size() + MESH_CACHE_ALIGN - 1) / MESH_CACHE_ALIGN * MESH_CACHE_ALIGN, 0);
+	uint64_t offset = bytes.size();
+	if (count > 0)
+		bytes.insert(bytes.end(), (const char*)src, (const char*)src + count);
+	return offset;
+}
+
+MeshCache::MeshCache()
+{
+	data = NULL;
+	size = 0;
+	header = NULL;
+}
+
+MeshCache::~MeshCache()
+{
+}
+
+std::string MeshCache::GetPath(const std::string& objPath, bool isFlipWinding, bool isMeshlet)
+{
+	return objPath + (isFlipWinding ? ".flip" : "") + (isMeshlet ? ".meshlet" : "") + ".meshcache";
+}
+
+uint32_t MeshCache::GetOptions(bool isFlipWinding, bool isMeshlet)
+{
+	return (isFlipWinding ? Option_FlipWinding : 0) | (isMeshlet ? Option_Meshlet : 0);
+}
+
+uint64_t MeshCache::HashSources(const std::string& objPath, const std::vector<std::string>& mtlPaths)
+{
+	/// a missing file hashes apart from an empty one
+	uint64_t hash = Mix(MESH_CACHE_VERSION);
+	for (int i = -1; i < (int)mtlPaths.size(); i++)
+	{
+		MappedFile source;
+		if (source.Open(i < 0 ? objPath : mtlPaths[i]))
+			hash = HashBytes(source.GetData(), source.GetSize(), hash);
+		else
+			hash = Mix(hash + 1);
+	}
+	return hash;
+}
+
+bool MeshCache::Open(const std::string& cachePath, const std::string& objPath, bool isFlipWinding, bool isMeshlet)
+{
+	baked.clear();
+	file.Close();
+	data = NULL;
+	size = 0;
+	header = NULL;
+
+	if (!file.Open(cachePath))
+		return false;
+	data = file.GetData();
+	size = file.GetSize();
+
+	/// the .mtl paths come from the cache itself, so the sources are hashed last
+	bool isValid = Validate() && header->options == GetOptions(isFlipWinding, isMeshlet);
+	if (isValid)
+	{
+		std::vector<std::string> mtlPaths;
+		const StringRef* mtlRefs = At<StringRef>(header->mtlPathOffset);
+		for (uint32_t i = 0; i < header->mtlPathCount; i++)
+			mtlPaths.push_back(GetString(mtlRefs[i]));
+		isValid = HashSources(objPath, mtlPaths) == header->sourceHash;
+	}
+
+	if (!isValid)
+	{
+		file.Close();
+		data = NULL;
+		size = 0;
+		header = NULL;
+	}
+	return isValid;
+}
+
+bool MeshCache::Validate()
+{
+	if (data == NULL || size < sizeof(Header))
+		return false;
+	header = At<Header>(0);
+	if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION || header->vertexSize != sizeof(Vertex) || header->fileSize != size ||
+		header->meshletVertices != MAX_MESH_SHADER_VERTICES || header->meshletPrimitives != MAX_MESH_SHADER_PRIMITIVE)
+		return false;
+
+	/// offset aligned and count elements inside the file
+	auto isInside = [this](uint64_t offset, uint64_t count, uint64_t elementSize) {
+		return offset % MESH_CACHE_ALIGN == 0 && offset <= size && count <= (size - offset) / elementSize;
+	};
+	auto isString = [this](const StringRef& ref) {
+		return ref.offset <= header->stringSize && ref.length <= header->stringSize - ref.offset;
+	};
+
+	if (!isInside(header->meshOffset, header->meshCount, sizeof(MeshRecord)) || !isInside(header->materialOffset, header->materialCount, sizeof(MaterialRecord)) ||
+		!isInside(header->mtlPathOffset, header->mtlPathCount, sizeof(StringRef)) || !isInside(header->stringOffset, header->stringSize, 1))
+		return false;
+
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		const MeshRecord& mesh = GetMesh(i);
+		if (!isInside(mesh.vertexOffset, mesh.vertexCount, sizeof(Vertex)) || !isInside(mesh.indexOffset, mesh.indexCount, sizeof(int)) ||
+			!isInside(mesh.subMeshOffset, mesh.subMeshCount, sizeof(SubMeshRecord)))
+			return false;
+
+		const SubMeshRecord* subMeshes = GetSubMeshes(mesh);
+		for (uint32_t k = 0; k < mesh.subMeshCount; k++)
+		{
+			const SubMeshRecord& subMesh = subMeshes[k];
+			if (subMesh.indexStart < 0 || subMesh.indexCount < 0 || (uint32_t)subMesh.indexStart + (uint32_t)subMesh.indexCount > mesh.indexCount ||
+				!isInside(subMesh.meshletOffset, subMesh.meshletCount, sizeof(Meshlet)) ||
+				!isInside(subMesh.vertexIndexOffset, subMesh.vertexIndexCount, sizeof(uint32_t)) ||
+				!isInside(subMesh.primitiveIndexOffset, subMesh.primitiveIndexCount, sizeof(uint32_t)))
+				return false;
+
+			/// the indices are used unchecked by the draws, every one has to hit a vertex of the mesh
+			const int* indices = GetIndices(mesh) + subMesh.indexStart;
+			for (int32_t j = 0; j < subMesh.indexCount; j++)
+			{
+				if (indices[j] < 0 || (uint32_t)indices[j] >= mesh.vertexCount)
+					return false;
+			}
+
+			/// meshlets inside the arrays of the sub mesh, vertex indices into the mesh, primitive indices into the meshlet
+			const Meshlet* meshlets = GetMeshlets(subMesh);
+			const uint32_t* vertexIndices = GetMeshletVertexIndices(subMesh);
+			const uint32_t* primitiveIndices = GetMeshletPrimitiveIndices(subMesh);
+			for (uint32_t j = 0; j < subMesh.meshletCount; j++)
+			{
+				const Meshlet& meshlet = meshlets[j];
+				if (meshlet.vertexBegin > subMesh.vertexIndexCount || meshlet.vertexCount > subMesh.vertexIndexCount - meshlet.vertexBegin ||
+					meshlet.primBegin > subMesh.primitiveIndexCount || meshlet.primCount > subMesh.primitiveIndexCount - meshlet.primBegin)
+					return false;
+				for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+				{
+					if (vertexIndices[meshlet.vertexBegin + v] >= mesh.vertexCount)
+						return false;
+				}
+				for (uint32_t p = 0; p < meshlet.primCount; p++)
+				{
+					if (primitiveIndices[meshlet.primBegin + p] >= meshlet.vertexCount)
+						return false;
+				}
+			}
+		}
+	}
+
+	const MaterialRecord* materialRecords = At<MaterialRecord>(header->materialOffset);
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		if (!isString(materialRecords[i].name))
+			return false;
+		for (int t = 0; t < MESH_CACHE_TEXTURE_NUM; t++)
+		{
+			if (!isString(materialRecords[i].textures[t]))
+				return false;
+		}
+	}
+	const StringRef* mtlRefs = At<StringRef>(header->mtlPathOffset);
+	for (uint32_t i = 0; i < header->mtlPathCount; i++)
+	{
+		if (!isString(mtlRefs[i]))
+			return false;
+	}
+	return true;
+}
+
+void MeshCache::Bake(const std::string& objPath, const std::vector<std::string>& mtlPaths, const std::vector<MeshAsset>& assets,
+	const std::vector<tinyobj::material_t>& materials, bool isFlipWinding, bool isMeshlet)
+{
+	file.Close();
+	baked.clear();
+
+	Header head;
+	memset(&head, 0, sizeof(head));
+	head.magic = MESH_CACHE_MAGIC;
+	head.version = MESH_CACHE_VERSION;
+	head.vertexSize = sizeof(Vertex);
+	head.options = GetOptions(isFlipWinding, isMeshlet);
+	head.meshletVertices = MAX_MESH_SHADER_VERTICES;
+	head.meshletPrimitives = MAX_MESH_SHADER_PRIMITIVE;
+	head.sourceHash = HashSources(objPath, mtlPaths);
+	Append(baked, &head, sizeof(head));
+
+	/// empty shapes are left out like the back ends leave them out
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (!assets[i].vertexs.empty())
+			head.meshCount++;
+	}
+	head.meshOffset = Append(baked, NULL, 0);
+	baked.resize(baked.size() + head.meshCount * sizeof(MeshRecord), 0);
+
+	int meshIdx = 0;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const MeshAsset& asset = assets[i];
+		if (asset.vertexs.empty())
+			continue;
+
+		MeshRecord mesh;
+		memset(&mesh, 0, sizeof(mesh));
+		mesh.vertexOffset = Append(baked, asset.vertexs.data(), asset.vertexs.size() * sizeof(Vertex));
+		mesh.vertexCount = (uint32_t)asset.vertexs.size();
+		mesh.indexOffset = Append(baked, asset.indices.data(), asset.indices.size() * sizeof(int));
+		mesh.indexCount = (uint32_t)asset.indices.size();
+
+		std::vector<SubMeshRecord> subMeshes(asset.subMeshes.size());
+		for (size_t k = 0; k < asset.subMeshes.size(); k++)
+		{
+			SubMeshRecord& subMesh = subMeshes[k];
+			memset(&subMesh, 0, sizeof(subMesh));
+			subMesh.indexStart = asset.subMeshes[k].indexStart;
+			subMesh.indexCount = asset.subMeshes[k].indexCount;
+			subMesh.mid = asset.subMeshes[k].mid;
+			if (isMeshlet && k < asset.meshlets.size())
+			{
+				const MeshletData& meshletData = asset.meshlets[k];
+				subMesh.meshletOffset = Append(baked, meshletData.meshlets.data(), meshletData.meshlets.size() * sizeof(Meshlet));
+				subMesh.meshletCount = (uint32_t)meshletData.meshlets.size();
+				subMesh.vertexIndexOffset = Append(baked, meshletData.vertexIndices.data(), meshletData.vertexIndices.size() * sizeof(uint32_t));
+				subMesh.vertexIndexCount = (uint32_t)meshletData.vertexIndices.size();
+				subMesh.primitiveIndexOffset = Append(baked, meshletData.primitiveIndices.data(), meshletData.primitiveIndices.size() * sizeof(uint32_t));
+				subMesh.primitiveIndexCount = (uint32_t)meshletData.primitiveIndices.size();
+			}
+		}
+		mesh.subMeshOffset = Append(baked, subMeshes.data(), subMeshes.size() * sizeof(SubMeshRecord));
+		mesh.subMeshCount = (uint32_t)subMeshes.size();
+
+		for (int c = 0; c < 3; c++)
+		{
+			mesh.boundMin[c] = asset.boundMin[c];
+			mesh.boundMax[c] = asset.boundMax[c];
+		}
+		memcpy(&baked[head.meshOffset + meshIdx * sizeof(MeshRecord)], &mesh, sizeof(mesh));
+		meshIdx++;
+	}
+
+	/// materials and .mtl paths, their strings go to the string table at the end
+	std::vector<char> strings;
+	std::vector<MaterialRecord> materialRecords(materials.size());
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		const tinyobj::material_t& mat = materials[i];
+		MaterialRecord& record = materialRecords[i];
+		memset(&record, 0, sizeof(record));
+		for (int c = 0; c < 3; c++)
+		{
+			record.ambient[c] = (float)mat.ambient[c];
+			record.diffuse[c] = (float)mat.diffuse[c];
+			record.specular[c] = (float)mat.specular[c];
+			record.transmittance[c] = (float)mat.transmittance[c];
+			record.emission[c] = (float)mat.emission[c];
+		}
+		record.shininess = (float)mat.shininess;
+		record.ior = (float)mat.ior;
+		record.dissolve = (float)mat.dissolve;
+		record.illum = mat.illum;
+		record.name = AddString(strings, mat.name);
+		for (int t = 0; t < MESH_CACHE_TEXTURE_NUM; t++)
+			record.textures[t] = AddString(strings, mat.*MaterialTextures[t]);
+	}
+	std::vector<StringRef> mtlRefs(mtlPaths.size());
+	for (size_t i = 0; i < mtlPaths.size(); i++)
+		mtlRefs[i] = AddString(strings, mtlPaths[i]);
+
+	head.materialOffset = Append(baked, materialRecords.data(), materialRecords.size() * sizeof(MaterialRecord));
+	head.materialCount = (uint32_t)materialRecords.size();
+	head.mtlPathOffset = Append(baked, mtlRefs.data(), mtlRefs.size() * sizeof(StringRef));
+	head.mtlPathCount = (uint32_t)mtlRefs.size();
+	head.stringOffset = Append(baked, strings.data(), strings.size());
+	head.stringSize = (uint32_t)strings.size();
+	head.fileSize = baked.size();
+	memcpy(&baked[0], &head, sizeof(head));
+
+	data = baked.data();
+	size = baked.size();
+	header = At<Header>(0);
+}
+
+bool MeshCache::Write(const std::string& cachePath)
+{
+	if (baked.empty())
+		return false;
+
+	/// a cut off file has the wrong size and is baked again
+	FILE* fp = fopen(cachePath.c_str(), "wb");
+	if (fp == NULL)
+		return false;
+	bool isWritten = fwrite(baked.data(), 1, baked.size(), fp) == baked.size();
+	isWritten = fclose(fp) == 0 && isWritten;
+	return isWritten;
+}
+
+void MeshCache::GetMaterials(std::vector<tinyobj::material_t>& materials)
+{
+	materials.clear();
+	materials.resize(header->materialCount);
+
+	const MaterialRecord* materialRecords = At<MaterialRecord>(header->materialOffset);
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		tinyobj::material_t& mat = materials[i];
+		const MaterialRecord& record = materialRecords[i];
+		for (int c = 0; c < 3; c++)
+		{
+			mat.ambient[c] = record.ambient[c];
+			mat.diffuse[c] = record.diffuse[c];
+			mat.specular[c] = record.specular[c];
+			mat.transmittance[c] = record.transmittance[c];
+			mat.emission[c] = record.emission[c];
+		}
+		mat.shininess = record.shininess;
+		mat.ior = record.ior;
+		mat.dissolve = record.dissolve;
+		mat.illum = record.illum;
+		mat.name = GetString(record.name);
+		for (int t = 0; t < MESH_CACHE_TEXTURE_NUM; t++)
+			mat.*MaterialTextures[t] = GetString(record.textures[t]);
+	}
+}
+
+std::string MeshCache::GetString(const StringRef& ref)
+{
+	return std::string(data + header->stringOffset + ref.offset, ref.length);
+}
+
+MeshCache::StringRef MeshCache::AddString(std::vector<char>& strings, const std::string& str)
+{
+	StringRef ref;
+	ref.offset = (uint32_t)strings.size();
+	ref.length = (uint32_t)str.size();
+	strings.insert(strings.end(), str.begin(), str.end());
+	return ref;
+}
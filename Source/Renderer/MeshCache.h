@@ -0,0 +1,154 @@
+/*
+	Mesh cache, the mesh assets of an obj baked into one binary file that is memory mapped at load
+*/
+
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Common/MappedFile.h"
+#include "MeshAsset.h"
+
+#include <tiny_obj_loader.h>
+/*view https://github.com/syoyo/tinyobjloader for more informations*/
+
+#define MESH_CACHE_MAGIC 0x4843534d	/// "MSCH"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_ALIGN 16
+#define MESH_CACHE_TEXTURE_NUM 9
+
+/// the baked file: header, mesh records, then the arrays of every mesh, a material table and a string table,
+/// every array starts at a MESH_CACHE_ALIGN aligned offset from the start of the file, so the mapped data is used in place.
+/// a cache is stale when the obj or its .mtl files changed or the back end asks for other options, it is then baked again
+class MeshCache
+{
+public:
+	/// into the string table
+	struct StringRef
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t options;	/// Option_ bits
+		uint32_t meshletVertices;
+		uint32_t meshletPrimitives;
+		uint32_t meshCount;
+		uint32_t materialCount;
+		uint32_t mtlPathCount;
+		uint32_t stringSize;
+		uint64_t sourceHash;	/// obj and .mtl contents
+		uint64_t fileSize;
+		uint64_t meshOffset;
+		uint64_t materialOffset;
+		uint64_t mtlPathOffset;
+		uint64_t stringOffset;
+	};
+
+	/// one non-empty shape
+	struct MeshRecord
+	{
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t subMeshOffset;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t subMeshCount;
+		float boundMin[3];
+		float boundMax[3];
+		uint32_t pad;
+	};
+
+	/// the meshlet arrays are empty without Option_Meshlet
+	struct SubMeshRecord
+	{
+		int32_t indexStart;
+		int32_t indexCount;
+		int32_t mid;
+		uint32_t meshletCount;
+		uint32_t vertexIndexCount;
+		uint32_t primitiveIndexCount;
+		uint64_t meshletOffset;
+		uint64_t vertexIndexOffset;
+		uint64_t primitiveIndexOffset;
+	};
+
+	/// the material_t fields the renderer reads, textures in the order of MaterialTextures
+	struct MaterialRecord
+	{
+		float ambient[3];
+		float diffuse[3];
+		float specular[3];
+		float transmittance[3];
+		float emission[3];
+		float shininess;
+		float ior;
+		float dissolve;
+		int32_t illum;
+		StringRef name;
+		StringRef textures[MESH_CACHE_TEXTURE_NUM];
+	};
+
+	enum Option
+	{
+		Option_FlipWinding = 1 << 0,
+		Option_Meshlet = 1 << 1,
+	};
+
+public:
+	MeshCache();
+	virtual ~MeshCache();
+
+	/// the cache file of an obj for the options, back ends with other options keep their own file
+	static std::string GetPath(const std::string& objPath, bool isFlipWinding, bool isMeshlet);
+
+	/// maps the cache and checks it against the obj, false for a missing, broken or stale cache
+	bool Open(const std::string& cachePath, const std::string& objPath, bool isFlipWinding, bool isMeshlet);
+	/// bakes the non-empty assets and the materials into memory, the cache can be read right after it
+	void Bake(const std::string& objPath, const std::vector<std::string>& mtlPaths, const std::vector<MeshAsset>& assets,
+		const std::vector<tinyobj::material_t>& materials, bool isFlipWinding, bool isMeshlet);
+	/// writes a baked cache, the baked data stays usable when the file cannot be written
+	bool Write(const std::string& cachePath);
+
+	int GetMeshCount() { return (int)header->meshCount; }
+	const MeshRecord& GetMesh(int i) { return At<MeshRecord>(header->meshOffset)[i]; }
+	const Vertex* GetVertexs(const MeshRecord& mesh) { return At<Vertex>(mesh.vertexOffset); }
+	const int* GetIndices(const MeshRecord& mesh) { return At<int>(mesh.indexOffset); }
+	const SubMeshRecord* GetSubMeshes(const MeshRecord& mesh) { return At<SubMeshRecord>(mesh.subMeshOffset); }
+	const Meshlet* GetMeshlets(const SubMeshRecord& subMesh) { return At<Meshlet>(subMesh.meshletOffset); }
+	const uint32_t* GetMeshletVertexIndices(const SubMeshRecord& subMesh) { return At<uint32_t>(subMesh.vertexIndexOffset); }
+	const uint32_t* GetMeshletPrimitiveIndices(const SubMeshRecord& subMesh) { return At<uint32_t>(subMesh.primitiveIndexOffset); }
+
+	/// the material table as tinyobj materials, the fields that are not baked are zero
+	void GetMaterials(std::vector<tinyobj::material_t>& materials);
+
+private:
+	template<typename T>
+	const T* At(uint64_t offset) { return (const T*)(data + offset); }
+
+	static uint32_t GetOptions(bool isFlipWinding, bool isMeshlet);
+	static uint64_t HashSources(const std::string& objPath, const std::vector<std::string>& mtlPaths);
+	/// every record and array lies inside the file
+	bool Validate();
+
+	std::string GetString(const StringRef& ref);
+	static StringRef AddString(std::vector<char>& strings, const std::string& str);
+
+private:
+	MappedFile file;
+	std::vector<char> baked;	/// the cache of the last Bake
+
+	const char* data;
+	size_t size;
+	const Header* header;
+};
+
+#endif // !__MESH_CACHE_H__
@@ -0,0 +1,777 @@
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <sstream>
+#include <string.h>
+
+#include "Common/MappedFile.h"
+#include "Common/ThreadPool.h"
+#include "ObjLoader.h"
+
+/// smaller files are not worth the threads
+#define OBJ_CHUNK_MIN_BYTES (256 * 1024)
+/// faces before the first 's' line of a chunk take the smoothing group of the chunks before it
+#define SMOOTHING_INHERIT 0xffffffff
+
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool IsDigit(char c)
+{
+	return (unsigned int)(c - '0') < 10u;
+}
+
+static inline const char* SkipSpace(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p))
+		p++;
+	return p;
+}
+
+static inline const char* TokenEnd(const char* p, const char* end)
+{
+	while (p < end && !IsSpace(*p) && *p != '\r')
+		p++;
+	return p;
+}
+
+/// [p, end) is one token, accepts the same forms as tinyobj: [+-]digits[.digits][e[+-]digits] and [+-].digits,
+/// up to 19 significant digits are kept in an integer and scaled once, so most values round correctly
+static bool ParseDouble(const char* p, const char* end, double& value)
+{
+	bool isNegative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+	{
+		isNegative = *p == '-';
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool isNumber = false;
+	while (p < end && IsDigit(*p))
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa > 0)
+				digits++;
+		}
+		else
+			exponent++;
+		isNumber = true;
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa > 0)
+					digits++;
+				exponent--;
+			}
+			isNumber = true;
+			p++;
+		}
+	}
+	if (!isNumber)
+		return false;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool isExpNegative = false;
+		if (p < end && (*p == '+' || *p == '-'))
+		{
+			isExpNegative = *p == '-';
+			p++;
+		}
+		if (p == end || !IsDigit(*p))
+			return false;
+		int exp = 0;
+		while (p < end && IsDigit(*p))
+		{
+			if (exp < 10000)
+				exp = exp * 10 + (*p - '0');
+			p++;
+		}
+		exponent += isExpNegative ? -exp : exp;
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0)
+		result = exponent >= -22 ? result / POW10[-exponent] : result * pow(10.0, exponent);
+	else if (exponent > 0)
+		result = exponent <= 22 ? result * POW10[exponent] : result * pow(10.0, exponent);
+	value = isNegative ? -result : result;
+	return true;
+}
+
+/// next token of the line as a float, false when it is missing or no number
+static inline bool TryParseReal(const char*& token, const char* end, float& value)
+{
+	token = SkipSpace(token, end);
+	const char* tokenEnd = TokenEnd(token, end);
+	double result;
+	bool isParsed = ParseDouble(token, tokenEnd, result);
+	if (isParsed)
+		value = (float)result;
+	token = tokenEnd;
+	return isParsed;
+}
+
+static inline float ParseReal(const char*& token, const char* end, float defaultValue)
+{
+	float value = defaultValue;
+	TryParseReal(token, end, value);
+	return value;
+}
+
+/// atoi of one face index, the token ends at the next '/' or space
+static inline int ParseIndex(const char*& token, const char* end)
+{
+	const char* p = token;
+	bool isNegative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+	{
+		isNegative = *p == '-';
+		p++;
+	}
+	int value = 0;
+	while (p < end && IsDigit(*p))
+	{
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	while (p < end && *p != '/' && !IsSpace(*p) && *p != '\r')
+		p++;
+	token = p;
+	return isNegative ? -value : value;
+}
+
+/// zero based index, a negative one is relative to the count so far, zero is not allowed
+static inline bool FixIndex(int idx, int count, int bit, int& out, int& relative)
+{
+	if (idx > 0)
+	{
+		out = idx - 1;
+		return true;
+	}
+	if (idx == 0)
+		return false;
+	out = count + idx;
+	relative |= bit;
+	return true;
+}
+
+/// tinyobj's point in triangle test
+static bool PointInTriangle(const float* vx, const float* vy, float tx, float ty)
+{
+	bool isInside = false;
+	for (int i = 0, j = 2; i < 3; j = i++)
+	{
+		if (((vy[i] > ty) != (vy[j] > ty)) && (tx < (vx[j] - vx[i]) * (ty - vy[i]) / (vy[j] - vy[i]) + vx[i]))
+			isInside = !isInside;
+	}
+	return isInside;
+}
+
+ObjLoader::ObjLoader(ThreadPool* pool)
+{
+	thread_pool = pool;
+}
+
+ObjLoader::~ObjLoader()
+{
+}
+
+bool ObjLoader::Load(const std::string& path, const std::string& mtlBasePath, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes,
+	std::vector<tinyobj::material_t>& materials, std::string& warn, std::string& err)
+{
+	attrib = tinyobj::attrib_t();
+	shapes.clear();
+	mtl_paths.clear();
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		err += "Cannot open file [" + path + "]\n";
+		return false;
+	}
+
+	/// a few chunks per thread so uneven chunks even out, every chunk ends after a '\n'
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+	int chunkCount = (int)std::min((size_t)(thread_pool->GetWorkerCount() + 1) * 4, size / OBJ_CHUNK_MIN_BYTES + 1);
+	chunks.clear();
+	chunks.resize(chunkCount);
+	const char* begin = data;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		const char* end = data + size;
+		if (i < chunkCount - 1 && size > 0)
+		{
+			end = std::max(data + size * (i + 1) / chunkCount, begin);
+			const char* newLine = (const char*)memchr(end, '\n', data + size - end);
+			end = newLine != NULL ? newLine + 1 : data + size;
+		}
+		chunks[i].begin = begin;
+		chunks[i].end = end;
+		begin = end;
+	}
+
+	thread_pool->ParallelFor(chunkCount, [this](int i) { ParseChunk(chunks[i]); });
+
+	/// a zero face index stops the load like in tinyobj
+	int lineBase = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		if (chunks[i].errorLine >= 0)
+		{
+			std::stringstream ss;
+			ss << "Failed parse `f' line(e.g. zero value for face index. line " << lineBase + chunks[i].errorLine << ".)\n";
+			err += ss.str();
+			chunks.clear();
+			return false;
+		}
+		lineBase += chunks[i].lineCount;
+	}
+
+	/// attribute offsets and starting smoothing group of every chunk
+	std::vector<int> bases(chunkCount * 3);
+	std::vector<unsigned int> startSmoothingIds(chunkCount);
+	int counts[3] = { 0, 0, 0 };
+	unsigned int smoothingId = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		Chunk& chunk = chunks[i];
+		bases[i * 3 + 0] = counts[0];
+		bases[i * 3 + 1] = counts[1];
+		bases[i * 3 + 2] = counts[2];
+		counts[0] += (int)chunk.vertices.size() / 3;
+		counts[1] += (int)chunk.texcoords.size() / 2;
+		counts[2] += (int)chunk.normals.size() / 3;
+		startSmoothingIds[i] = smoothingId;
+		if (chunk.endSmoothingId != SMOOTHING_INHERIT)
+			smoothingId = chunk.endSmoothingId;
+	}
+	attrib.vertices.resize(counts[0] * 3);
+	attrib.colors.resize(counts[0] * 3);
+	attrib.texcoords.resize(counts[1] * 2);
+	attrib.normals.resize(counts[2] * 3);
+
+	/// attributes first, a polygon may use positions of any chunk
+	thread_pool->ParallelFor(chunkCount, [this, &bases, &attrib](int i) {
+		Chunk& chunk = chunks[i];
+		if (chunk.vertices.size() > 0)
+		{
+			memcpy(&attrib.vertices[bases[i * 3 + 0] * 3], chunk.vertices.data(), chunk.vertices.size() * sizeof(float));
+			memcpy(&attrib.colors[bases[i * 3 + 0] * 3], chunk.colors.data(), chunk.colors.size() * sizeof(float));
+		}
+		if (chunk.texcoords.size() > 0)
+			memcpy(&attrib.texcoords[bases[i * 3 + 1] * 2], chunk.texcoords.data(), chunk.texcoords.size() * sizeof(float));
+		if (chunk.normals.size() > 0)
+			memcpy(&attrib.normals[bases[i * 3 + 2] * 3], chunk.normals.data(), chunk.normals.size() * sizeof(float));
+	});
+	thread_pool->ParallelFor(chunkCount, [this, &bases, &startSmoothingIds, &attrib](int i) {
+		TriangulateChunk(chunks[i], &bases[i * 3], startSmoothingIds[i], attrib.vertices);
+	});
+
+	/// merge in file order, the state changes are applied the way tinyobj::LoadObj applies them
+	std::string baseDir = mtlBasePath;
+	if (!baseDir.empty())
+	{
+#ifndef _WIN32
+		const char dirSep = '/';
+#else
+		const char dirSep = '\\';
+#endif
+		if (baseDir[baseDir.length() - 1] != dirSep)
+			baseDir += dirSep;
+	}
+	tinyobj::MaterialFileReader mtlReader(baseDir);
+	std::map<std::string, int> materialMap;
+
+	int materialId = -1;
+	std::string name;
+	tinyobj::shape_t shape;
+	bool isGroupPending = false;	/// faces since the last group, object or material change
+	int maxIndex[3] = { -1, -1, -1 };
+	lineBase = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		Chunk& chunk = chunks[i];
+		int faceIdx = 0;
+		for (size_t j = 0; j < chunk.commands.size(); j++)
+		{
+			Command& command = chunk.commands[j];
+			if (command.faceIdx > faceIdx)
+			{
+				AppendFaces(chunk, faceIdx, command.faceIdx, materialId, name, shape);
+				isGroupPending = true;
+				faceIdx = command.faceIdx;
+			}
+
+			if (command.type == Command_UseMtl)
+			{
+				std::map<std::string, int>::iterator iter = materialMap.find(command.text);
+				int newMaterialId = iter != materialMap.end() ? iter->second : -1;
+				if (newMaterialId != materialId)
+				{
+					isGroupPending = false;
+					materialId = newMaterialId;
+				}
+			}
+			else if (command.type == Command_MtlLib)
+			{
+				std::vector<std::string> fileNames;
+				std::stringstream ss(command.text);
+				std::string fileName;
+				while (std::getline(ss, fileName, ' '))
+					fileNames.push_back(fileName);
+
+				if (fileNames.empty())
+				{
+					std::stringstream ws;
+					ws << "Looks like empty filename for mtllib. Use default material (line " << lineBase + command.line << ".)\n";
+					warn += ws.str();
+				}
+				else
+				{
+					bool isFound = false;
+					for (size_t k = 0; k < fileNames.size() && !isFound; k++)
+					{
+						std::string mtlWarn;
+						std::string mtlErr;
+						mtl_paths.push_back(baseDir + fileNames[k]);
+						isFound = mtlReader(fileNames[k], &materials, &materialMap, &mtlWarn, &mtlErr);
+						warn += mtlWarn;
+						err += mtlErr;
+					}
+					if (!isFound)
+						warn += "Failed to load material file(s). Use default material.\n";
+				}
+			}
+			else if (command.type == Command_Group)
+			{
+				if (shape.mesh.indices.size() > 0)
+					shapes.push_back(std::move(shape));
+				shape = tinyobj::shape_t();
+				isGroupPending = false;
+
+				if (command.text.empty())
+				{
+					std::stringstream ws;
+					ws << "Empty group name. line: " << lineBase + command.line << "\n";
+					warn += ws.str();
+				}
+				name = command.text;
+			}
+			else if (command.type == Command_Object)
+			{
+				if (isGroupPending)
+					shapes.push_back(std::move(shape));
+				shape = tinyobj::shape_t();
+				isGroupPending = false;
+				name = command.text;
+			}
+		}
+		if (faceIdx < (int)chunk.faces.size())
+		{
+			AppendFaces(chunk, faceIdx, (int)chunk.faces.size(), materialId, name, shape);
+			isGroupPending = true;
+		}
+
+		for (int k = 0; k < 3; k++)
+			maxIndex[k] = std::max(maxIndex[k], chunk.maxIndex[k]);
+		lineBase += chunk.lineCount;
+
+		/// the chunk is merged, its memory goes back before the next one is copied
+		chunk = Chunk();
+	}
+	if (isGroupPending || shape.mesh.indices.size() > 0)
+		shapes.push_back(std::move(shape));
+	chunks.clear();
+
+	const char* outOfBounds[3] = { "Vertex indices", "Vertex texcoord indices", "Vertex normal indices" };
+	for (int k = 0; k < 3; k++)
+	{
+		if (maxIndex[k] >= counts[k])
+		{
+			std::stringstream ws;
+			ws << outOfBounds[k] << " out of bounds (line " << lineBase << ".)\n\n";
+			warn += ws.str();
+		}
+	}
+
+	return true;
+}
+
+void ObjLoader::ParseChunk(Chunk& chunk)
+{
+	chunk.lineCount = 0;
+	chunk.errorLine = -1;
+	unsigned int smoothingId = SMOOTHING_INHERIT;
+
+	const char* p = chunk.begin;
+	while (p < chunk.end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+		const char* next = lineEnd != NULL ? lineEnd + 1 : chunk.end;
+		if (lineEnd == NULL)
+			lineEnd = chunk.end;
+		if (lineEnd > p && lineEnd[-1] == '\r')
+			lineEnd--;
+		chunk.lineCount++;
+
+		const char* token = SkipSpace(p, lineEnd);
+		p = next;
+		if (token == lineEnd || token[0] == '#')
+			continue;
+
+		int length = (int)(lineEnd - token);
+		char c0 = token[0];
+		char c1 = length > 1 ? token[1] : '\0';
+		char c2 = length > 2 ? token[2] : '\0';
+
+		/// vertex, missing colors are white
+		if (c0 == 'v' && IsSpace(c1))
+		{
+			token += 2;
+			float x = ParseReal(token, lineEnd, 0.0f);
+			float y = ParseReal(token, lineEnd, 0.0f);
+			float z = ParseReal(token, lineEnd, 0.0f);
+			float r, g, b;
+			if (!(TryParseReal(token, lineEnd, r) && TryParseReal(token, lineEnd, g) && TryParseReal(token, lineEnd, b)))
+				r = g = b = 1.0f;
+			chunk.vertices.push_back(x);
+			chunk.vertices.push_back(y);
+			chunk.vertices.push_back(z);
+			chunk.colors.push_back(r);
+			chunk.colors.push_back(g);
+			chunk.colors.push_back(b);
+			continue;
+		}
+
+		/// normal
+		if (c0 == 'v' && c1 == 'n' && IsSpace(c2))
+		{
+			token += 3;
+			chunk.normals.push_back(ParseReal(token, lineEnd, 0.0f));
+			chunk.normals.push_back(ParseReal(token, lineEnd, 0.0f));
+			chunk.normals.push_back(ParseReal(token, lineEnd, 0.0f));
+			continue;
+		}
+
+		/// texcoord
+		if (c0 == 'v' && c1 == 't' && IsSpace(c2))
+		{
+			token += 3;
+			chunk.texcoords.push_back(ParseReal(token, lineEnd, 0.0f));
+			chunk.texcoords.push_back(ParseReal(token, lineEnd, 0.0f));
+			continue;
+		}
+
+		/// face, v, v/vt, v//vn or v/vt/vn corners
+		if (c0 == 'f' && IsSpace(c1))
+		{
+			token = SkipSpace(token + 2, lineEnd);
+			int vertexCount = (int)chunk.vertices.size() / 3;
+			int texcoordCount = (int)chunk.texcoords.size() / 2;
+			int normalCount = (int)chunk.normals.size() / 3;
+
+			Face face;
+			face.firstCorner = (int)chunk.corners.size();
+			face.cornerCount = 0;
+			face.smoothingId = smoothingId;
+			while (token < lineEnd && *token != '\r')
+			{
+				FaceCorner corner;
+				corner.vt = -1;
+				corner.vn = -1;
+				corner.relative = 0;
+				bool isValid = FixIndex(ParseIndex(token, lineEnd), vertexCount, 1, corner.v, corner.relative);
+				if (isValid && token < lineEnd && *token == '/')
+				{
+					token++;
+					if (token < lineEnd && *token == '/')
+					{
+						token++;
+						isValid = FixIndex(ParseIndex(token, lineEnd), normalCount, 4, corner.vn, corner.relative);
+					}
+					else
+					{
+						isValid = FixIndex(ParseIndex(token, lineEnd), texcoordCount, 2, corner.vt, corner.relative);
+						if (isValid && token < lineEnd && *token == '/')
+						{
+							token++;
+							isValid = FixIndex(ParseIndex(token, lineEnd), normalCount, 4, corner.vn, corner.relative);
+						}
+					}
+				}
+				if (!isValid)
+				{
+					if (chunk.errorLine < 0)
+						chunk.errorLine = chunk.lineCount;
+					break;
+				}
+
+				chunk.corners.push_back(corner);
+				face.cornerCount++;
+				while (token < lineEnd && (IsSpace(*token) || *token == '\r'))
+					token++;
+			}
+			chunk.faces.push_back(face);
+			continue;
+		}
+
+		Command command;
+		command.faceIdx = (int)chunk.faces.size();
+		command.line = chunk.lineCount;
+
+		/// use mtl, the name is the rest of the line
+		if (length > 6 && strncmp(token, "usemtl", 6) == 0 && IsSpace(token[6]))
+		{
+			command.type = Command_UseMtl;
+			command.text.assign(token + 7, lineEnd);
+			chunk.commands.push_back(command);
+			continue;
+		}
+
+		/// load mtl
+		if (length > 6 && strncmp(token, "mtllib", 6) == 0 && IsSpace(token[6]))
+		{
+			command.type = Command_MtlLib;
+			command.text.assign(token + 7, lineEnd);
+			chunk.commands.push_back(command);
+			continue;
+		}
+
+		/// group name, several names are joined with a space
+		if (c0 == 'g' && IsSpace(c1))
+		{
+			command.type = Command_Group;
+			token = SkipSpace(token + 1, lineEnd);
+			while (token < lineEnd)
+			{
+				const char* nameEnd = TokenEnd(token, lineEnd);
+				if (!command.text.empty())
+					command.text += ' ';
+				command.text.append(token, nameEnd);
+				token = nameEnd;
+				while (token < lineEnd && (IsSpace(*token) || *token == '\r'))
+					token++;
+			}
+			chunk.commands.push_back(command);
+			continue;
+		}
+
+		/// object name
+		if (c0 == 'o' && IsSpace(c1))
+		{
+			command.type = Command_Object;
+			command.text.assign(token + 2, lineEnd);
+			chunk.commands.push_back(command);
+			continue;
+		}
+
+		/// smoothing group, "off" or a number
+		if (c0 == 's' && IsSpace(c1))
+		{
+			token = SkipSpace(token + 2, lineEnd);
+			if (token == lineEnd)
+				continue;
+			if (lineEnd - token >= 3 && strncmp(token, "off", 3) == 0)
+				smoothingId = 0;
+			else
+			{
+				int id = ParseIndex(token, lineEnd);
+				smoothingId = id < 0 ? 0 : (unsigned int)id;
+			}
+			continue;
+		}
+
+		/// lines, points, tags and unknown commands are skipped
+	}
+	chunk.endSmoothingId = smoothingId;
+}
+
+void ObjLoader::TriangulateChunk(Chunk& chunk, const int* bases, unsigned int startSmoothingId, const std::vector<float>& vertices)
+{
+	chunk.maxIndex[0] = chunk.maxIndex[1] = chunk.maxIndex[2] = -1;
+	chunk.triangles.reserve(chunk.corners.size() * 3 / 2);
+	chunk.triangleSmoothingIds.reserve(chunk.faces.size());
+	chunk.faceTriangleEnds.resize(chunk.faces.size());
+
+	std::vector<tinyobj::index_t> polygon;
+	for (size_t i = 0; i < chunk.faces.size(); i++)
+	{
+		Face& face = chunk.faces[i];
+		polygon.resize(face.cornerCount);
+		for (int j = 0; j < face.cornerCount; j++)
+		{
+			FaceCorner& corner = chunk.corners[face.firstCorner + j];
+			tinyobj::index_t& idx = polygon[j];
+			idx.vertex_index = corner.v + ((corner.relative & 1) ? bases[0] : 0);
+			idx.texcoord_index = corner.vt + ((corner.relative & 2) ? bases[1] : 0);
+			idx.normal_index = corner.vn + ((corner.relative & 4) ? bases[2] : 0);
+			chunk.maxIndex[0] = std::max(chunk.maxIndex[0], idx.vertex_index);
+			chunk.maxIndex[1] = std::max(chunk.maxIndex[1], idx.texcoord_index);
+			chunk.maxIndex[2] = std::max(chunk.maxIndex[2], idx.normal_index);
+		}
+
+		/// faces with less than 3 corners give no triangle
+		int triangleCount = (int)chunk.triangles.size() / 3;
+		if (face.cornerCount == 3)
+			chunk.triangles.insert(chunk.triangles.end(), polygon.begin(), polygon.end());
+		else if (face.cornerCount > 3)
+			TriangulatePolygon(polygon, vertices, chunk.triangles);
+		triangleCount = (int)chunk.triangles.size() / 3 - triangleCount;
+
+		unsigned int smoothingId = face.smoothingId != SMOOTHING_INHERIT ? face.smoothingId : startSmoothingId;
+		chunk.triangleSmoothingIds.insert(chunk.triangleSmoothingIds.end(), triangleCount, smoothingId);
+		chunk.faceTriangleEnds[i] = (int)chunk.triangles.size() / 3;
+	}
+
+	/// the parsed corners are no longer needed
+	std::vector<FaceCorner>().swap(chunk.corners);
+	std::vector<float>().swap(chunk.vertices);
+	std::vector<float>().swap(chunk.colors);
+	std::vector<float>().swap(chunk.texcoords);
+	std::vector<float>().swap(chunk.normals);
+}
+
+void ObjLoader::TriangulatePolygon(std::vector<tinyobj::index_t>& polygon, const std::vector<float>& vertices, std::vector<tinyobj::index_t>& triangles)
+{
+	/// ear clipping in the plane of the first corner that is not collinear, same as tinyobj so the triangles match
+	size_t vertexSize = vertices.size();
+	size_t polyCount = polygon.size();
+	size_t axes[2] = { 1, 2 };
+	for (size_t k = 0; k < polyCount; k++)
+	{
+		size_t vi0 = (size_t)polygon[(k + 0) % polyCount].vertex_index;
+		size_t vi1 = (size_t)polygon[(k + 1) % polyCount].vertex_index;
+		size_t vi2 = (size_t)polygon[(k + 2) % polyCount].vertex_index;
+		if (vi0 * 3 + 2 >= vertexSize || vi1 * 3 + 2 >= vertexSize || vi2 * 3 + 2 >= vertexSize)
+			continue;
+		float e0x = vertices[vi1 * 3 + 0] - vertices[vi0 * 3 + 0];
+		float e0y = vertices[vi1 * 3 + 1] - vertices[vi0 * 3 + 1];
+		float e0z = vertices[vi1 * 3 + 2] - vertices[vi0 * 3 + 2];
+		float e1x = vertices[vi2 * 3 + 0] - vertices[vi1 * 3 + 0];
+		float e1y = vertices[vi2 * 3 + 1] - vertices[vi1 * 3 + 1];
+		float e1z = vertices[vi2 * 3 + 2] - vertices[vi1 * 3 + 2];
+		float cx = fabsf(e0y * e1z - e0z * e1y);
+		float cy = fabsf(e0z * e1x - e0x * e1z);
+		float cz = fabsf(e0x * e1y - e0y * e1x);
+		const float epsilon = std::numeric_limits<float>::epsilon();
+		if (cx > epsilon || cy > epsilon || cz > epsilon)
+		{
+			if (!(cx > cy && cx > cz))
+			{
+				axes[0] = 0;
+				if (cz > cx && cz > cy)
+					axes[1] = 1;
+			}
+			break;
+		}
+	}
+
+	float area = 0.0f;
+	for (size_t k = 0; k < polyCount; k++)
+	{
+		size_t vi0 = (size_t)polygon[(k + 0) % polyCount].vertex_index;
+		size_t vi1 = (size_t)polygon[(k + 1) % polyCount].vertex_index;
+		if (vi0 * 3 + axes[0] >= vertexSize || vi0 * 3 + axes[1] >= vertexSize ||
+			vi1 * 3 + axes[0] >= vertexSize || vi1 * 3 + axes[1] >= vertexSize)
+			continue;
+		area += (vertices[vi0 * 3 + axes[0]] * vertices[vi1 * 3 + axes[1]] - vertices[vi0 * 3 + axes[1]] * vertices[vi1 * 3 + axes[0]]) * 0.5f;
+	}
+
+	size_t guessVert = 0;
+	size_t remainingIterations = polyCount;
+	size_t previousRemaining = polyCount;
+	float vx[3];
+	float vy[3];
+	while (polygon.size() > 3 && remainingIterations > 0)
+	{
+		polyCount = polygon.size();
+		if (guessVert >= polyCount)
+			guessVert -= polyCount;
+
+		/// no corner was cut the last round, give up after a full turn
+		if (previousRemaining != polyCount)
+		{
+			previousRemaining = polyCount;
+			remainingIterations = polyCount;
+		}
+		else
+			remainingIterations--;
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			size_t vi = (size_t)polygon[(guessVert + k) % polyCount].vertex_index;
+			bool isValid = vi * 3 + axes[0] < vertexSize && vi * 3 + axes[1] < vertexSize;
+			vx[k] = isValid ? vertices[vi * 3 + axes[0]] : 0.0f;
+			vy[k] = isValid ? vertices[vi * 3 + axes[1]] : 0.0f;
+		}
+		float cross = (vx[1] - vx[0]) * (vy[2] - vy[1]) - (vy[1] - vy[0]) * (vx[2] - vx[1]);
+		if (cross * area < 0.0f)
+		{
+			/// a reflex corner
+			guessVert++;
+			continue;
+		}
+
+		bool isOverlap = false;
+		for (size_t otherVert = 3; otherVert < polyCount; otherVert++)
+		{
+			size_t vi = (size_t)polygon[(guessVert + otherVert) % polyCount].vertex_index;
+			if (vi * 3 + axes[0] >= vertexSize || vi * 3 + axes[1] >= vertexSize)
+				continue;
+			if (PointInTriangle(vx, vy, vertices[vi * 3 + axes[0]], vertices[vi * 3 + axes[1]]))
+			{
+				isOverlap = true;
+				break;
+			}
+		}
+		if (isOverlap)
+		{
+			guessVert++;
+			continue;
+		}
+
+		/// an ear, cut its middle corner
+		for (size_t k = 0; k < 3; k++)
+			triangles.push_back(polygon[(guessVert + k) % polyCount]);
+		polygon.erase(polygon.begin() + (guessVert + 1) % polyCount);
+	}
+
+	if (polygon.size() == 3)
+		triangles.insert(triangles.end(), polygon.begin(), polygon.end());
+}
+
+void ObjLoader::AppendFaces(const Chunk& chunk, int faceBegin, int faceEnd, int materialId, const std::string& name, tinyobj::shape_t& shape)
+{
+	int triangleBegin = faceBegin > 0 ? chunk.faceTriangleEnds[faceBegin - 1] : 0;
+	int triangleEnd = chunk.faceTriangleEnds[faceEnd - 1];
+	int triangleCount = triangleEnd - triangleBegin;
+
+	shape.name = name;
+	tinyobj::mesh_t& mesh = shape.mesh;
+	mesh.indices.insert(mesh.indices.end(), chunk.triangles.begin() + triangleBegin * 3, chunk.triangles.begin() + triangleEnd * 3);
+	mesh.num_face_vertices.insert(mesh.num_face_vertices.end(), triangleCount, 3);
+	mesh.material_ids.insert(mesh.material_ids.end(), triangleCount, materialId);
+	mesh.smoothing_group_ids.insert(mesh.smoothing_group_ids.end(), chunk.triangleSmoothingIds.begin() + triangleBegin, chunk.triangleSmoothingIds.begin() + triangleEnd);
+}
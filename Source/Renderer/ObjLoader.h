@@ -0,0 +1,100 @@
+#ifndef __OBJ_LOADER_H__
+#define __OBJ_LOADER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+/*view https://github.com/syoyo/tinyobjloader for more informations*/
+
+class ThreadPool;
+
+/// obj loading on all cores, the memory mapped file is cut at line boundaries and every chunk is parsed on its own,
+/// the chunks are merged in file order into the same attrib, shapes and materials as a triangulating tinyobj::LoadObj,
+/// lines, points and tags are skipped, .mtl files still go through tinyobj
+class ObjLoader
+{
+public:
+	ObjLoader(ThreadPool* pool);	/// the pool is shared with the caller, e.g. for MeshBuilder::BuildShapes
+	virtual ~ObjLoader();
+
+	bool Load(const std::string& path, const std::string& mtlBasePath, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes,
+		std::vector<tinyobj::material_t>& materials, std::string& warn, std::string& err);
+
+	/// every .mtl file the last Load tried, found or not, the materials depend on them
+	const std::vector<std::string>& GetMtlPaths() { return mtl_paths; }
+
+private:
+	enum CommandType
+	{
+		Command_UseMtl = 0,
+		Command_MtlLib,
+		Command_Group,
+		Command_Object,
+	};
+
+	/// one face corner, -1 for a missing texcoord/normal, a relative index is kept local to its chunk until the merge
+	struct FaceCorner
+	{
+		int v;
+		int vt;
+		int vn;
+		int relative;	/// bit 0 v, bit 1 vt, bit 2 vn
+	};
+
+	struct Face
+	{
+		int firstCorner;
+		int cornerCount;
+		unsigned int smoothingId;
+	};
+
+	/// state changes between the faces of a chunk, applied in order by the merge
+	struct Command
+	{
+		CommandType type;
+		int faceIdx;	/// faces of the chunk before the command
+		int line;	/// line in the chunk
+		std::string text;
+	};
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+
+		std::vector<float> vertices;
+		std::vector<float> colors;
+		std::vector<float> normals;
+		std::vector<float> texcoords;
+		std::vector<FaceCorner> corners;
+		std::vector<Face> faces;
+		std::vector<Command> commands;
+
+		int lineCount;
+		int errorLine;	/// first face with a zero index, -1 for none
+		unsigned int endSmoothingId;	/// SMOOTHING_INHERIT when the chunk has no 's' line
+
+		/// triangulated by the second pass
+		std::vector<tinyobj::index_t> triangles;
+		std::vector<unsigned int> triangleSmoothingIds;
+		std::vector<int> faceTriangleEnds;	/// triangles of faces 0 ... i
+		int maxIndex[3];	/// v, vt, vn
+	};
+
+	void ParseChunk(Chunk& chunk);
+	/// resolves the indices with the vertex, texcoord and normal counts of the chunks before it
+	void TriangulateChunk(Chunk& chunk, const int* bases, unsigned int startSmoothingId, const std::vector<float>& vertices);
+	static void TriangulatePolygon(std::vector<tinyobj::index_t>& polygon, const std::vector<float>& vertices, std::vector<tinyobj::index_t>& triangles);
+
+	/// appends the triangles of faces [faceBegin, faceEnd) of a chunk to the shape
+	void AppendFaces(const Chunk& chunk, int faceBegin, int faceEnd, int materialId, const std::string& name, tinyobj::shape_t& shape);
+
+private:
+	ThreadPool* thread_pool;	/// not owned
+	std::vector<Chunk> chunks;
+	std::vector<std::string> mtl_paths;
+};
+
+#endif // !__OBJ_LOADER_H__
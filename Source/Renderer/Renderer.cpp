@@ -2,6 +2,7 @@
 #include "Camera.h"
 #include "Texture.h"
 #include "Light.h"
+#include "ClusteCulling.h"
 
 Renderer::Type Renderer::renderer_type = Renderer::Vulkan;
 
@@ -25,9 +26,8 @@ void Renderer::SetDefaultTex(std::string& path)
 	default_tex = new Texture(path);
 }
 
-void Renderer::AddLight(PointLight* light)
+void Renderer::FillLightData(PointLight* light, PointLightData& lightData, LightShapeData& shapeData)
 {
-	PointLightData lightData;
 	lightData.color = light->GetColor();
 	lightData.pos = light->GetPosition();
 	lightData.radius = light->GetRadius();
@@ -38,12 +38,54 @@ void Renderer::AddLight(PointLight* light)
 	lightData.attenuation_constant = light->GetAttenuationConstant();
 	lightData.attenuation_linear = light->GetAttenuationLinear();
 	lightData.attenuation_exp = light->GetAttenuationExp();
+
+	memset(&shapeData, 0, sizeof(LightShapeData));
+	shapeData.type = LightType_Point;
+	SpotLight* spot = dynamic_cast<SpotLight*>(light);
+	AreaLight* area = dynamic_cast<AreaLight*>(light);
+	if (spot != NULL)
+	{
+		shapeData.type = LightType_Spot;
+		shapeData.direction = glm::normalize(spot->GetDirection());
+		shapeData.spot_cos_outer = cosf(spot->GetOuterAngle());
+		shapeData.spot_cos_inner = cosf(std::min(spot->GetInnerAngle(), spot->GetOuterAngle()));
+	}
+	else if (area != NULL)
+	{
+		shapeData.type = LightType_Area;
+		shapeData.direction = glm::normalize(area->GetNormal());
+		shapeData.tangent = glm::normalize(area->GetTangent() - shapeData.direction * glm::dot(area->GetTangent(), shapeData.direction));
+		shapeData.area_half_width = area->GetWidth() * 0.5f;
+		shapeData.area_half_height = area->GetHeight() * 0.5f;
+	}
+	RawCpu::light_bounds(lightData, shapeData);
+}
+
+void Renderer::AddLight(PointLight* light)
+{
+	PointLightData lightData;
+	LightShapeData shapeData;
+	FillLightData(light, lightData, shapeData);
 	light_infos.push_back(lightData);
+	light_shapes.push_back(shapeData);
+}
+
+void Renderer::UpdateLight(int idx, PointLight* light)
+{
+	assert(idx >= 0 && idx < light_infos.size());
+	FillLightData(light, light_infos[idx], light_shapes[idx]);
+}
+
+void Renderer::RemoveLight(int idx)
+{
+	assert(idx >= 0 && idx < light_infos.size());
+	light_infos[idx].enabled = 0;
 }
 
 void Renderer::ClearLight()
 {
 	light_infos.clear();
+	light_shapes.clear();
 }
 
 void Renderer::RenderBegin()
@@ -5,19 +5,15 @@
 #include <vector>
 
 #include "GLMConfig.h"
+#include "ClusteData.h"
+#include "MeshAsset.h"
 
 #define GLFW_INCLUDE_VULKAN
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
 
-#define MAX_LIGHT_NUM 16
-#define CLUSTE_X 16
-#define CLUSTE_Y 9
-#define CLUSTE_Z 24
-#define CLUSTE_NUM (CLUSTE_X * CLUSTE_Y * CLUSTE_Z)
-#define MAX_MESH_SHADER_PRIMITIVE 126
-#define MAX_MESH_SHADER_VERTICES 64
+#define MAX_LIGHT_NUM 16	/// dx12 forward lights, vulkan light buffers grow with the scene
 
 struct DWParam
 {
@@ -37,23 +33,6 @@ struct DWParam
 	};
 };
 
-/// one buffers(simple first)
-struct Vertex {
-	glm::vec4 pos;
-	glm::vec4 color;
-	glm::vec4 texcoord;
-	glm::vec4 normal;
-	glm::vec4 tangent;
-};
-
-/// meshlet for mesh shading
-struct Meshlet {
-	glm::uint vertexCount;
-	glm::uint primCount;
-	glm::uint vertexBegin;
-	glm::uint primBegin;
-};
-
 /// transform data for shader
 struct TransformData {
 	glm::mat4x4 mvp;
@@ -68,7 +47,12 @@ struct TransformData {
 	float zFar;
 	float scale;
 	float bias;
-	glm::vec4 light_pos[MAX_LIGHT_NUM];	/// obj_space
+	glm::mat4x4 world_model;	/// inverse model, world to obj space
+	glm::uint light_count;
+	glm::uint lightListFormat;	/// ClusteLightFormat
+	glm::uint lightMaskWords;	/// words per cluste of the bitmask format
+	glm::uint light_padding[1];
+	glm::vec4 light_pos[MAX_LIGHT_NUM];	/// obj_space, dx12 only
 };
 
 /// material flag for shader
@@ -77,44 +61,6 @@ struct MaterialData {
 	int has_normal_map;
 };
 
-/// light structure for shader
-struct PointLightData {
-	glm::vec3 pos;
-	float radius;
-	glm::vec3 color;
-	glm::uint enabled;
-	float ambient_intensity;
-	float diffuse_intensity;
-	float specular_intensity;
-	float attenuation_constant;
-	float attenuation_linear;
-	float attenuation_exp;
-	glm::vec2 padding;
-};
-
-/// cluste AABB
-struct VolumeTileAABB {
-	glm::vec4 minPoint;
-	glm::vec4 maxPoint;
-};
-
-/// screen to view for cluste calculate
-struct ScreenToView
-{
-	glm::mat4 inverseProjection;
-	glm::mat4 viewMatrix;
-	glm::uvec4 tileSizes;
-	glm::uvec2 screenDimensions;
-	float zNear;
-	float zFar;
-};
-
-/// light grid
-struct LightGrid {
-	glm::uint offset;
-	glm::uint count;
-};
-
 class Model;
 class Camera;
 class GeoData;
@@ -154,6 +100,10 @@ public:
 	virtual void OnSceneExit() = 0;
 
 	virtual void AddLight(PointLight* light);
+	/// idx is the AddLight order, a moved or changed light keeps its slot
+	virtual void UpdateLight(int idx, PointLight* light);
+	/// the slot is only disabled so the other lights keep their indices
+	virtual void RemoveLight(int idx);
 	virtual void ClearLight();
 
 	virtual int GetFrameBufferCount() = 0;
@@ -189,7 +139,10 @@ protected:
 
 	bool isRenderBegin;
 
+	static void FillLightData(PointLight* light, PointLightData& lightData, LightShapeData& shapeData);
+
 	std::vector<PointLightData> light_infos;
+	std::vector<LightShapeData> light_shapes;	/// same slots as light_infos
 
 	static Renderer::Type renderer_type;
 };
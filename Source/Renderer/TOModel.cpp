@@ -5,6 +5,9 @@
 #include "Camera.h"
 #include "Application/Application.h"
 #include "TOModel.h"
+#include "ObjLoader.h"
+#include "MeshCache.h"
+#include "Common/ThreadPool.h"
 
 TOModel::TOModel()
 {
@@ -50,10 +53,34 @@ bool TOModel::LoadFromPath(std::string path)
 		basePath = path.substr(0, slashIdx);
 	}
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), basePath.c_str()))
+	/// the baked meshes are mapped from the cache, the obj is only parsed and built again when the cache is missing or stale
+	bool isFlipWinding = geo_data->IsFlipWinding();
+	bool isMeshlet = geo_data->IsMeshletUsed();
+	std::string cachePath = MeshCache::GetPath(path, isFlipWinding, isMeshlet);
+	MeshCache cache;
+	if (cache.Open(cachePath, path, isFlipWinding, isMeshlet))
 	{
-		throw std::runtime_error(err);
-		return false;
+		cache.GetMaterials(materials);
+	}
+	else
+	{
+		/// parsed and built on all cores, attrib, shapes and assets only live until they are baked
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		ThreadPool pool;
+		ObjLoader loader(&pool);
+		if (!loader.Load(path, basePath, attrib, shapes, materials, warn, err))
+		{
+			throw std::runtime_error(err);
+			return false;
+		}
+
+		std::vector<MeshAsset> assets;
+		MeshBuilder::BuildShapes(&pool, attrib, shapes, isFlipWinding, isMeshlet, assets);
+
+		/// a cache that cannot be written is still used from memory this time
+		cache.Bake(path, loader.GetMtlPaths(), assets, materials, isFlipWinding, isMeshlet);
+		cache.Write(cachePath);
 	}
 
 	/// material instances
@@ -70,7 +97,7 @@ bool TOModel::LoadFromPath(std::string path)
 		material_insts.push_back(mat);
 	}
 
-	geo_data->initTinyObjData(attrib, shapes, materials);
+	geo_data->initMeshCache(cache);
 
 	return true;
 }
\ No newline at end of file
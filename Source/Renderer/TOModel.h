@@ -22,8 +22,7 @@ public:
 	bool LoadTestData();	/// test usage
 
 private:
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
+	/// the material instances keep pointers into it
 	std::vector<tinyobj::material_t> materials;
 
 	/// material instance
@@ -0,0 +1,216 @@
+#include <math.h>
+
+#include "TangentGenerator.h"
+#include "MeshAsset.h"
+
+#define TANGENT_EPSILON 1e-20f
+
+TangentGenerator::TangentGenerator()
+{
+}
+
+TangentGenerator::~TangentGenerator()
+{
+}
+
+void TangentGenerator::Gather(const MeshAsset& asset)
+{
+	size_t vertexNum = asset.vertexs.size();
+	pos_x.resize(vertexNum);
+	pos_y.resize(vertexNum);
+	pos_z.resize(vertexNum);
+	uv_x.resize(vertexNum);
+	uv_y.resize(vertexNum);
+	normal_x.resize(vertexNum);
+	normal_y.resize(vertexNum);
+	normal_z.resize(vertexNum);
+	for (size_t i = 0; i < vertexNum; i++)
+	{
+		const Vertex& vertex = asset.vertexs[i];
+		pos_x[i] = vertex.pos.x;
+		pos_y[i] = vertex.pos.y;
+		pos_z[i] = vertex.pos.z;
+		/// the v of the obj, before it was flipped for the top-down images, like the tools baking the normal maps
+		uv_x[i] = vertex.texcoord.x;
+		uv_y[i] = 1.0f - vertex.texcoord.y;
+
+		/// the obj normals are not always unit length
+		glm::vec3 n = glm::vec3(vertex.normal);
+		float len2 = glm::dot(n, n);
+		if (len2 > TANGENT_EPSILON)
+			n /= sqrtf(len2);
+		normal_x[i] = n.x;
+		normal_y[i] = n.y;
+		normal_z[i] = n.z;
+	}
+}
+
+void TangentGenerator::BuildCorners(const std::vector<int>& indices, int triBegin, int triEnd)
+{
+	for (int tri = triBegin; tri < triEnd; tri++)
+	{
+		const int* idx = &indices[tri * 3];
+		glm::vec3 p[3], n[3];
+		glm::vec2 uv[3];
+		for (int k = 0; k < 3; k++)
+		{
+			p[k] = glm::vec3(pos_x[idx[k]], pos_y[idx[k]], pos_z[idx[k]]);
+			uv[k] = glm::vec2(uv_x[idx[k]], uv_y[idx[k]]);
+			n[k] = glm::vec3(normal_x[idx[k]], normal_y[idx[k]], normal_z[idx[k]]);
+		}
+
+		glm::vec3 d1 = p[1] - p[0];
+		glm::vec3 d2 = p[2] - p[0];
+		glm::vec2 t21 = uv[1] - uv[0];
+		glm::vec2 t31 = uv[2] - uv[0];
+
+		/// a corner without a normal uses the face normal
+		if (glm::dot(n[0], n[0]) * glm::dot(n[1], n[1]) * glm::dot(n[2], n[2]) <= TANGENT_EPSILON)
+		{
+			glm::vec3 faceNormal = glm::cross(d1, d2);
+			float faceLen2 = glm::dot(faceNormal, faceNormal);
+			if (faceLen2 > TANGENT_EPSILON)
+				faceNormal *= 1.0f / sqrtf(faceLen2);
+			for (int k = 0; k < 3; k++)
+			{
+				if (glm::dot(n[k], n[k]) <= TANGENT_EPSILON)
+					n[k] = faceNormal;
+			}
+		}
+
+		/// a triangle without uv area adds nothing, dP/du and dP/dv are only needed up to their length,
+		/// so the division by the uv area is left to its sign
+		float area = t21.x * t31.y - t21.y * t31.x;
+		bool isDegenerate = fabsf(area) <= TANGENT_EPSILON;
+		glm::vec3 dpdu = (d1 * t31.y - d2 * t21.y) * (area < 0.0f ? -1.0f : 1.0f);
+		glm::vec3 dpdv = (d2 * t21.x - d1 * t31.x) * (area < 0.0f ? -1.0f : 1.0f);
+
+		/// mirrored against the corner normals, not the winding, so both triangle windings of the back ends agree
+		tri_mirrored[tri] = !isDegenerate && glm::dot(glm::cross(dpdu, dpdv), n[0] + n[1] + n[2]) < 0.0f;
+
+		for (int k = 0; k < 3; k++)
+		{
+			int corner = tri * 3 + k;
+			corner_x[corner] = 0.0f;
+			corner_y[corner] = 0.0f;
+			corner_z[corner] = 0.0f;
+			if (isDegenerate)
+				continue;
+
+			glm::vec3 t = dpdu - n[k] * glm::dot(n[k], dpdu);
+			float tLen2 = glm::dot(t, t);
+			if (tLen2 <= TANGENT_EPSILON)
+				continue;
+
+			/// corner angle in the plane of the normal
+			glm::vec3 e1 = p[(k + 1) % 3] - p[k];
+			glm::vec3 e2 = p[(k + 2) % 3] - p[k];
+			e1 -= n[k] * glm::dot(n[k], e1);
+			e2 -= n[k] * glm::dot(n[k], e2);
+			float e1Len2 = glm::dot(e1, e1);
+			float e2Len2 = glm::dot(e2, e2);
+			if (e1Len2 <= TANGENT_EPSILON || e2Len2 <= TANGENT_EPSILON)
+				continue;
+			float cosAngle = glm::dot(e1, e2) * (1.0f / sqrtf(e1Len2 * e2Len2));
+			float angle = acosf(cosAngle < -1.0f ? -1.0f : (cosAngle > 1.0f ? 1.0f : cosAngle));
+
+			t *= angle * (1.0f / sqrtf(tLen2));
+			corner_x[corner] = t.x;
+			corner_y[corner] = t.y;
+			corner_z[corner] = t.z;
+		}
+	}
+}
+
+void TangentGenerator::Accumulate(const std::vector<int>& indices)
+{
+	for (size_t corner = 0; corner < indices.size(); corner++)
+	{
+		int slot = indices[corner] * 2 + tri_mirrored[corner / 3];
+		sum_x[slot] += corner_x[corner];
+		sum_y[slot] += corner_y[corner];
+		sum_z[slot] += corner_z[corner];
+		slot_vertex[slot] = indices[corner];
+	}
+}
+
+void TangentGenerator::Normalize(int slotBegin, int slotEnd)
+{
+	for (int slot = slotBegin; slot < slotEnd; slot++)
+	{
+		if (slot_vertex[slot] < 0)
+			continue;
+
+		float len2 = sum_x[slot] * sum_x[slot] + sum_y[slot] * sum_y[slot] + sum_z[slot] * sum_z[slot];
+		if (len2 > TANGENT_EPSILON)
+		{
+			float invLen = 1.0f / sqrtf(len2);
+			sum_x[slot] *= invLen;
+			sum_y[slot] *= invLen;
+			sum_z[slot] *= invLen;
+			continue;
+		}
+
+		/// only degenerate triangles, any tangent perpendicular to the normal
+		int vertex = slot / 2;
+		glm::vec3 n = glm::vec3(normal_x[vertex], normal_y[vertex], normal_z[vertex]);
+		glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 t = axis - n * glm::dot(n, axis);
+		t /= sqrtf(glm::dot(t, t));
+		sum_x[slot] = t.x;
+		sum_y[slot] = t.y;
+		sum_z[slot] = t.z;
+	}
+}
+
+void TangentGenerator::Build(MeshAsset& asset)
+{
+	int vertexNum = (int)asset.vertexs.size();
+	int triNum = (int)asset.indices.size() / 3;
+
+	Gather(asset);
+
+	corner_x.resize((size_t)triNum * 3);
+	corner_y.resize((size_t)triNum * 3);
+	corner_z.resize((size_t)triNum * 3);
+	tri_mirrored.resize(triNum);
+	for (size_t s = 0; s < asset.subMeshes.size(); s++)
+	{
+		const SubMeshRange& range = asset.subMeshes[s];
+		BuildCorners(asset.indices, range.indexStart / 3, (range.indexStart + range.indexCount) / 3);
+	}
+
+	sum_x.assign((size_t)vertexNum * 2, 0.0f);
+	sum_y.assign((size_t)vertexNum * 2, 0.0f);
+	sum_z.assign((size_t)vertexNum * 2, 0.0f);
+	slot_vertex.assign((size_t)vertexNum * 2, -1);
+	Accumulate(asset.indices);
+	Normalize(0, vertexNum * 2);
+
+	/// the unmirrored slot keeps the vertex, the mirrored one gets a copy when both are used
+	int copyNum = 0;
+	for (int v = 0; v < vertexNum; v++)
+	{
+		if (slot_vertex[v * 2] >= 0 && slot_vertex[v * 2 + 1] >= 0)
+			copyNum++;
+	}
+	asset.vertexs.reserve(vertexNum + copyNum);
+	for (int v = 0; v < vertexNum; v++)
+	{
+		if (slot_vertex[v * 2] >= 0 && slot_vertex[v * 2 + 1] >= 0)
+		{
+			slot_vertex[v * 2 + 1] = (int)asset.vertexs.size();
+			asset.vertexs.push_back(asset.vertexs[v]);
+		}
+	}
+
+	for (int slot = 0; slot < vertexNum * 2; slot++)
+	{
+		if (slot_vertex[slot] < 0)
+			continue;
+		asset.vertexs[slot_vertex[slot]].tangent = glm::vec4(sum_x[slot], sum_y[slot], sum_z[slot], (slot & 1) ? -1.0f : 1.0f);
+	}
+
+	for (size_t corner = 0; corner < asset.indices.size(); corner++)
+		asset.indices[corner] = slot_vertex[asset.indices[corner] * 2 + tri_mirrored[corner / 3]];
+}
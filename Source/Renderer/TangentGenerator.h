@@ -0,0 +1,44 @@
+#ifndef __TANGENT_GENERATOR_H__
+#define __TANGENT_GENERATOR_H__
+
+#include <vector>
+
+struct MeshAsset;
+
+/// mikktspace style per vertex tangents: the uv tangent of every triangle is projected onto the plane of each corner normal
+/// and summed per vertex weighted by the corner angle, mirrored and unmirrored uv mappings are summed apart, a vertex used
+/// by both gets one copy, tangent.w is the bitangent sign, bitangent = w * cross(normal, tangent)
+/// all buffers are structure of arrays and kept between the meshes, so one generator per thread
+class TangentGenerator
+{
+public:
+	TangentGenerator();
+	virtual ~TangentGenerator();
+
+	/// replaces the tangents of all vertices and remaps the indices of the mirrored corners to their copies
+	void Build(MeshAsset& asset);
+
+private:
+	void Gather(const MeshAsset& asset);
+	/// weighted tangents of the corners of triangles [triBegin, triEnd), only writes those corners so sub meshes can run side by side
+	void BuildCorners(const std::vector<int>& indices, int triBegin, int triEnd);
+	/// sums the corners per vertex and mirroring, a linear pass over the corners
+	void Accumulate(const std::vector<int>& indices);
+	void Normalize(int slotBegin, int slotEnd);
+
+private:
+	/// vertex attributes
+	std::vector<float> pos_x, pos_y, pos_z;
+	std::vector<float> uv_x, uv_y;
+	std::vector<float> normal_x, normal_y, normal_z;
+
+	/// per corner, angle weighted tangent in the plane of the corner normal
+	std::vector<float> corner_x, corner_y, corner_z;
+	std::vector<unsigned char> tri_mirrored;
+
+	/// per vertex and mirroring, slot vertex * 2 + mirrored
+	std::vector<float> sum_x, sum_y, sum_z;
+	std::vector<int> slot_vertex;	/// vertex of the slot, -1 for an unused slot
+};
+
+#endif // !__TANGENT_GENERATOR_H__
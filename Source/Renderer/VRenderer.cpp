@@ -1,8 +1,11 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
+#include <chrono>
 
 #include "Application/Application.h"
 #include "Common/Utils.h"
+#include "Common/ThreadPool.h"
+#include "Common/AsyncJob.h"
 #include "Camera.h"
 #include "Texture.h"
 #include "TexDataVK.h"
@@ -13,8 +16,12 @@
 #include "extensions_vk.hpp"
 
 #include "ClusteCulling.h"
+#include "ClusteCuller.h"
+#include "ClusteGridTuner.h"
+#include "ClusteValidator.h"
 #include "GeoDataVK.h"
 #include "MaterialVK.h"
+#include "Shader/shader_interface.h"
 
 /// prevent multi-define
 #define __ISPC_STRUCT_LightGrid__
@@ -22,7 +29,6 @@
 
 #define VERTEX_BUFFER_BIND_ID 0
 
-static ispc::PointLightDataISPC* pointLightISPCDatas = NULL;
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -52,9 +58,74 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* win)
 	isClusteShadingState = false;
 	isIspcState = false;
 	isCpuClusteCullState = false;
+	isMultiThreadCull = false;
+	isMultiThreadCullState = false;
+	isLightCentricCull = false;
+	isLightCentricCullState = false;
+	isSimdCull = false;
+	isSimdCullState = false;
+	isAutoTuneGrid = false;
+	isAutoTuneGridState = false;
+	isValidateCull = false;
+	isValidateCullState = false;
+	isIncrementalCull = true;
+	isIncrementalCullState = true;
+	isDepthBoundsCull = false;
+	isDepthBoundsCullState = false;
+	isActiveCull = false;
+	isActiveCullState = false;
+	isCompactLightList = false;
+	isCompactLightListState = false;
+	isBitmaskCull = false;
+	isBitmaskCullState = false;
+	isAsyncCull = true;
+	isAsyncCullState = true;
+	isCullStats = false;
+	isCullStatsState = false;
+	memset(&cull_stats, 0, sizeof(ClusteCullStats));
+	cull_stats_head = 0;
+	cull_stats_count = 0;
+	cull_stats_log = NULL;
+	cull_stats_frame = 0;
+	is_depth_readback_supported = false;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		is_depth_readback_ready[i] = false;
+		light_data_dirty[i] = glm::ivec2(INT_MAX, 0);
+	}
+	memset(&cull_screen_to_view, 0, sizeof(ScreenToView));
+	cull_light_cap = 0;
+	cull_mode = -1;
+	cull_light_format = LightFormat_List;
+	light_mask_words = 0;
+	recull_cluste_count = 0;
+	memset(&cull_validation, 0, sizeof(ClusteValidation));
+	cull_validation.firstMismatch = -1;
+	cpuCullTime = 0.0;
+	cull_wait_time = 0.0;
+	gpuCullTime = 0;
+	last_frame_time = 0.0;
 	compSupportTimeStamp = false;
-	last_command_buffer_idx = UINT_MAX;
+	comp_buffer_serial = 1;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		comp_record_serials[i] = 0;
+		comp_dispatched[i] = false;
+		comp_aabb_dispatched[i] = false;
+	}
+	comp_aabb_project_version = UINT_MAX;
+	frame_slot = 0;
+	debug_messenger = VK_NULL_HANDLE;
+	cull_serial = 1;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		light_list_serials[i] = 0;
+	light_capacity = MAX_LIGHT_NUM;
+	cluste_light_cap = DEFAULT_CLUSTE_LIGHT_CAP;
+	cluste_light_cap_state = DEFAULT_CLUSTE_LIGHT_CAP;
+	cluste_overflow.clustes = 0;
+	cluste_overflow.lights = 0;
 	CreateInstance();
+	CreateDebugMessenger();
 	CreateSurface();
 	PickPhysicalDevice();
 	CreateLogicDevice();
@@ -63,11 +134,19 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* win)
 	CreateRenderPass();
 	CreateGraphicsPipeline();
 
-	pointLightISPCDatas = new ispc::PointLightDataISPC[MAX_LIGHT_NUM];
+	thread_pool = new ThreadPool();
+	cull_job = new AsyncJob();
+	cluste_culler = new ClusteCuller(thread_pool);
+	grid_tuner = new ClusteGridTuner();
+	cluste_validator = new ClusteValidator();
 
-	/// set computer number and tile size in screen space
+	/// set computer number and tile size in screen space, default grid until SetClusteGrid
 	tile_size_x = (unsigned int)std::ceilf(winWidth / (float)CLUSTE_X);;
 	group_num = glm::uvec3(CLUSTE_X, CLUSTE_Y, CLUSTE_Z);
+	cluste_num = CLUSTE_NUM;
+	tile_size_state = tile_size_x;
+	z_slices_state = group_num.z;
+	light_index_capacity = LightIndexCapacity(light_capacity);
 
 	///if( isClusteShading )
 		InitializeClusteRendering();
@@ -125,8 +204,8 @@ void VulkanRenderer::CreateInstance()
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 
-	createInfo.enabledExtensionCount = glfwExtensionCount;
-	createInfo.ppEnabledExtensionNames = glfwExtensions;
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
 		createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -161,33 +240,41 @@ void VulkanRenderer::CleanImage(VkImage& image, VkDeviceMemory& imageMem, VkImag
 
 void VulkanRenderer::CleanUp()
 {
-	if (pointLightISPCDatas != NULL)
-	{
-		delete[] pointLightISPCDatas;
-		pointLightISPCDatas = NULL;
-	}
-
-	for (int i = 0; i < light_uniform_buffers.size(); i++)
-	{
-		UnmapBufferMemory(light_uniform_buffer_memorys[i]);
-		CleanBuffer(light_uniform_buffers[i], light_uniform_buffer_memorys[i]);
-	}
+	delete cull_job;	/// waits for a running cull
+	SetCullStatsLog(NULL);
+	delete cluste_culler;
+	delete thread_pool;
+	delete grid_tuner;
+	delete cluste_validator;
 
-	for( int i = 0; i < 6; i++ )
+	for( int i = 0; i < 2 * MAX_FRAMES_IN_FLIGHT; i++ )
 		vkDestroyQueryPool(device, query_pool[i], nullptr);
 
-	UnmapBufferMemory(transform_uniform_buffer_memory);
-	CleanBuffer(transform_uniform_buffer, transform_uniform_buffer_memory);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		UnmapBufferMemory(transform_uniform_buffer_memory[i]);
+		CleanBuffer(transform_uniform_buffer[i], transform_uniform_buffer_memory[i]);
+	}
 
 	vkDestroyImageView(device, depth_image_view, nullptr);
 	vkDestroyImage(device, depth_image, nullptr);
 	vkFreeMemory(device, depth_image_memory, nullptr);
+	if (is_depth_readback_supported)
+	{
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			UnmapBufferMemory(depth_readback_buffer_memory[i]);
+			CleanBuffer(depth_readback_buffer[i], depth_readback_buffer_memory[i]);
+		}
+	}
 
 	vkDestroySemaphore(device, compute_finished_semaphore, nullptr);
-	vkDestroySemaphore(device, render_finished_semaphore, nullptr);
-	vkDestroySemaphore(device, image_available_semaphore, nullptr);
-	vkDestroyFence(device, in_flight_fence, nullptr);
-	vkDestroyFence(device, comp_wait_fence, nullptr);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
+		vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
+		vkDestroyFence(device, in_flight_fences[i], nullptr);
+	}
 
 	vkDestroyCommandPool(device, command_pool, nullptr);
 	vkDestroyDescriptorSetLayout(device, desc_layout, nullptr);
@@ -239,9 +326,41 @@ void VulkanRenderer::CleanUp()
 	vkDestroySwapchainKHR(device, swap_chain, nullptr);
 	vkDestroyDevice(device, nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (debug_messenger != VK_NULL_HANDLE)
+	{
+		PFN_vkDestroyDebugUtilsMessengerEXT destroyMessenger = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
+		destroyMessenger(instance, debug_messenger, nullptr);
+	}
 	vkDestroyInstance(instance, nullptr);
 }
 
+static VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessengerCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type,
+	const VkDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData)
+{
+	printf("validation %s: %s\n", severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? "error" : "warning", callbackData->pMessage);
+	return VK_FALSE;
+}
+
+void VulkanRenderer::CreateDebugMessenger()
+{
+	if (!enableValidationLayers)
+		return;
+
+	/// the extension loader only runs after the device is created, the messenger is taken straight from the instance
+	PFN_vkCreateDebugUtilsMessengerEXT createMessenger = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+	if (createMessenger == NULL)
+		throw std::runtime_error("failed to find vkCreateDebugUtilsMessengerEXT!");
+
+	VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	createInfo.pfnUserCallback = DebugMessengerCallback;
+
+	if (createMessenger(instance, &createInfo, nullptr, &debug_messenger) != VK_SUCCESS)
+		throw std::runtime_error("failed to set up debug messenger!");
+}
+
 bool VulkanRenderer::CheckValidationLayerSupport()
 {
 	uint32_t layerCount;
@@ -737,7 +856,7 @@ void VulkanRenderer::CreateRenderPass()
 	depthAttachment.format = FindDepthFormat();
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;	/// copied out for the depth bounds light rejection
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -760,10 +879,11 @@ void VulkanRenderer::CreateRenderPass()
 	VkSubpassDependency dependency = {};
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	/// the frames in flight share the depth image, the clear and depth tests wait for the depth tests and the readback copy of the frame before
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
 	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo = {};
@@ -833,9 +953,9 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	psCode = "Data/shader/tinyobj_frag.spv";
 	taskCode = "Data/shader/tinyobj_task.spv";
 	meshCode = "Data/shader/tinyobj_mesh.spv";
-	auto vertShaderCode = Utils::readFile(vsCode);
-	auto fragShaderCode = Utils::readFile(psCode);
-	auto meshShaderCode = Utils::readFile(meshCode);
+	auto vertShaderCode = ReadShader(vsCode);
+	auto fragShaderCode = ReadShader(psCode);
+	auto meshShaderCode = ReadShader(meshCode);
 	std::vector<char> taskShaderCode;
 	try{
 		taskShaderCode = Utils::readFile(taskCode);
@@ -1004,9 +1124,9 @@ void VulkanRenderer::CreateGraphicsPipeline()
 
 	VkDescriptorSetLayoutBinding layoutBinding2 = {};
 	layoutBinding2.binding = 2;
-	layoutBinding2.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	layoutBinding2.descriptorCount = MAX_LIGHT_NUM;
-	layoutBinding2.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_MESH_BIT_NV;
+	layoutBinding2.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	layoutBinding2.descriptorCount = 1;
+	layoutBinding2.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	layoutBinding2.pImmutableSamplers = NULL;
 
 	VkDescriptorSetLayoutBinding lightIndexLayoutBinding = {};
@@ -1038,7 +1158,14 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	samplerLayoutBinding1.pImmutableSamplers = nullptr;
 	samplerLayoutBinding1.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	std::array<VkDescriptorSetLayoutBinding, 7> bindings = { layoutBinding, layoutBinding1, layoutBinding2, samplerLayoutBinding, samplerLayoutBinding1,lightIndexLayoutBinding, lightGridLayoutBinding };
+	VkDescriptorSetLayoutBinding lightShapeLayoutBinding = {};
+	lightShapeLayoutBinding.binding = 7;
+	lightShapeLayoutBinding.descriptorCount = 1;
+	lightShapeLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	lightShapeLayoutBinding.pImmutableSamplers = nullptr;
+	lightShapeLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 8> bindings = { layoutBinding, layoutBinding1, layoutBinding2, samplerLayoutBinding, samplerLayoutBinding1,lightIndexLayoutBinding, lightGridLayoutBinding, lightShapeLayoutBinding };
 	VkDescriptorSetLayoutCreateInfo descriptorLayout = {};
 	descriptorLayout.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descriptorLayout.pNext = NULL;
@@ -1150,6 +1277,38 @@ void VulkanRenderer::CreateGraphicsPipeline()
 	}
 }
 
+std::vector<char> VulkanRenderer::ReadShader(const std::string& path)
+{
+	std::vector<char> code = Utils::readFile(path);
+
+	/// the default of the SHADER_INTERFACE_CONSTANT_ID specialization constant, decorations and constants survive stripping
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(code.data());
+	size_t wordNum = code.size() / sizeof(uint32_t);
+	uint32_t versionId = 0;
+	int version = -1;
+	if (wordNum >= 5 && words[0] == 0x07230203)
+	{
+		for (size_t i = 5; i < wordNum; )
+		{
+			uint32_t opcode = words[i] & 0xffff;
+			uint32_t wordCount = words[i] >> 16;
+			if (wordCount == 0 || i + wordCount > wordNum)
+				break;
+			/// OpDecorate id SpecId constant_id
+			if (opcode == 71 && wordCount == 4 && words[i + 2] == 1 && words[i + 3] == SHADER_INTERFACE_CONSTANT_ID)
+				versionId = words[i + 1];
+			/// OpSpecConstant type id value, the decorations come first
+			else if (opcode == 50 && wordCount == 4 && versionId != 0 && words[i + 2] == versionId)
+				version = (int)words[i + 3];
+			i += wordCount;
+		}
+	}
+
+	if (version != SHADER_INTERFACE_VERSION)
+		throw std::runtime_error(path + " was built for another shader interface version, rebuild the shaders!");
+	return code;
+}
+
 VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
 {
 	VkShaderModuleCreateInfo createInfo = {};
@@ -1169,19 +1328,20 @@ void VulkanRenderer::CreateCompPipeline()
 {
 	QueueFamilyIndices indices = FindQueueFamilies(physical_device);
 
-	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[6] = {
+	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[7] = {
 		{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
 		{1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
 		{2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
 		{3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
 		{4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
-		{5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0}
+		{5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0},
+		{6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0}
 	};
 
 	/// desc set for compute shader
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		0, 0, 6, descriptorSetLayoutBindings
+		0, 0, 7, descriptorSetLayoutBindings
 	};
 	vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCreateInfo, NULL, &comp_desc_layout);
 
@@ -1203,7 +1363,7 @@ void VulkanRenderer::CreateCompPipeline()
 			0, 0,
 			{
 				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-				0, 0, VK_SHADER_STAGE_COMPUTE_BIT, comp_cluste_shader_module = createShaderModule(Utils::readFile("Data/shader/cluste_calc.spv")), "main", 0
+				0, 0, VK_SHADER_STAGE_COMPUTE_BIT, comp_cluste_shader_module = createShaderModule(ReadShader("Data/shader/cluste_calc.spv")), "main", 0
 			},
 			comp_pipeline_layout, 0, 0
 		},
@@ -1212,7 +1372,7 @@ void VulkanRenderer::CreateCompPipeline()
 			0, 0,
 			{
 				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-				0, 0, VK_SHADER_STAGE_COMPUTE_BIT, cluste_cull_shader_module = createShaderModule(Utils::readFile("Data/shader/cluste_culling.spv")), "main", 0
+				0, 0, VK_SHADER_STAGE_COMPUTE_BIT, cluste_cull_shader_module = createShaderModule(ReadShader("Data/shader/cluste_culling.spv")), "main", 0
 			},
 			comp_pipeline_layout, 0, 0
 		},
@@ -1233,7 +1393,7 @@ void VulkanRenderer::CreateCompPipeline()
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = comp_command_pool;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = 2 * swap_chain_images.size();
+	allocInfo.commandBufferCount = 2 * MAX_FRAMES_IN_FLIGHT;
 
 	if (vkAllocateCommandBuffers(device, &allocInfo, comp_command_buffers) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate command buffers!");
@@ -1248,7 +1408,7 @@ void VulkanRenderer::InitializeClusteRendering()
 	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
 	createInfo.queryCount = 2;
 
-	for (int i = 0; i < 6; i++)
+	for (int i = 0; i < 2 * MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		VkResult res = vkCreateQueryPool(device, &createInfo, nullptr, &query_pool[i]);
 		assert(res == VK_SUCCESS);
@@ -1264,12 +1424,14 @@ void VulkanRenderer::InitializeClusteRendering()
 
 void VulkanRenderer::AllocateCompDescriptorSets(VkDescriptorSet* descSets)
 {
-	VkDescriptorSetLayout desc_layouts[3] = { comp_desc_layout, comp_desc_layout, comp_desc_layout };
+	VkDescriptorSetLayout desc_layouts[MAX_FRAMES_IN_FLIGHT];
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		desc_layouts[i] = comp_desc_layout;
 	VkDescriptorSetAllocateInfo allocInfo[1];
 	allocInfo[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo[0].pNext = NULL;
 	allocInfo[0].descriptorPool = comp_desc_pool;
-	allocInfo[0].descriptorSetCount = swap_chain_images.size();
+	allocInfo[0].descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
 	allocInfo[0].pSetLayouts = desc_layouts;
 	vkAllocateDescriptorSets(device, allocInfo, descSets);
 }
@@ -1279,83 +1441,249 @@ void VulkanRenderer::CreateCompDescriptorSets()
 	/// allocate desc sets
 	AllocateCompDescriptorSets(comp_desc_set);
 
+	/// tile aabb and light grids
+	CreateGridBuffers();
+
+	/// screen to view
+	VkDeviceSize bufferSize = sizeof(ScreenToView);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateLocalStorageBuffer(&screen_to_view_buffer_data[i], (uint32_t)bufferSize, screen_to_view_buffer[i], screen_to_view_buffer_memory[i]);
+		ScreenToView* stv = (ScreenToView*)screen_to_view_buffer_data[i];
+		stv->screenDimensions = glm::uvec2(winWidth, winHeight);
+		stv->tileSizes = glm::uvec4(group_num, tile_size_x);
+		screen_to_view_buffer_info[i].buffer = screen_to_view_buffer[i];
+		screen_to_view_buffer_info[i].offset = 0;
+		screen_to_view_buffer_info[i].range = bufferSize;
+	}
+
+	/// light datas and light indexes
+	CreateLightBuffers();
+
+	/// global index count, cap and overflow
+	bufferSize = sizeof(ClusteCullCounter);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateLocalStorageBuffer(&index_count_buffer_data[i], (uint32_t)bufferSize, index_count_buffer[i], index_count_buffer_memory[i]);
+		memset(index_count_buffer_data[i], 0, bufferSize);
+		index_count_buffer_info[i].buffer = index_count_buffer[i];
+		index_count_buffer_info[i].offset = 0;
+		index_count_buffer_info[i].range = bufferSize;
+	}
+}
+
+void VulkanRenderer::CreateGridBuffers()
+{
 	/// tile aabb
-	VkDeviceSize bufferSize = sizeof(VolumeTileAABB) * CLUSTE_NUM;
+	VkDeviceSize bufferSize = sizeof(VolumeTileAABB) * cluste_num;
 	CreateLocalStorageBuffer(&tile_aabbs_buffer_data, (uint32_t)bufferSize, tile_aabbs_buffer, tile_aabbs_buffer_memory);
 	tile_aabbs_buffer_info.buffer = tile_aabbs_buffer;
 	tile_aabbs_buffer_info.offset = 0;
 	tile_aabbs_buffer_info.range = bufferSize;
 
-	/// screen to view
-	bufferSize = sizeof(ScreenToView);
-	CreateLocalStorageBuffer(&screen_to_view_buffer_data, (uint32_t)bufferSize, screen_to_view_buffer, screen_to_view_buffer_memory);
-	ScreenToView* stv = (ScreenToView*)screen_to_view_buffer_data;
-	stv->screenDimensions = glm::uvec2(winWidth, winHeight);
-	stv->tileSizes = glm::uvec4(group_num, tile_size_x);
-	screen_to_view_buffer_info.buffer = screen_to_view_buffer;
-	screen_to_view_buffer_info.offset = 0;
-	screen_to_view_buffer_info.range = bufferSize;
-
-	/// light datas
-	bufferSize = sizeof(PointLightData) * MAX_LIGHT_NUM;
-	CreateLocalStorageBuffer(&light_datas_buffer_data, (uint32_t)bufferSize, light_datas_buffer, light_datas_buffer_memory);
-	light_datas_buffer_info.buffer = light_datas_buffer;
-	light_datas_buffer_info.offset = 0;
-	light_datas_buffer_info.range = bufferSize;
+	/// new buffers, the compute descriptor sets are rewritten and the tile aabbs rebuilt
+	comp_buffer_serial++;
+	comp_aabb_project_version = UINT_MAX;
+
+	/// light grids
+	bufferSize = sizeof(LightGrid) * cluste_num;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateGraphicsStorageBuffer(NULL, (uint32_t)bufferSize, gpu_light_grids_buffer[i], gpu_light_grids_buffer_memory[i]);
+		gpu_light_grids_buffer_info[i].buffer = gpu_light_grids_buffer[i];
+		gpu_light_grids_buffer_info[i].offset = 0;
+		gpu_light_grids_buffer_info[i].range = bufferSize;
+		CreateLocalStorageBuffer(&light_grids_slot_data[i], (uint32_t)bufferSize, local_light_grids_buffer[i], local_light_grids_buffer_memory[i]);
+		memset(light_grids_slot_data[i], 0, bufferSize);
+		local_light_grids_buffer_info[i].buffer = local_light_grids_buffer[i];
+		local_light_grids_buffer_info[i].offset = 0;
+		local_light_grids_buffer_info[i].range = bufferSize;
+		light_list_serials[i] = 0;
+	}
+	light_grids_buffer_data = light_grids_slot_data[frame_slot];
+}
+
+void VulkanRenderer::ReleaseGridBuffers()
+{
+	UnmapBufferMemory(tile_aabbs_buffer_memory);
+	CleanBuffer(tile_aabbs_buffer, tile_aabbs_buffer_memory);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		UnmapBufferMemory(local_light_grids_buffer_memory[i]);
+		CleanBuffer(local_light_grids_buffer[i], local_light_grids_buffer_memory[i]);
+		CleanBuffer(gpu_light_grids_buffer[i], gpu_light_grids_buffer_memory[i]);
+	}
+}
+
+void VulkanRenderer::ResizeClusteGrid(unsigned int tileSize, unsigned int zSlices)
+{
+	/// frames in flight may still read the old buffers
+	WaitIdle();
+	ReleaseGridBuffers();
+	tile_size_x = tileSize;
+	group_num = glm::uvec3((winWidth + tileSize - 1) / tileSize, (winHeight + tileSize - 1) / tileSize, zSlices);
+	cluste_num = group_num.x * group_num.y * group_num.z;
+	CreateGridBuffers();
+
+	/// the index list follows the cluste count
+	ReserveLightBuffers(light_infos.size());
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		((ScreenToView*)screen_to_view_buffer_data[i])->tileSizes = glm::uvec4(group_num, tile_size_x);
+	transform_data.tileSizes = glm::uvec4(group_num, tile_size_x);
+	cluste_culler->InvalidateAABBs();
+
+	tile_size_state = tileSize;
+	z_slices_state = zSlices;
+}
+
+void VulkanRenderer::UpdateGridTuner()
+{
+	double nowTime = glfwGetTime();
+	double frameMs = (nowTime - last_frame_time) * 1000.0;
+	last_frame_time = nowTime;
+
+	if (isAutoTuneGridState && !isAutoTuneGrid)
+		grid_tuner->Restart();
+	isAutoTuneGrid = isAutoTuneGridState;
+	if (!isAutoTuneGrid || !isClusteShading)
+		return;
+
+	/// cull time of the last frame, gpu time is only there with timestamp support
+	double cullMs = isCpuClusteCull ? cpuCullTime : (compSupportTimeStamp ? GetGpuCullTime() : 0.0);
+	unsigned int tileSize, zSlices;
+	if (grid_tuner->Update(winWidth, winHeight, (int)light_infos.size(), frameMs, cullMs, tileSize, zSlices))
+		SetClusteGrid(tileSize, zSlices);
+}
+
+void VulkanRenderer::CreateLightBuffers()
+{
+	/// light datas, unused entries stay zero so they are disabled
+	VkDeviceSize bufferSize = sizeof(PointLightData) * light_capacity;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateLocalStorageBuffer(&light_datas_buffer_data[i], (uint32_t)bufferSize, light_datas_buffer[i], light_datas_buffer_memory[i]);
+		memset(light_datas_buffer_data[i], 0, bufferSize);
+		light_datas_buffer_info[i].buffer = light_datas_buffer[i];
+		light_datas_buffer_info[i].offset = 0;
+		light_datas_buffer_info[i].range = bufferSize;
+	}
+
+	/// light shapes, zero is a point light
+	bufferSize = sizeof(LightShapeData) * light_capacity;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateLocalStorageBuffer(&light_shapes_buffer_data[i], (uint32_t)bufferSize, light_shapes_buffer[i], light_shapes_buffer_memory[i]);
+		memset(light_shapes_buffer_data[i], 0, bufferSize);
+		light_shapes_buffer_info[i].buffer = light_shapes_buffer[i];
+		light_shapes_buffer_info[i].offset = 0;
+		light_shapes_buffer_info[i].range = bufferSize;
+	}
+	comp_buffer_serial++;
 
 	/// light indexes
-	bufferSize = sizeof(glm::uint) * MAX_LIGHT_NUM * CLUSTE_NUM;
-	///if( !isIspc )
-		CreateGraphicsStorageBuffer(NULL, (uint32_t)bufferSize, gpu_light_indexes_buffer, gpu_light_indexes_buffer_memory);
-	///else
-		CreateLocalStorageBuffer(&light_indexes_buffer_data, (uint32_t)bufferSize, local_light_indexes_buffer, local_light_indexes_buffer_memory);
-	local_light_indexes_buffer_info.buffer = local_light_indexes_buffer;
-	local_light_indexes_buffer_info.offset = 0;
-	local_light_indexes_buffer_info.range = bufferSize;
-	gpu_light_indexes_buffer_info.buffer = gpu_light_indexes_buffer;
-	gpu_light_indexes_buffer_info.offset = 0;
-	gpu_light_indexes_buffer_info.range = bufferSize;
+	bufferSize = sizeof(glm::uint) * light_index_capacity;
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		CreateGraphicsStorageBuffer(NULL, (uint32_t)bufferSize, gpu_light_indexes_buffer[i], gpu_light_indexes_buffer_memory[i]);
+		gpu_light_indexes_buffer_info[i].buffer = gpu_light_indexes_buffer[i];
+		gpu_light_indexes_buffer_info[i].offset = 0;
+		gpu_light_indexes_buffer_info[i].range = bufferSize;
+		CreateLocalStorageBuffer(&light_indexes_slot_data[i], (uint32_t)bufferSize, local_light_indexes_buffer[i], local_light_indexes_buffer_memory[i]);
+		memset(light_indexes_slot_data[i], 0, bufferSize);
+		local_light_indexes_buffer_info[i].buffer = local_light_indexes_buffer[i];
+		local_light_indexes_buffer_info[i].offset = 0;
+		local_light_indexes_buffer_info[i].range = bufferSize;
+		light_list_serials[i] = 0;
+	}
+	light_indexes_buffer_data = light_indexes_slot_data[frame_slot];
+}
 
-	/// light grids
-	bufferSize = sizeof(LightGrid) * CLUSTE_NUM;
-	///if( !isIspc )
-		CreateGraphicsStorageBuffer(NULL, (uint32_t)bufferSize, gpu_light_grids_buffer, gpu_light_grids_buffer_memory);
-	///else
-		CreateLocalStorageBuffer(&light_grids_buffer_data, (uint32_t)bufferSize, local_light_grids_buffer, local_light_grids_buffer_memory);
-	gpu_light_grids_buffer_info.buffer = gpu_light_grids_buffer;
-	gpu_light_grids_buffer_info.offset = 0;
-	gpu_light_grids_buffer_info.range = bufferSize;
-	local_light_grids_buffer_info.buffer = local_light_grids_buffer;
-	local_light_grids_buffer_info.offset = 0;
-	local_light_grids_buffer_info.range = bufferSize;
-
-	/// global index count
-	bufferSize = sizeof(glm::uint);
-	CreateLocalStorageBuffer(&index_count_buffer_data, (uint32_t)bufferSize, index_count_buffer, index_count_buffer_memory);
-	index_count_buffer_info.buffer = index_count_buffer;
-	index_count_buffer_info.offset = 0;
-	index_count_buffer_info.range = bufferSize;
+glm::uint VulkanRenderer::LightIndexCapacity(int lightCapacity)
+{
+	/// also room for the light bitmasks of every cluste
+	glm::uint perCluste = std::max(std::min((glm::uint)lightCapacity, cluste_light_cap), ClusteCuller::GetMaskWords(lightCapacity));
+	return cluste_num * std::max(perCluste, 1u);
+}
+
+void VulkanRenderer::ReleaseLightBuffers()
+{
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		UnmapBufferMemory(light_datas_buffer_memory[i]);
+		CleanBuffer(light_datas_buffer[i], light_datas_buffer_memory[i]);
+		UnmapBufferMemory(light_shapes_buffer_memory[i]);
+		CleanBuffer(light_shapes_buffer[i], light_shapes_buffer_memory[i]);
+		UnmapBufferMemory(local_light_indexes_buffer_memory[i]);
+		CleanBuffer(local_light_indexes_buffer[i], local_light_indexes_buffer_memory[i]);
+		CleanBuffer(gpu_light_indexes_buffer[i], gpu_light_indexes_buffer_memory[i]);
+	}
+}
+
+void VulkanRenderer::ReserveLightBuffers(int lightCount)
+{
+	/// double the light capacity, the index list holds a full cluste grid of the capped light count
+	int lightCapacity = light_capacity;
+	while (lightCapacity < lightCount)
+		lightCapacity *= 2;
+	glm::uint indexCapacity = LightIndexCapacity(lightCapacity);
+	if (lightCapacity == light_capacity && indexCapacity == light_index_capacity)
+		return;
+
+	/// frames in flight may still read the old buffers
+	WaitIdle();
+	ReleaseLightBuffers();
+	light_capacity = lightCapacity;
+	light_index_capacity = indexCapacity;
+	CreateLightBuffers();
+
+	/// the new buffers are zero, every slot takes all lights again
+	MarkLightDataDirty(0, (int)light_infos.size());
+	cluste_culler->MarkAllDirty();
+}
+
+void VulkanRenderer::MarkLightDataDirty(int begin, int end)
+{
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		light_data_dirty[i].x = std::min(light_data_dirty[i].x, begin);
+		light_data_dirty[i].y = std::max(light_data_dirty[i].y, end);
+	}
+}
+
+void VulkanRenderer::UploadLightData(uint32_t slot)
+{
+	glm::ivec2& dirty = light_data_dirty[slot];
+	int end = std::min(dirty.y, light_capacity);
+	if (dirty.x >= end)
+		return;
+
+	/// lights past the count were cleared, zero disables them
+	int count = std::max(std::min(end, (int)light_infos.size()), dirty.x);
+	if (count > dirty.x)
+	{
+		memcpy((PointLightData*)light_datas_buffer_data[slot] + dirty.x, &light_infos[dirty.x], (count - dirty.x) * sizeof(PointLightData));
+		memcpy((LightShapeData*)light_shapes_buffer_data[slot] + dirty.x, &light_shapes[dirty.x], (count - dirty.x) * sizeof(LightShapeData));
+	}
+	memset((PointLightData*)light_datas_buffer_data[slot] + count, 0, (end - count) * sizeof(PointLightData));
+	memset((LightShapeData*)light_shapes_buffer_data[slot] + count, 0, (end - count) * sizeof(LightShapeData));
+	dirty = glm::ivec2(INT_MAX, 0);
 }
 
 void VulkanRenderer::ReleaseCompDescriptorSets()
 {
-	UnmapBufferMemory(tile_aabbs_buffer_memory);
-	UnmapBufferMemory(screen_to_view_buffer_memory);
-	UnmapBufferMemory(light_datas_buffer_memory);
-	///if (isIspc)
+	ReleaseGridBuffers();
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		UnmapBufferMemory(local_light_indexes_buffer_memory);
-		UnmapBufferMemory(local_light_grids_buffer_memory);
+		UnmapBufferMemory(screen_to_view_buffer_memory[i]);
+		CleanBuffer(screen_to_view_buffer[i], screen_to_view_buffer_memory[i]);
+	}
+	ReleaseLightBuffers();
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		UnmapBufferMemory(index_count_buffer_memory[i]);
+		CleanBuffer(index_count_buffer[i], index_count_buffer_memory[i]);
 	}
-	UnmapBufferMemory(index_count_buffer_memory);
-	CleanBuffer(tile_aabbs_buffer, tile_aabbs_buffer_memory);
-	CleanBuffer(screen_to_view_buffer, screen_to_view_buffer_memory);
-	CleanBuffer(light_datas_buffer, light_datas_buffer_memory);
-	CleanBuffer(local_light_indexes_buffer, local_light_indexes_buffer_memory);
-	CleanBuffer(local_light_grids_buffer, local_light_grids_buffer_memory);
-	CleanBuffer(gpu_light_indexes_buffer, gpu_light_indexes_buffer_memory);
-	CleanBuffer(gpu_light_grids_buffer, gpu_light_grids_buffer_memory);
-	CleanBuffer(index_count_buffer, index_count_buffer_memory);
 	FreeCompDescriptorSets(comp_desc_set);
 }
 
@@ -1366,39 +1694,14 @@ uint32_t VulkanRenderer::GetMaxDrawMeshTaskCount()
 	return 0;
 }
 
-void VulkanRenderer::UpdateComputeDescriptorSet()
+void VulkanRenderer::UpdateComputeDescriptorSet(int idx)
 {
-	vkWaitForFences(device, 1, &comp_wait_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-	vkResetFences(device, 1, &comp_wait_fence);
-	/*
-	VolumeTileAABB* volumnAABBs = (VolumeTileAABB*)tile_aabbs_buffer_data;
-	LightGrid* lightGrids = (LightGrid*)light_grids_buffer_data;
-	glm::uint* lightIndexs = (glm::uint*)light_indexes_buffer_data;
-	for (int i = 0; i < CLUSTE_NUM; i++)
-	{
-		LightGrid* lightGrid = lightGrids + i;
-		glm::uint* lightIndex = lightIndexs + lightGrid->offset;
-		if (i == CLUSTE_NUM/2+144*5)
-		{
-			printf("total light count(%d) offset(%d) for cluste(%d):", lightGrid->count, lightGrid->offset, i);
-			for (int j = 0; j < lightGrid->count; j++)
-			{
-				printf("%d, ", *(lightIndex + j));
-			}
-			printf("\n");
-			VolumeTileAABB* volumnAABB = volumnAABBs + i;
-			printf("volumn min:%f, %f, %f\n", volumnAABB->minPoint[0], volumnAABB->minPoint[1], volumnAABB->minPoint[2]);
-			printf("volumn max:%f, %f, %f\n", volumnAABB->maxPoint[0], volumnAABB->maxPoint[1], volumnAABB->maxPoint[2]);
-			printf("light (%d) is out posz(%f)\n", (int)volumnAABB->minPoint[3], volumnAABB->maxPoint[3]);
-		}
-	}*/
-
 	/// set descriptor sets
-	std::array<VkWriteDescriptorSet, 6> descriptorWrites = {};
+	std::array<VkWriteDescriptorSet, 7> descriptorWrites = {};
 	descriptorWrites[0] = {};
 	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[0].pNext = NULL;
-	descriptorWrites[0].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[0].dstSet = comp_desc_set[idx];
 	descriptorWrites[0].descriptorCount = 1;
 	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	descriptorWrites[0].pBufferInfo = &tile_aabbs_buffer_info;
@@ -1408,79 +1711,100 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 	descriptorWrites[1] = {};
 	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[1].pNext = NULL;
-	descriptorWrites[1].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[1].dstSet = comp_desc_set[idx];
 	descriptorWrites[1].descriptorCount = 1;
 	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrites[1].pBufferInfo = &screen_to_view_buffer_info;
+	descriptorWrites[1].pBufferInfo = &screen_to_view_buffer_info[idx];
 	descriptorWrites[1].dstArrayElement = 0;
 	descriptorWrites[1].dstBinding = 1;
 
 	descriptorWrites[2] = {};
 	descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[2].pNext = NULL;
-	descriptorWrites[2].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[2].dstSet = comp_desc_set[idx];
 	descriptorWrites[2].descriptorCount = 1;
 	descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrites[2].pBufferInfo = &light_datas_buffer_info;
+	descriptorWrites[2].pBufferInfo = &light_datas_buffer_info[idx];
 	descriptorWrites[2].dstArrayElement = 0;
 	descriptorWrites[2].dstBinding = 2;
 
 	descriptorWrites[3] = {};
 	descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[3].pNext = NULL;
-	descriptorWrites[3].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[3].dstSet = comp_desc_set[idx];
 	descriptorWrites[3].descriptorCount = 1;
 	descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrites[3].pBufferInfo = &gpu_light_indexes_buffer_info;
+	descriptorWrites[3].pBufferInfo = &gpu_light_indexes_buffer_info[idx];
 	descriptorWrites[3].dstArrayElement = 0;
 	descriptorWrites[3].dstBinding = 3;
 
 	descriptorWrites[4] = {};
 	descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[4].pNext = NULL;
-	descriptorWrites[4].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[4].dstSet = comp_desc_set[idx];
 	descriptorWrites[4].descriptorCount = 1;
 	descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrites[4].pBufferInfo = &gpu_light_grids_buffer_info;
+	descriptorWrites[4].pBufferInfo = &gpu_light_grids_buffer_info[idx];
 	descriptorWrites[4].dstArrayElement = 0;
 	descriptorWrites[4].dstBinding = 4;
 
 	descriptorWrites[5] = {};
 	descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[5].pNext = NULL;
-	descriptorWrites[5].dstSet = comp_desc_set[active_command_buffer_idx];
+	descriptorWrites[5].dstSet = comp_desc_set[idx];
 	descriptorWrites[5].descriptorCount = 1;
 	descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	descriptorWrites[5].pBufferInfo = &index_count_buffer_info;
+	descriptorWrites[5].pBufferInfo = &index_count_buffer_info[idx];
 	descriptorWrites[5].dstArrayElement = 0;
 	descriptorWrites[5].dstBinding = 5;
 
+	descriptorWrites[6] = {};
+	descriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[6].pNext = NULL;
+	descriptorWrites[6].dstSet = comp_desc_set[idx];
+	descriptorWrites[6].descriptorCount = 1;
+	descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[6].pBufferInfo = &light_shapes_buffer_info[idx];
+	descriptorWrites[6].dstArrayElement = 0;
+	descriptorWrites[6].dstBinding = 6;
+
 	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, NULL);
+}
 
+void VulkanRenderer::RecordComputeCull(int idx)
+{
+	/// recorded once and submitted every frame until a buffer is recreated
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
 	/// comp 1
-	int command_buffer_idx = active_command_buffer_idx * 2 + 0;
+	int command_buffer_idx = idx * 2 + 0;
 	vkBeginCommandBuffer(comp_command_buffers[command_buffer_idx], &beginInfo);
 
 	vkCmdResetQueryPool(comp_command_buffers[command_buffer_idx], query_pool[command_buffer_idx], 0, 2);
 	if(compSupportTimeStamp)
 		vkCmdWriteTimestamp(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool[command_buffer_idx], 0);
 
+	/// the tile aabbs are shared by the frame slots, the cull pass of the frame before may still read them
+	vkCmdPipelineBarrier(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
 	vkCmdBindPipeline(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipelines[0]);
 
-	vkCmdBindDescriptorSets(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipeline_layout, 0, 1, &comp_desc_set[active_command_buffer_idx], 0, nullptr);
+	vkCmdBindDescriptorSets(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipeline_layout, 0, 1, &comp_desc_set[idx], 0, nullptr);
 
 	vkCmdDispatch(comp_command_buffers[command_buffer_idx], group_num.x, group_num.y, group_num.z);
 
 	if(compSupportTimeStamp)
 		vkCmdWriteTimestamp(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool[command_buffer_idx], 1);
 
+	/// the cull pass reads the aabbs, also when it is submitted alone the next frames
+	VkMemoryBarrier aabbBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT };
+	vkCmdPipelineBarrier(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &aabbBarrier, 0, nullptr, 0, nullptr);
+
 	vkEndCommandBuffer(comp_command_buffers[command_buffer_idx]);
 
 	/// comp 2
-	command_buffer_idx = active_command_buffer_idx * 2 + 1;
+	command_buffer_idx = idx * 2 + 1;
 	vkBeginCommandBuffer(comp_command_buffers[command_buffer_idx], &beginInfo);
 
 	vkCmdResetQueryPool(comp_command_buffers[command_buffer_idx], query_pool[command_buffer_idx], 0, 2);
@@ -1489,9 +1813,10 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 
 	vkCmdBindPipeline(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipelines[1]);
 
-	vkCmdBindDescriptorSets(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipeline_layout, 0, 1, &comp_desc_set[active_command_buffer_idx], 0, nullptr);
+	vkCmdBindDescriptorSets(comp_command_buffers[command_buffer_idx], VK_PIPELINE_BIND_POINT_COMPUTE, comp_pipeline_layout, 0, 1, &comp_desc_set[idx], 0, nullptr);
 
-	vkCmdDispatch(comp_command_buffers[command_buffer_idx], 1, 1, 6);
+	/// one thread per cluste
+	vkCmdDispatch(comp_command_buffers[command_buffer_idx], (cluste_num + CLUSTE_CULL_GROUP_SIZE - 1) / CLUSTE_CULL_GROUP_SIZE, 1, 1);
 
 	QueueFamilyIndices indices = FindQueueFamilies(physical_device);
 	VkBufferMemoryBarrier buffer_barriers[2] =
@@ -1503,9 +1828,9 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 			0,
 			indices.computeFamily.value(),
 			indices.graphicsFamily.value(),
-			gpu_light_indexes_buffer_info.buffer,
+			gpu_light_indexes_buffer_info[idx].buffer,
 			0,
-			gpu_light_indexes_buffer_info.range,
+			gpu_light_indexes_buffer_info[idx].range,
 		},
 		{
 			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -1514,9 +1839,9 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 			0,
 			indices.computeFamily.value(),
 			indices.graphicsFamily.value(),
-			gpu_light_grids_buffer_info.buffer,
+			gpu_light_grids_buffer_info[idx].buffer,
 			0,
-			gpu_light_grids_buffer_info.range,
+			gpu_light_grids_buffer_info[idx].range,
 		},
 	};
 
@@ -1529,20 +1854,62 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 		2, buffer_barriers,
 		0, nullptr);
 
+	/// the counters are read on the host when the slot comes around again
+	VkMemoryBarrier counterBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT };
+	vkCmdPipelineBarrier(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &counterBarrier, 0, nullptr, 0, nullptr);
+
 	if(compSupportTimeStamp)
 		vkCmdWriteTimestamp(comp_command_buffers[command_buffer_idx], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, query_pool[command_buffer_idx], 1);
 
-	vkEndCommandBuffer(comp_command_buffers[command_buffer_idx]);	
-	
+	vkEndCommandBuffer(comp_command_buffers[command_buffer_idx]);
+}
+
+void VulkanRenderer::DispatchComputeCull(unsigned int projectVersion)
+{
+	/// no extra wait, Flush waited for the slot fence and the last dispatch of the slot finished before its frame,
+	/// read the overflow of that dispatch, then reset the counters for this one
+	ClusteCullCounter* counter = (ClusteCullCounter*)index_count_buffer_data[frame_slot];
+	cluste_overflow = counter->overflow;
+	if (isCullStats)
+	{
+		/// the gpu light lists are never read back, only the counters, capped are the clusters above the cap
+		memset(&cull_stats, 0, sizeof(ClusteCullStats));
+		cull_stats.lightCount = (glm::uint)light_infos.size();
+		cull_stats.activeLights = (glm::uint)light_infos.size();
+		cull_stats.clustes = cluste_num;
+		cull_stats.indexCount = counter->globalIndexCount;
+		cull_stats.avgClusteLights = (float)counter->globalIndexCount / cluste_num;
+		cull_stats.cappedClustes = counter->overflow.clustes;
+	}
+	counter->globalIndexCount = 0;
+	counter->maxLightsPerCluste = GetGpuClusteLightCap();
+	counter->overflow.clustes = 0;
+	counter->overflow.lights = 0;
+
+	/// descriptor sets and command buffers of a frame slot point at its screen to view, light datas, light lists and counters,
+	/// they only change with the buffers and the slot fence was waited in Flush
+	if (comp_record_serials[frame_slot] != comp_buffer_serial)
+	{
+		UpdateComputeDescriptorSet(frame_slot);
+		RecordComputeCull(frame_slot);
+		comp_record_serials[frame_slot] = comp_buffer_serial;
+	}
+
+	/// the aabb pass only runs when the projection or the grid changed
+	bool isAabbPass = comp_aabb_project_version != projectVersion;
+	comp_aabb_project_version = projectVersion;
+	comp_dispatched[frame_slot] = true;
+	comp_aabb_dispatched[frame_slot] = isAabbPass;
+
 	VkSemaphore signalSemaphores[] = { compute_finished_semaphore };
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 2;
-	submitInfo.pCommandBuffers = &comp_command_buffers[active_command_buffer_idx * 2];
+	submitInfo.commandBufferCount = isAabbPass ? 2 : 1;
+	submitInfo.pCommandBuffers = &comp_command_buffers[frame_slot * 2 + (isAabbPass ? 0 : 1)];
 	submitInfo.pSignalSemaphores = signalSemaphores;
 	submitInfo.signalSemaphoreCount = 1;
 
-	if (vkQueueSubmit(comp_queue, 1, &submitInfo, comp_wait_fence) != VK_SUCCESS)
+	if (vkQueueSubmit(comp_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to submit compute command buffer!");
 	}
@@ -1551,10 +1918,22 @@ void VulkanRenderer::UpdateComputeDescriptorSet()
 void VulkanRenderer::CreateDepthResources()
 {
 	VkFormat depthFormat = FindDepthFormat();
-	CreateImage(swap_chain_extent.width, swap_chain_extent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image, depth_image_memory);
+	CreateImage(swap_chain_extent.width, swap_chain_extent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image, depth_image_memory);
 	depth_image_view = CreateImageView(depth_image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	TransitionImageLayout(depth_image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+	/// the depth aspect of these formats copies out as one float per pixel
+	is_depth_readback_supported = depthFormat == VK_FORMAT_D32_SFLOAT || depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	if (is_depth_readback_supported)
+	{
+		VkDeviceSize bufferSize = sizeof(float) * swap_chain_extent.width * swap_chain_extent.height;
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, depth_readback_buffer[i], depth_readback_buffer_memory[i]);
+			vkMapMemory(device, depth_readback_buffer_memory[i], 0, bufferSize, 0, &depth_readback_buffer_data[i]);
+		}
+	}
 }
 
 VkFormat VulkanRenderer::FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
@@ -1837,14 +2216,14 @@ void VulkanRenderer::UpdateMaterial(Material* mat)
 
 	if (!mat->IsDescSetUpdated())
 	{
-		std::array<VkWriteDescriptorSet, 7> descriptorWrites = {};
+		std::array<VkWriteDescriptorSet, 8> descriptorWrites = {};
 		descriptorWrites[0] = {};
 		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[0].pNext = NULL;
 		descriptorWrites[0].dstSet = descSets[active_command_buffer_idx];
 		descriptorWrites[0].descriptorCount = 1;
 		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].pBufferInfo = &transform_uniform_buffer_info;
+		descriptorWrites[0].pBufferInfo = &transform_uniform_buffer_info[frame_slot];
 		descriptorWrites[0].dstArrayElement = 0;
 		descriptorWrites[0].dstBinding = 0;
 
@@ -1862,9 +2241,9 @@ void VulkanRenderer::UpdateMaterial(Material* mat)
 		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[2].pNext = NULL;
 		descriptorWrites[2].dstSet = descSets[active_command_buffer_idx];
-		descriptorWrites[2].descriptorCount = light_uniform_buffer_infos.size();
-		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[2].pBufferInfo = light_uniform_buffer_infos.data();
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[2].pBufferInfo = &light_datas_buffer_info[frame_slot];
 		descriptorWrites[2].dstArrayElement = 0;
 		descriptorWrites[2].dstBinding = 2;
 
@@ -1875,9 +2254,9 @@ void VulkanRenderer::UpdateMaterial(Material* mat)
 		descriptorWrites[3].descriptorCount = 1;
 		descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		if(!isClusteShading || isCpuClusteCull)
-			descriptorWrites[3].pBufferInfo = &local_light_indexes_buffer_info;
+			descriptorWrites[3].pBufferInfo = &local_light_indexes_buffer_info[frame_slot];
 		else
-			descriptorWrites[3].pBufferInfo = &gpu_light_indexes_buffer_info;
+			descriptorWrites[3].pBufferInfo = &gpu_light_indexes_buffer_info[frame_slot];
 		descriptorWrites[3].dstArrayElement = 0;
 		descriptorWrites[3].dstBinding = 3;
 
@@ -1888,9 +2267,9 @@ void VulkanRenderer::UpdateMaterial(Material* mat)
 		descriptorWrites[4].descriptorCount = 1;
 		descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		if (!isClusteShading || isCpuClusteCull)
-			descriptorWrites[4].pBufferInfo = &local_light_grids_buffer_info;
+			descriptorWrites[4].pBufferInfo = &local_light_grids_buffer_info[frame_slot];
 		else
-			descriptorWrites[4].pBufferInfo = &gpu_light_grids_buffer_info;
+			descriptorWrites[4].pBufferInfo = &gpu_light_grids_buffer_info[frame_slot];
 		descriptorWrites[4].dstArrayElement = 0;
 		descriptorWrites[4].dstBinding = 4;
 
@@ -1910,6 +2289,16 @@ void VulkanRenderer::UpdateMaterial(Material* mat)
 		descriptorWrites[6].descriptorCount = 1;
 		descriptorWrites[6].pImageInfo = normal_image_info;
 
+		descriptorWrites[7] = {};
+		descriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[7].pNext = NULL;
+		descriptorWrites[7].dstSet = descSets[active_command_buffer_idx];
+		descriptorWrites[7].descriptorCount = 1;
+		descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[7].pBufferInfo = &light_shapes_buffer_info[frame_slot];
+		descriptorWrites[7].dstArrayElement = 0;
+		descriptorWrites[7].dstBinding = 7;
+
 		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, NULL);
 
 		mat->SetDescUpdated();
@@ -1979,31 +2368,31 @@ void VulkanRenderer::BindMeshlets(VkDescriptorSet* descSets)
 
 void VulkanRenderer::SetMvpMatrix(glm::mat4x4& mvpMtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->mvp, &mvpMtx, sizeof(glm::mat4x4));
 }
 
 void VulkanRenderer::SetModelMatrix(glm::mat4x4& mtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->model, &mtx, sizeof(glm::mat4x4));
 }
 
 void VulkanRenderer::SetViewMatrix(glm::mat4x4& mtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->view, &mtx, sizeof(glm::mat4x4));
 }
 
 void VulkanRenderer::SetProjMatrix(glm::mat4x4& mtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->proj, &mtx, sizeof(glm::mat4x4));
 }
 
 void VulkanRenderer::SetProjViewMatrix(glm::mat4x4& mtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->proj_view, &mtx, sizeof(glm::mat4x4));
 }
 
@@ -2011,19 +2400,19 @@ void VulkanRenderer::SetCamPos(glm::vec3& pos)
 {
 	float zNear = camera->GetNearDistance();
 	float zFar = camera->GetFarDistance();
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
+	TransformData* transData = &transform_data;
 	memcpy(&transData->cam_pos, &pos, sizeof(glm::vec3));
 	transData->zNear = zNear;
 	transData->zFar = zFar;
-	transData->scale = (float)CLUSTE_Z / std::log2f(zFar / zNear);
-	transData->bias = -((float)CLUSTE_Z * std::log2f(zNear) / std::log2f(zFar / zNear));
+	transData->scale = (float)group_num.z / std::log2f(zFar / zNear);
+	transData->bias = -((float)group_num.z * std::log2f(zNear) / std::log2f(zFar / zNear));
 	transData->isClusteShading = isClusteShading;
 }
 
-void VulkanRenderer::SetLightPos(glm::vec4& pos, int idx)
+void VulkanRenderer::SetWorldModelMatrix(glm::mat4x4& mtx)
 {
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
-	memcpy(&transData->light_pos[idx], &pos, sizeof(glm::vec4));
+	TransformData* transData = &transform_data;
+	memcpy(&transData->world_model, &mtx, sizeof(glm::mat4x4));
 }
 
 void VulkanRenderer::SetTexture(Texture* tex)
@@ -2044,46 +2433,30 @@ void VulkanRenderer::SetNormalTexture(Texture* tex)
 
 void VulkanRenderer::CreateUniformBuffers()
 {
-	/// transform uniform buffer
+	/// transform uniform buffer of every frame in flight, written from transform_data right before the submit
 	VkDeviceSize bufferSize = sizeof(TransformData);
-	CreateUniformBuffer(&transform_uniform_buffer_data, (uint32_t)bufferSize, transform_uniform_buffer, transform_uniform_buffer_memory);
-
-	transform_uniform_buffer_info.buffer = transform_uniform_buffer;
-	transform_uniform_buffer_info.offset = 0;
-	transform_uniform_buffer_info.range = bufferSize;
-
-	TransformData* transData = (TransformData*)transform_uniform_buffer_data;
-	transData->tileSizes = glm::uvec4(group_num, tile_size_x);
-
-	for (int i = 0; i < MAX_LIGHT_NUM; i++)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		void* light_uniform_buffer_data;
-		VkBuffer light_uniform_buffer;
-		VkDeviceMemory light_uniform_buffer_memory;
-		VkDescriptorBufferInfo light_uniform_buffer_info;
-
-		bufferSize = sizeof(PointLightData);
-		CreateUniformBuffer(&light_uniform_buffer_data, (uint32_t)bufferSize, light_uniform_buffer, light_uniform_buffer_memory);
-		light_uniform_buffer_info.buffer = light_uniform_buffer;
-		light_uniform_buffer_info.offset = 0;
-		light_uniform_buffer_info.range = bufferSize;
-
-		light_uniform_buffer_datas.push_back(light_uniform_buffer_data);
-		light_uniform_buffers.push_back(light_uniform_buffer);
-		light_uniform_buffer_memorys.push_back(light_uniform_buffer_memory);
-		light_uniform_buffer_infos.push_back(light_uniform_buffer_info);
+		CreateUniformBuffer(&transform_uniform_buffer_data[i], (uint32_t)bufferSize, transform_uniform_buffer[i], transform_uniform_buffer_memory[i]);
+		transform_uniform_buffer_info[i].buffer = transform_uniform_buffer[i];
+		transform_uniform_buffer_info[i].offset = 0;
+		transform_uniform_buffer_info[i].range = bufferSize;
 	}
+
+	memset(&transform_data, 0, sizeof(TransformData));
+	transform_data.tileSizes = glm::uvec4(group_num, tile_size_x);
+	transform_data.light_count = 0;
 }
 
 void VulkanRenderer::CreateDescriptorSetsPool()
 {
-	std::array<VkDescriptorPoolSize, 7> typeCounts = {};
+	std::array<VkDescriptorPoolSize, 8> typeCounts = {};
 	typeCounts[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	typeCounts[0].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
 	typeCounts[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	typeCounts[1].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
-	typeCounts[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	typeCounts[2].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM * MAX_LIGHT_NUM;
+	typeCounts[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	typeCounts[2].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
 	typeCounts[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	typeCounts[3].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
 	typeCounts[4].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -2092,6 +2465,8 @@ void VulkanRenderer::CreateDescriptorSetsPool()
 	typeCounts[5].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
 	typeCounts[6].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	typeCounts[6].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
+	typeCounts[7].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	typeCounts[7].descriptorCount = swap_chain_images.size() * MAX_MATERIAL_NUM;
 
 	VkDescriptorPoolCreateInfo descriptorPool = {};
 	descriptorPool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -2164,24 +2539,26 @@ void VulkanRenderer::FreeMeshletDescriptorSets(VkDescriptorSet* descSets)
 
 void VulkanRenderer::CreateCompDescriptorSetsPool()
 {
-	std::array<VkDescriptorPoolSize, 6> typeCounts = {};
+	std::array<VkDescriptorPoolSize, 7> typeCounts = {};
 	typeCounts[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[0].descriptorCount = swap_chain_images.size();
+	typeCounts[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	typeCounts[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[1].descriptorCount = swap_chain_images.size();
+	typeCounts[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	typeCounts[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[2].descriptorCount = swap_chain_images.size();
+	typeCounts[2].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	typeCounts[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[3].descriptorCount = swap_chain_images.size();
+	typeCounts[3].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	typeCounts[4].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[4].descriptorCount = swap_chain_images.size();
+	typeCounts[4].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	typeCounts[5].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-	typeCounts[5].descriptorCount = swap_chain_images.size();
+	typeCounts[5].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	typeCounts[6].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	typeCounts[6].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorPoolCreateInfo descriptorPool = {};
 	descriptorPool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	descriptorPool.pNext = NULL;
-	descriptorPool.maxSets = swap_chain_images.size();
+	descriptorPool.maxSets = MAX_FRAMES_IN_FLIGHT;
 	descriptorPool.poolSizeCount = static_cast<uint32_t>(typeCounts.size());
 	descriptorPool.pPoolSizes = typeCounts.data();
 	descriptorPool.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
@@ -2191,7 +2568,7 @@ void VulkanRenderer::CreateCompDescriptorSetsPool()
 
 void VulkanRenderer::FreeCompDescriptorSets(VkDescriptorSet* descSets)
 {
-	vkFreeDescriptorSets(device, comp_desc_pool, swap_chain_images.size(), descSets);
+	vkFreeDescriptorSets(device, comp_desc_pool, MAX_FRAMES_IN_FLIGHT, descSets);
 }
 
 void VulkanRenderer::CreateSemaphores()
@@ -2203,15 +2580,22 @@ void VulkanRenderer::CreateSemaphores()
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &image_available_semaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &render_finished_semaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreInfo, nullptr, &compute_finished_semaphore) != VK_SUCCESS ||
-		vkCreateFence(device, &fenceInfo, nullptr, &in_flight_fence) != VK_SUCCESS ||
-		vkCreateFence(device, &fenceInfo, nullptr, &comp_wait_fence) != VK_SUCCESS) {
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &compute_finished_semaphore) != VK_SUCCESS) {
 
 		throw std::runtime_error("failed to create semaphores!");
 	}
-	vkResetFences(device, 1, &in_flight_fence);
+
+	/// created signalled, a slot that was never submitted is free
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &image_available_semaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &render_finished_semaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(device, &fenceInfo, nullptr, &in_flight_fences[i]) != VK_SUCCESS) {
+
+			throw std::runtime_error("failed to create semaphores!");
+		}
+	}
+	image_fences.assign(swap_chain_images.size(), VK_NULL_HANDLE);
 }
 
 void VulkanRenderer::CreateTextureSampler(VkSampler* sampler)
@@ -2246,39 +2630,40 @@ void VulkanRenderer::DestroyTextureSampler(VkSampler* sampler)
 
 void VulkanRenderer::AddLight(PointLight* light)
 {
+	/// no stall, the cpu cull is done once Flush returns and the frames in flight keep the light datas of their slot
 	Renderer::AddLight(light);
 
 	int idx = light_infos.size() - 1;
-	PointLightData& lightData = light_infos[idx];
-	memcpy(light_uniform_buffer_datas[idx], &lightData, sizeof(PointLightData));
+	ReserveLightBuffers(idx + 1);
 
-	///if (isClusteShading)
-	{	
-		///if (!isCpuClusteCull)
-		{
-			// for clust shading compute data
-			memcpy((unsigned char*)light_datas_buffer_data + idx * sizeof(PointLightData), &lightData, sizeof(PointLightData));
-		}
-		///else
-		{
-			/// set ISPC light
-			memcpy(&pointLightISPCDatas[idx].color, &lightData.color, sizeof(glm::vec3));
-			memcpy(&pointLightISPCDatas[idx].pos, &lightData.pos, sizeof(glm::vec3));
-			pointLightISPCDatas[idx].radius = lightData.radius;
-			pointLightISPCDatas[idx].enabled = lightData.enabled;
-			pointLightISPCDatas[idx].ambient_intensity = lightData.ambient_intensity;
-			pointLightISPCDatas[idx].diffuse_intensity = lightData.diffuse_intensity;
-			pointLightISPCDatas[idx].specular_intensity = lightData.specular_intensity;
-			pointLightISPCDatas[idx].attenuation_constant = lightData.attenuation_constant;
-			pointLightISPCDatas[idx].attenuation_linear = lightData.attenuation_linear;
-			pointLightISPCDatas[idx].attenuation_exp = lightData.attenuation_exp;
-		}
-	}
+	// for shading and clust shading compute data, cpu culling reads light_infos directly
+	MarkLightDataDirty(idx, idx + 1);
+	transform_data.light_count = light_infos.size();
+	cluste_culler->MarkLightDirty(idx);
+}
+
+void VulkanRenderer::UpdateLight(int idx, PointLight* light)
+{
+	Renderer::UpdateLight(idx, light);
+	MarkLightDataDirty(idx, idx + 1);
+	cluste_culler->MarkLightDirty(idx);
+}
+
+void VulkanRenderer::RemoveLight(int idx)
+{
+	Renderer::RemoveLight(idx);
+	MarkLightDataDirty(idx, idx + 1);
+	cluste_culler->MarkLightDirty(idx);
 }
 
 void VulkanRenderer::ClearLight()
 {
 	Renderer::ClearLight();
+	cluste_culler->MarkAllDirty();
+
+	/// keep the capacity, just disable every light
+	MarkLightDataDirty(0, light_capacity);
+	transform_data.light_count = 0;
 }
 
 void VulkanRenderer::SetScreenToViewData(ScreenToView* stv)
@@ -2293,10 +2678,290 @@ void VulkanRenderer::SetScreenToViewData(ScreenToView* stv)
 	stv->zFar = camera->GetFarDistance();
 }
 
+ClusteSimd::Level VulkanRenderer::GetSimdLevel()
+{
+	return cluste_culler->GetSimdLevel();
+}
+
+int VulkanRenderer::GetRejectedLightCount()
+{
+	return cluste_culler->GetRejectedLightCount();
+}
+
+const std::vector<int>& VulkanRenderer::GetActiveClustes()
+{
+	return cluste_culler->GetActiveClustes();
+}
+
+bool VulkanRenderer::IsCompactLightListSupported()
+{
+	/// light indices below 2^16, offsets and the light cap inside their packed bits
+	return light_capacity <= CLUSTE_PACKED_MAX_LIGHTS
+		&& light_index_capacity <= CLUSTE_PACKED_MAX_OFFSET && cluste_light_cap <= CLUSTE_PACKED_MAX_COUNT;
+}
+
+ClusteLightList VulkanRenderer::GetCpuLightList(bool isCompact)
+{
+	ClusteLightList output;
+	if (isCompact)
+		output = ClusteLightList((glm::uint*)light_grids_buffer_data, (unsigned short*)light_indexes_buffer_data);
+	else
+		output = ClusteLightList((LightGrid*)light_grids_buffer_data, (glm::uint*)light_indexes_buffer_data);
+	cull_counts.resize(cluste_num, 0);
+	output.counts = cull_counts.data();
+	return output;
+}
+
+void VulkanRenderer::ValidateCpuCull(VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteLightList& output)
+{
+	validate_grids.resize(cluste_num);
+	validate_indices.resize(light_index_capacity);
+	ClusteOverflow overflow;
+	RawCpu::cluste_culling(group_num.x, group_num.y, group_num.z, aabbs, viewLights, cluste_light_cap, validate_grids.data(), validate_indices.data(), overflow, cluste_culler->GetActiveFlags());
+
+	/// the validator reads 32-bit lists
+	LightGrid* grids = (LightGrid*)light_grids_buffer_data;
+	glm::uint* indices = (glm::uint*)light_indexes_buffer_data;
+	if (isBitmaskCull)
+	{
+		/// the first cap lights of each mask are what a capped list cull keeps
+		validate_test_grids.resize(cluste_num);
+		validate_test_indices.resize(light_index_capacity);
+		ClusteLightList unpacked(validate_test_grids.data(), validate_test_indices.data());
+		ClusteOverflow unpackOverflow;
+		ClusteCuller::UnpackBitmask(group_num.x, group_num.y, group_num.z, light_mask_words, (glm::uint*)light_indexes_buffer_data, cluste_light_cap, unpacked, unpackOverflow);
+		grids = validate_test_grids.data();
+		indices = validate_test_indices.data();
+	}
+	else if (output.isCompact)
+	{
+		output.Unpack(cluste_num, validate_test_grids, validate_test_indices);
+		grids = validate_test_grids.data();
+		indices = validate_test_indices.data();
+	}
+
+	bool wasMatch = cluste_validator->IsMatch(cull_validation);
+	cluste_validator->Compare(cluste_num, aabbs, viewLights, cluste_light_cap, validate_grids.data(), validate_indices.data(),
+		grids, indices, cull_validation);
+
+	/// only print when a mismatch shows up, the title shows the rest
+	if (wasMatch && !cluste_validator->IsMatch(cull_validation))
+		cluste_validator->Print(stdout, cull_validation, validate_grids.data(), validate_indices.data(), grids, indices);
+}
+
 void VulkanRenderer::ClearLightBufferData()
 {
-	memset(light_grids_buffer_data, 0, sizeof(LightGrid) * CLUSTE_NUM);
-	memset(light_indexes_buffer_data, 0, sizeof(glm::uint) * MAX_LIGHT_NUM * CLUSTE_NUM);
+	/// every frame in flight may still read its slot
+	WaitIdle();
+	/// only the bytes the last cpu cull format covers
+	ClusteLightList output = GetCpuLightList(cull_light_format == LightFormat_Compact);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		memset(light_grids_slot_data[i], 0, output.GetGridSize() * cluste_num);
+		memset(light_indexes_slot_data[i], 0, output.GetIndexSize() * light_index_capacity);
+	}
+	std::fill(cull_counts.begin(), cull_counts.end(), 0);
+	cluste_culler->MarkAllDirty();
+}
+
+void VulkanRenderer::GatherCullStats(ViewSpaceLights& viewLights, ClusteLightList& output, bool isIncremental)
+{
+	if (isBitmaskCull)
+	{
+		ClusteCuller::GatherBitmaskStats(cluste_num, light_mask_words, (glm::uint*)light_indexes_buffer_data, cluste_light_cap, cull_stats);
+		cull_stats.uploadBytes = cull_stats.indexCount * sizeof(glm::uint);
+	}
+	else
+	{
+		ClusteCuller::GatherStats(cull_counts, cluste_light_cap, cull_stats);
+		glm::uint clustes = cluste_num;
+		glm::uint indices = cull_stats.indexCount;
+		if (isIncremental)
+			cluste_culler->GetIncrementalWrites(clustes, indices);
+		cull_stats.uploadBytes = (glm::uint)(clustes * output.GetGridSize() + indices * output.GetIndexSize());
+	}
+	cull_stats.lightCount = (glm::uint)light_infos.size();
+	cull_stats.activeLights = (glm::uint)viewLights.count;
+}
+
+void VulkanRenderer::RecordCullStats()
+{
+	if (!isCullStats || !isClusteShading)
+		return;
+
+	cull_stats_history[cull_stats_head] = cull_stats;
+	cull_stats_head = (cull_stats_head + 1) % CULL_STATS_HISTORY;
+	cull_stats_count = std::min(cull_stats_count + 1, CULL_STATS_HISTORY);
+
+	if (cull_stats_log != NULL)
+	{
+		/// cull_mode: -1 gpu, 0 raw, 1 multi-thread, 2 light-centric, 3 simd, 4 ispc
+		static const char* modeNames[] = { "gpu", "raw", "mt", "lightcentric", "simd", "ispc" };
+		static const char* formatNames[] = { "list", "compact", "bitmask" };
+		const char* format = isCpuClusteCull ? formatNames[cull_light_format] : formatNames[LightFormat_List];
+		fprintf(cull_stats_log, "%u,%s,%s,%u,%u,%u,%.3f,%u,%u,%u,%u,%u,%.4f\n", cull_stats_frame, modeNames[cull_mode + 1], format,
+			cull_stats.lightCount, cull_stats.activeLights, cull_stats.clustes, cull_stats.avgClusteLights, cull_stats.p95ClusteLights,
+			cull_stats.maxClusteLights, cull_stats.cappedClustes, cull_stats.indexCount, cull_stats.uploadBytes, isCpuClusteCull ? cpuCullTime : GetGpuCullTime());
+	}
+	cull_stats_frame++;
+}
+
+ClusteCullStats& VulkanRenderer::GetCullStatsHistory(int age)
+{
+	return cull_stats_history[(cull_stats_head - 1 - age + 2 * CULL_STATS_HISTORY) % CULL_STATS_HISTORY];
+}
+
+bool VulkanRenderer::SetCullStatsLog(const char* path)
+{
+	if (cull_stats_log != NULL)
+	{
+		fclose(cull_stats_log);
+		cull_stats_log = NULL;
+	}
+	if (path == NULL)
+		return true;
+
+	cull_stats_log = fopen(path, "w");
+	if (cull_stats_log == NULL)
+		return false;
+	fprintf(cull_stats_log, "frame,mode,format,lights,active_lights,clustes,avg_lights,p95_lights,max_lights,capped_clustes,index_count,upload_bytes,cull_ms\n");
+	return true;
+}
+
+void VulkanRenderer::SetLightListSlot(uint32_t slot)
+{
+	light_grids_buffer_data = light_grids_slot_data[slot];
+	light_indexes_buffer_data = light_indexes_slot_data[slot];
+}
+
+void VulkanRenderer::UpdateCullDirty(ScreenToView& screenToView, int cullMode)
+{
+	/// view, projection, screen size and grid are all in screenToView
+	int lightFormat = isBitmaskCull ? LightFormat_Bitmask : isCompactLightList ? LightFormat_Compact : LightFormat_List;
+	if (cullMode != cull_mode || cluste_light_cap != cull_light_cap || lightFormat != cull_light_format || memcmp(&screenToView, &cull_screen_to_view, sizeof(ScreenToView)) != 0)
+		cluste_culler->MarkAllDirty();
+	cull_screen_to_view = screenToView;
+	cull_light_cap = cluste_light_cap;
+	cull_mode = cullMode;
+	cull_light_format = lightFormat;
+}
+
+void VulkanRenderer::StartCpuCull()
+{
+	/// update input data, taken here since the camera and the readback flag change while the frame is recorded
+	ScreenToView screenToView;
+	SetScreenToViewData(&screenToView);
+	screenToView.screenDimensions = glm::uvec2(winWidth, winHeight);
+	screenToView.tileSizes = glm::uvec4(group_num, tile_size_x);
+	glm::mat4x4 viewProject = *camera->GetViewProjectMatrix();
+	unsigned int projectVersion = camera->GetProjectVersion();
+	/// the copy recorded by the last frame of this slot, Flush waited for its fence
+	const float* depth = is_depth_readback_ready[frame_slot] ? (const float*)depth_readback_buffer_data[frame_slot] : NULL;
+
+	/// masks sized by the lights in use, not the light capacity, so the shader reads no empty words,
+	/// RenderBegin writes it to the transform data
+	if (isBitmaskCull)
+		light_mask_words = ClusteCuller::GetMaskWords((int)light_infos.size());
+
+	if (isAsyncCull)
+		cull_job->Start([this, screenToView, viewProject, projectVersion, depth]() { CpuClusteCull(screenToView, viewProject, projectVersion, depth); });
+	else
+		CpuClusteCull(screenToView, viewProject, projectVersion, depth);
+}
+
+void VulkanRenderer::WaitCpuCull()
+{
+	cull_job->Wait();
+}
+
+void VulkanRenderer::CpuClusteCull(ScreenToView screenToView, glm::mat4x4 viewProject, unsigned int projectVersion, const float* depth)
+{
+	if (isDepthBoundsCull && depth != NULL)
+		cluste_culler->UpdateTileDepths(depth, swap_chain_extent.width, swap_chain_extent.height, tile_size_x, screenToView);
+	else
+		cluste_culler->ClearTileDepths();
+	if (isActiveCull && depth != NULL)
+		cluste_culler->UpdateActiveClustes(depth, swap_chain_extent.width, swap_chain_extent.height, tile_size_x, screenToView);
+	else
+		cluste_culler->ClearActiveClustes();
+
+	/// 0 raw, 1 multi-thread, 2 light-centric, 3 simd, 4 ispc
+	int cullMode = isIspc ? 4 : isSimdCull ? 3 : isLightCentricCull ? 2 : isMultiThreadCull ? 1 : 0;
+	UpdateCullDirty(screenToView, cullMode);
+	bool isChanged = cluste_culler->IsDirty();
+	if (isIncrementalCull && !isChanged && light_list_serials[frame_slot] == cull_serial)
+	{
+		/// nothing changed and this frame slot already holds the last cull
+		cpuCullTime = 0.0;
+		recull_cluste_count = 0;
+		cull_stats.uploadBytes = 0;
+		return;
+	}
+
+	/// Utils::GetMSStart keeps one global start, this may run on the cull thread
+	std::chrono::high_resolution_clock::time_point cullStart = std::chrono::high_resolution_clock::now();
+	VolumeTileAABB* aabbs = cluste_culler->UpdateAABBs(group_num.x, group_num.y, group_num.z, screenToView, projectVersion);
+	ViewSpaceLights* viewLights = cluste_culler->UpdateViewLights(screenToView, light_infos.data(), light_infos.size(), &viewProject, light_shapes.data());
+	ClusteLightList output = GetCpuLightList(isCompactLightList);
+	bool isIncremental = isIncrementalCull && !isBitmaskCull && (cullMode == 1 || cullMode == 3);
+	if (isBitmaskCull)
+	{
+		cluste_culler->CullBitmask(group_num.x, group_num.y, group_num.z, aabbs, *viewLights, isSimdCull ? cluste_culler->GetSimdLevel() : ClusteSimd::None, light_mask_words, (glm::uint*)light_indexes_buffer_data);
+		cluste_overflow.clustes = 0;
+		cluste_overflow.lights = 0;
+	}
+	else if (isIncremental)
+	{
+		/// same result as the full multi-thread or simd cull, only the clusters touched by changed lights are tested
+		/// a slot that missed the last frames also gets the clusters they changed
+		recull_cluste_count = cluste_culler->CullIncremental(group_num.x, group_num.y, group_num.z, aabbs, *viewLights, isSimdCull ? cluste_culler->GetSimdLevel() : ClusteSimd::None, cluste_light_cap, output, cluste_overflow, (int)frame_slot);
+	}
+	else if (!isIspc && isSimdCull)
+	{
+		/// calculation with simd intrinsics on all cores
+		cluste_culler->CullSimd(group_num.x, group_num.y, group_num.z, aabbs, *viewLights, cluste_light_cap, output, cluste_overflow);
+	}
+	else if (!isIspc && isLightCentricCull)
+	{
+		/// calculation with raw cpu, every light only visits the clusters it may touch
+		cluste_culler->CullLightCentric(group_num.x, group_num.y, group_num.z, *viewLights, cluste_light_cap, output, cluste_overflow);
+	}
+	else if (!isIspc && isMultiThreadCull)
+	{
+		/// calculation with raw cpu on all cores
+		cluste_culler->Cull(group_num.x, group_num.y, group_num.z, aabbs, *viewLights, cluste_light_cap, output, cluste_overflow);
+	}
+	else if (!isIspc)
+	{
+		/// calculation with raw cpu for debug and compare
+		RawCpu::cluste_culling(group_num.x, group_num.y, group_num.z, aabbs, *viewLights, cluste_light_cap, output, cluste_overflow, cluste_culler->GetActiveFlags());
+	}
+	else
+	{
+		/// calculation with ispc
+		ispc_grids.resize(cluste_num);
+		ispc_indices.resize(light_index_capacity);
+		ispc::cluste_culling_ispc(group_num.x, group_num.y, group_num.z, (ispc::VolumeTileAABB*)aabbs, viewLights->pos_x.data(), viewLights->pos_y.data(), viewLights->pos_z.data(), viewLights->radius_sq.data(), viewLights->indices.data(), viewLights->count, cluste_light_cap, (ispc::LightGrid*)ispc_grids.data(), ispc_indices.data(), (ispc::ClusteOverflow*)&cluste_overflow, (uint8_t*)cluste_culler->GetActiveFlags());
+		/// the ispc kernel only knows spheres
+		cluste_culler->RefineShapes(cluste_num, aabbs, *viewLights, ispc_grids.data(), ispc_indices.data(), output);
+	}
+	if (!isIncremental)
+	{
+		recull_cluste_count = cluste_num;
+		cluste_culler->ClearDirty();
+	}
+	if (isChanged)
+		cull_serial++;
+	light_list_serials[frame_slot] = cull_serial;
+	cpuCullTime = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - cullStart).count() / 1000.0;
+
+	/// reads the output back, not part of the cull time either
+	if (isCullStats)
+		GatherCullStats(*viewLights, output, isIncremental);
+
+	/// compare with raw cpu culling on the same input, not part of the cull time
+	if (isValidateCull)
+		ValidateCpuCull(aabbs, *viewLights, output);
 }
 
 void VulkanRenderer::RenderBegin()
@@ -2308,48 +2973,73 @@ void VulkanRenderer::RenderBegin()
 	isClusteShading = isClusteShadingState;
 	isCpuClusteCull = isCpuClusteCullState;
 	isIspc = isIspcState;
+	isMultiThreadCull = isMultiThreadCullState;
+	isLightCentricCull = isLightCentricCullState;
+	isSimdCull = isSimdCullState;
+	isIncrementalCull = isIncrementalCullState;
+	isAsyncCull = isAsyncCullState;
+	isCullStats = isCullStatsState;
+	if (isDepthBoundsCull != isDepthBoundsCullState)
+	{
+		isDepthBoundsCull = isDepthBoundsCullState;
+		memset(is_depth_readback_ready, 0, sizeof(is_depth_readback_ready));
+	}
+	if (isActiveCull != isActiveCullState)
+	{
+		isActiveCull = isActiveCullState;
+		memset(is_depth_readback_ready, 0, sizeof(is_depth_readback_ready));
+		if (IsActiveCullIgnored())
+			printf("active cluste culling only applies to the cpu culls, the gpu cull tests every cluste\n");
+	}
+	if (isValidateCullState && !isValidateCull)
+	{
+		memset(&cull_validation, 0, sizeof(ClusteValidation));
+		cull_validation.firstMismatch = -1;
+		cluste_culler->MarkAllDirty();	/// a skipped frame would not be validated
+	}
+	isValidateCull = isValidateCullState;
+	if (cluste_light_cap != cluste_light_cap_state)
+	{
+		cluste_light_cap = cluste_light_cap_state;
+		ReserveLightBuffers(light_infos.size());
+		if (cluste_light_cap > GPU_CLUSTE_LIGHT_CAP)
+			printf("cluste light cap %u is above the gpu cull limit, the gpu cull keeps %u lights per cluste\n", cluste_light_cap, (glm::uint)GPU_CLUSTE_LIGHT_CAP);
+	}
+	UpdateGridTuner();
+	if (tile_size_state != tile_size_x || z_slices_state != group_num.z)
+	{
+		ResizeClusteGrid(tile_size_state, z_slices_state);
+	}
+
+	/// checked every frame, the light count, grid or cap may have outgrown the packed widths
+	isBitmaskCull = isBitmaskCullState && isClusteShading && isCpuClusteCull && !isIspc;
+	isCompactLightList = isCompactLightListState && !isBitmaskCull && isClusteShading && isCpuClusteCull && !isIspc && IsCompactLightListSupported();
 
-	/// branch ispc/gpu cluste_shading
+	/// branch ispc/gpu cluste_shading, everything of this slot is free since Flush waited for its fence
+	SetLightListSlot(frame_slot);
+	UploadLightData(frame_slot);
 	if (isClusteShading)
 	{
 		if (isCpuClusteCull)
 		{
-			/// update input data
-			ScreenToView screenToView;
-			SetScreenToViewData(&screenToView);
-			screenToView.screenDimensions = glm::uvec2(winWidth, winHeight);
-			screenToView.tileSizes = glm::uvec4(group_num, tile_size_x);
-
-			PointLightData* lightDatas = light_infos.data();
-			Utils::GetMSStart();
-			if (!isIspc)
-			{
-				/// calculation with raw cpu for debug and compare
-				RawCpu::cluste_culling(CLUSTE_X, CLUSTE_Y, CLUSTE_Z, screenToView, light_infos.data(), light_infos.size(), (LightGrid*)light_grids_buffer_data, (uint32_t*)light_indexes_buffer_data);
-			}
-			else
-			{
-				/// calculation with ispc
-				ispc::ScreenToViewISPC screenToViewIspc;
-				memcpy(&screenToViewIspc.inverseProjection, &screenToView.inverseProjection, sizeof(glm::mat4));
-				///screenToView.viewMatrix = glm::transpose(screenToView.viewMatrix);
-				memcpy(&screenToViewIspc.viewMatrix, &screenToView.viewMatrix, sizeof(glm::mat4));
-				memcpy(&screenToViewIspc.tileSizes, &screenToView.tileSizes, sizeof(glm::uvec4));
-				memcpy(&screenToViewIspc.screenDimensions, &screenToView.screenDimensions, sizeof(glm::uvec2));
-				screenToViewIspc.zFar = screenToView.zFar;
-				screenToViewIspc.zNear = screenToView.zNear;
-				ispc::cluste_culling_ispc(CLUSTE_X, CLUSTE_Y, CLUSTE_Z, screenToViewIspc, pointLightISPCDatas, light_infos.size(), (LightGrid*)light_grids_buffer_data, (uint32_t*)light_indexes_buffer_data);
-			}
-			cpuCullTime = Utils::GetMSEnd();
+			/// the cull writes the light lists of this slot and overlaps the end of the last frame
+			StartCpuCull();
 		}
 		else
 		{
-			SetScreenToViewData((ScreenToView*)screen_to_view_buffer_data);
-			UpdateComputeDescriptorSet();
+			/// the gpu cull writes the light lists of this slot, the last frame reads the other slot
+			SetScreenToViewData((ScreenToView*)screen_to_view_buffer_data[frame_slot]);
+			DispatchComputeCull(camera->GetProjectVersion());
 			cpuCullTime = 0.0;
+			cull_mode = -1;
 		}
 	}
 
+	TransformData* transData = &transform_data;
+	transData->lightListFormat = isBitmaskCull ? LightFormat_Bitmask : isCompactLightList ? LightFormat_Compact : LightFormat_List;
+	if (isBitmaskCull)
+		transData->lightMaskWords = light_mask_words;
+
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -2369,9 +3059,9 @@ void VulkanRenderer::RenderBegin()
 				VK_ACCESS_SHADER_READ_BIT,
 				indices.computeFamily.value(),
 				indices.graphicsFamily.value(),
-				gpu_light_indexes_buffer_info.buffer,
+				gpu_light_indexes_buffer_info[frame_slot].buffer,
 				0,
-				gpu_light_indexes_buffer_info.range,
+				gpu_light_indexes_buffer_info[frame_slot].range,
 			},
 			{
 				VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -2380,9 +3070,9 @@ void VulkanRenderer::RenderBegin()
 				VK_ACCESS_SHADER_READ_BIT,
 				indices.computeFamily.value(),
 				indices.graphicsFamily.value(),
-				gpu_light_grids_buffer_info.buffer,
+				gpu_light_grids_buffer_info[frame_slot].buffer,
 				0,
-				gpu_light_grids_buffer_info.range,
+				gpu_light_grids_buffer_info[frame_slot].range,
 			},
 		};
 
@@ -2421,10 +3111,61 @@ void VulkanRenderer::RenderBegin()
 		vkCmdBindPipeline(command_buffers[active_command_buffer_idx], VK_PIPELINE_BIND_POINT_GRAPHICS, mesh_pipeline);
 }
 
+void VulkanRenderer::RecordDepthReadback(VkCommandBuffer commandBuffer)
+{
+	/// the next render pass starts from an undefined layout, no transition back needed
+	VkFormat depthFormat = FindDepthFormat();
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = depth_image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (HasStencilComponent(depthFormat))
+		barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { swap_chain_extent.width, swap_chain_extent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, depth_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, depth_readback_buffer[frame_slot], 1, &region);
+
+	VkBufferMemoryBarrier bufferBarrier = {};
+	bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = depth_readback_buffer[frame_slot];
+	bufferBarrier.offset = 0;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+	is_depth_readback_ready[frame_slot] = true;
+}
+
 void VulkanRenderer::RenderEnd()
 {
 	vkCmdEndRenderPass(command_buffers[active_command_buffer_idx]);
 
+	if (isClusteShading && isCpuClusteCull && (isDepthBoundsCull || isActiveCull) && is_depth_readback_supported)
+		RecordDepthReadback(command_buffers[active_command_buffer_idx]);
+
 	if (vkEndCommandBuffer(command_buffers[active_command_buffer_idx]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to record command buffer!");
 	}
@@ -2434,47 +3175,50 @@ void VulkanRenderer::RenderEnd()
 
 void VulkanRenderer::Flush()
 {
-	if (last_command_buffer_idx != UINT_MAX)
-	{
-		vkWaitForFences(device, 1, &in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-		vkResetFences(device, 1, &in_flight_fence);
-	
-		VkSemaphore waitSemaphores[] = { render_finished_semaphore };
-		
-		VkPresentInfoKHR presentInfo = {};
-		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = waitSemaphores;
-		VkSwapchainKHR swapChains[] = { swap_chain };
-		presentInfo.swapchainCount = 1;
-		presentInfo.pSwapchains = swapChains;
-		presentInfo.pImageIndices = &last_command_buffer_idx;
-		presentInfo.pResults = nullptr; // Optional
-		if (vkQueuePresentKHR(graphics_queue, &presentInfo) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to present frame buffer!");
-		}
+	/// the fence of this slot was submitted MAX_FRAMES_IN_FLIGHT frames ago, after it the slot's semaphores, uniform,
+	/// light datas, light lists and depth readback are free
+	vkWaitForFences(device, 1, &in_flight_fences[frame_slot], VK_TRUE, std::numeric_limits<uint64_t>::max());
 
-		if (isClusteShading && !isCpuClusteCull)
+	if (comp_dispatched[frame_slot])
+	{
+		/// the queries of the slot are reset by its next dispatch, the dispatch finished before the fenced frame, no wait
+		comp_dispatched[frame_slot] = false;
+		uint64_t timestamps[2];
+		gpuCullTime = 0;
+		VkResult result;
+		if (comp_aabb_dispatched[frame_slot])
 		{
-			uint64_t timestamps[2];
-			gpuCullTime = 0;
-			VkResult result = vkGetQueryPoolResults(device, query_pool[active_command_buffer_idx * 2], 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-			gpuCullTime += (timestamps[1] - timestamps[0]);
-			result = vkGetQueryPoolResults(device, query_pool[active_command_buffer_idx * 2 + 1], 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+			result = vkGetQueryPoolResults(device, query_pool[frame_slot * 2], 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
 			gpuCullTime += (timestamps[1] - timestamps[0]);
 		}
+		result = vkGetQueryPoolResults(device, query_pool[frame_slot * 2 + 1], 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+		gpuCullTime += (timestamps[1] - timestamps[0]);
 	}
 
-	vkAcquireNextImageKHR(device, swap_chain, std::numeric_limits<uint64_t>::max(), image_available_semaphore, VK_NULL_HANDLE, &active_command_buffer_idx);
+	vkAcquireNextImageKHR(device, swap_chain, std::numeric_limits<uint64_t>::max(), image_available_semaphores[frame_slot], VK_NULL_HANDLE, &active_command_buffer_idx);
+
+	/// command buffers and descriptor sets are per swap chain image, the image may come back while its last frame still runs
+	if (image_fences[active_command_buffer_idx] != VK_NULL_HANDLE)
+		vkWaitForFences(device, 1, &image_fences[active_command_buffer_idx], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	image_fences[active_command_buffer_idx] = in_flight_fences[frame_slot];
 
 	Application::Inst()->SceneRender();
 
-	VkSemaphore signalSemaphores[] = { render_finished_semaphore };
+	/// the cpu cull overlapped the recording, only what is left of it stalls the submit
+	std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+	WaitCpuCull();
+	cull_wait_time = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - waitStart).count() / 1000.0;
+	RecordCullStats();
+
+	/// the setters only wrote the host copy while the frame was recorded
+	memcpy(transform_uniform_buffer_data[frame_slot], &transform_data, sizeof(TransformData));
+
+	VkSemaphore signalSemaphores[] = { render_finished_semaphores[frame_slot] };
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore waitSemaphores[2] = { image_available_semaphore, compute_finished_semaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };	/// in the stage wait the sema
+	VkSemaphore waitSemaphores[2] = { image_available_semaphores[frame_slot], compute_finished_semaphore };
+	/// the fragment shader reads the gpu light lists, so the cull has to be done before any fragment shading
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };	/// in the stage wait the sema
 	if(isClusteShading && !isCpuClusteCull)
 		submitInfo.waitSemaphoreCount = 2;
 	else
@@ -2486,16 +3230,33 @@ void VulkanRenderer::Flush()
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
+	vkResetFences(device, 1, &in_flight_fences[frame_slot]);
 	VkResult ret;
-	if ((ret = vkQueueSubmit(graphics_queue, 1, &submitInfo, in_flight_fence)) != VK_SUCCESS) {
+	if ((ret = vkQueueSubmit(graphics_queue, 1, &submitInfo, in_flight_fences[frame_slot])) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
 
-	last_command_buffer_idx = active_command_buffer_idx;
+	/// presented right away, the next frame no longer waits for this one before it starts
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = signalSemaphores;
+	VkSwapchainKHR swapChains[] = { swap_chain };
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = swapChains;
+	presentInfo.pImageIndices = &active_command_buffer_idx;
+	presentInfo.pResults = nullptr; // Optional
+	if (vkQueuePresentKHR(graphics_queue, &presentInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to present frame buffer!");
+	}
+
+	frame_slot = (frame_slot + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 void VulkanRenderer::WaitIdle()
 {
+	WaitCpuCull();
 	vkDeviceWaitIdle(device);
 }
 
@@ -2581,11 +3342,8 @@ void VulkanRenderer::UpdateTransformMatrix(TransformEntity* transform)
 	glm::vec3 cam_pos_obj3 = glm::vec3(cam_pos_obj.x, cam_pos_obj.y, cam_pos_obj.z);
 	SetCamPos(cam_pos_obj3);
 
-	for (int i = 0; i < light_infos.size(); i++)
-	{
-		glm::vec4 light_pos_obj = glm::vec4(light_infos[i].pos.x, light_infos[i].pos.y, light_infos[i].pos.z, 1.0f) * world_model;
-		SetLightPos(light_pos_obj, i);
-	}
+	/// lights go to obj space in the fragment shader, there is no per light slot here
+	SetWorldModelMatrix(world_model);
 }
 
 void VulkanRenderer::OnSceneExit()
@@ -1,12 +1,20 @@
 ﻿#ifndef __VULKAN_RENDERER_H__
 #define	__VULKAN_RENDERER_H__
 
+#include <stdio.h>
 #include <vector>
 #include <set>
 #include <array>
 #include <optional>
 
 #include "Renderer.h"
+#include "ClusteSimd.h"
+
+/// frames of cull stats kept by the renderer
+#define CULL_STATS_HISTORY 256
+
+/// frames the cpu may record ahead of the gpu, each one has its own fence, semaphores and cpu written light lists
+#define MAX_FRAMES_IN_FLIGHT 2
 
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -27,6 +35,11 @@ struct QueueFamilyIndices {
 class Texture;
 class Material;
 class PointLight;
+class ThreadPool;
+class AsyncJob;
+class ClusteCuller;
+class ClusteGridTuner;
+class ClusteValidator;
 class VulkanRenderer : public Renderer
 {
 public:
@@ -44,7 +57,10 @@ public:
 	virtual void UpdateCameraMatrix();
 	virtual void UpdateTransformMatrix(TransformEntity* transform);
 
+	/// called between frames, only the host copy is written and every frame slot takes the change when it is recorded
 	virtual void AddLight(PointLight* light);
+	virtual void UpdateLight(int idx, PointLight* light);
+	virtual void RemoveLight(int idx);
 	virtual void ClearLight();
 
 	virtual int GetFrameBufferCount() { return 2; }
@@ -76,7 +92,7 @@ public:
 	void SetProjMatrix(glm::mat4x4& mtx);
 	void SetProjViewMatrix(glm::mat4x4& mtx);
 	void SetCamPos(glm::vec3& pos);
-	void SetLightPos(glm::vec4& pos, int idx);
+	void SetWorldModelMatrix(glm::mat4x4& mtx);
 	void SetTexture(Texture* tex);
 	void SetNormalTexture(Texture* tex);
 
@@ -95,7 +111,12 @@ public:
 	void CreateTextureSampler(VkSampler* sampler);
 	void DestroyTextureSampler(VkSampler* sampler);
 
-	void UpdateComputeDescriptorSet();
+	/// writes the compute descriptor set of one swap chain image
+	void UpdateComputeDescriptorSet(int idx);
+	/// records the aabb and cull command buffers of one swap chain image
+	void RecordComputeCull(int idx);
+	/// submits the recorded gpu cull of this frame, the aabb pass only after a projection change
+	void DispatchComputeCull(unsigned int projectVersion);
 
 	bool IsMeshShading() { return isMeshShader; }
 	void SetMeshShading(bool _isMeshShading) { isMeshShaderState = _isMeshShading; }
@@ -109,9 +130,92 @@ public:
 	bool IsCpuClusteCull() { return isCpuClusteCull; }
 	void SetCpuClusteCull(bool _isCpuClusteCull) { isCpuClusteCullState = _isCpuClusteCull; }
 
+	bool IsMultiThreadCull() { return isMultiThreadCull; }
+	void SetMultiThreadCull(bool _isMultiThreadCull) { isMultiThreadCullState = _isMultiThreadCull; }
+
+	bool IsLightCentricCull() { return isLightCentricCull; }
+	void SetLightCentricCull(bool _isLightCentricCull) { isLightCentricCullState = _isLightCentricCull; }
+
+	/// multi-thread culling with sse2/avx2/avx-512 sphere tests, the best level of the cpu is picked at startup
+	bool IsSimdCull() { return isSimdCull; }
+	void SetSimdCull(bool _isSimdCull) { isSimdCullState = _isSimdCull; }
+	ClusteSimd::Level GetSimdLevel();
+
+	/// cluste grid from the tile size in pixels and the z slice count, applied on the next frame
+	void SetClusteGrid(unsigned int tileSize, unsigned int zSlices) { tile_size_state = tileSize; z_slices_state = zSlices; }
+	glm::uvec4 GetClusteGrid() { return glm::uvec4(group_num, tile_size_x); }	/// x, y, z, tile size
+
+	bool IsAutoTuneGrid() { return isAutoTuneGrid; }
+	void SetAutoTuneGrid(bool _isAutoTuneGrid) { isAutoTuneGridState = _isAutoTuneGrid; }
+
+	/// diff every cpu cull against RawCpu::cluste_culling on the same input
+	bool IsValidateCull() { return isValidateCull; }
+	void SetValidateCull(bool _isValidateCull) { isValidateCullState = _isValidateCull; }
+	ClusteValidation& GetCullValidation() { return cull_validation; }
+
+	/// skip the cpu cull when view, grid, cap, back end and lights are unchanged, the multi-thread and simd paths
+	/// only re-test the clusters touched by changed lights
+	bool IsIncrementalCull() { return isIncrementalCull; }
+	void SetIncrementalCull(bool _isIncrementalCull) { isIncrementalCullState = _isIncrementalCull; }
+	int GetRecullClusteCount() { return recull_cluste_count; }	/// clusters tested by the last cpu cull frame, 0 when skipped
+
+	/// lights outside the camera frustum never reach the cpu cull, with depth bounds also the lights that only reach
+	/// clusters without geometry in the depth buffer of the frame MAX_FRAMES_IN_FLIGHT back, read without a stall
+	bool IsDepthBoundsCull() { return isDepthBoundsCull; }
+	void SetDepthBoundsCull(bool _isDepthBoundsCull) { isDepthBoundsCullState = _isDepthBoundsCull; }
+	bool IsDepthBoundsSupported() { return is_depth_readback_supported; }
+	int GetRejectedLightCount();
+
+	/// only the clusters holding a pixel of the depth buffer get lights, the others are left empty,
+	/// MAX_FRAMES_IN_FLIGHT frames late like the depth bounds
+	bool IsActiveCull() { return isActiveCull; }
+	void SetActiveCull(bool _isActiveCull) { isActiveCullState = _isActiveCull; }
+	/// the gpu cull has no depth readback and tests every cluste
+	bool IsActiveCullIgnored() { return isActiveCull && isClusteShading && !isCpuClusteCull; }
+	const std::vector<int>& GetActiveClustes();	/// ascending, empty when active cull is off
+
+	/// cpu culls write 16-bit light indices and offset/count packed in one word, half the bytes written and read by
+	/// the fragment shader. only used when the lights, index list and cap fit the packed widths,
+	/// the gpu and ispc culls always write 32-bit
+	bool IsCompactLightList() { return isCompactLightList; }
+	void SetCompactLightList(bool _isCompactLightList) { isCompactLightListState = _isCompactLightList; }
+	bool IsCompactLightListSupported();
+
+	/// cpu culls write a bit per light slot for every cluste instead of offset/count lists, no light cap and no
+	/// serial prefix sum, the shader walks the set bits. the ispc and gpu culls always write lists
+	bool IsBitmaskCull() { return isBitmaskCull; }
+	void SetBitmaskCull(bool _isBitmaskCull) { isBitmaskCullState = _isBitmaskCull; }
+	glm::uint GetLightMaskWords() { return light_mask_words; }	/// words per cluste of the last bitmask cull
+
+	/// the cpu cull runs on a background thread while the frame is recorded and is joined right before the submit,
+	/// lights must not change between RenderBegin and RenderEnd
+	bool IsAsyncCull() { return isAsyncCull; }
+	void SetAsyncCull(bool _isAsyncCull) { isAsyncCullState = _isAsyncCull; }
+	double GetCullWaitTime() { return cull_wait_time; }	/// ms the submit waited for the cull, 0 when it was done
+	void WaitCpuCull();
+
+	/// max visible lights written per cluste, applied on the next frame
+	glm::uint GetClusteLightCap() { return cluste_light_cap; }
+	void SetClusteLightCap(glm::uint cap) { cluste_light_cap_state = cap; }
+	/// the gpu cull keeps at most GPU_CLUSTE_LIGHT_CAP lights per cluste, the cpu culls the whole cap
+	glm::uint GetGpuClusteLightCap() { return std::min(cluste_light_cap, (glm::uint)GPU_CLUSTE_LIGHT_CAP); }
+	bool IsGpuLightCapClamped() { return isClusteShading && !isCpuClusteCull && cluste_light_cap > GPU_CLUSTE_LIGHT_CAP; }
+	ClusteOverflow& GetClusteOverflow() { return cluste_overflow; }
+
 	double GetCpuCullTime() { return cpuCullTime; }
 	double GetGpuCullTime() { return (double)gpuCullTime / timestampFrequency; }
 
+	/// lights per cluste, capped clusters, index list length and upload bytes of every culled frame. the cpu culls read
+	/// their output back for it, the gpu cull only has the index count and overflow of its last dispatch
+	bool IsCullStats() { return isCullStats; }
+	void SetCullStats(bool _isCullStats) { isCullStatsState = _isCullStats; }
+	ClusteCullStats& GetCullStats() { return cull_stats; }
+	int GetCullStatsHistoryCount() { return cull_stats_count; }
+	ClusteCullStats& GetCullStatsHistory(int age);	/// 0 is the last frame, up to CULL_STATS_HISTORY - 1
+	/// appends one csv line per frame while cull stats are on, NULL closes the file
+	bool SetCullStatsLog(const char* path);
+	bool IsCullStatsLog() { return cull_stats_log != NULL; }
+
 	uint32_t GetMaxDrawMeshTaskCount();
 	bool IsMeshShadingSupported() { return is_mesh_shading_supported; }
 
@@ -121,6 +225,8 @@ private:
 
 	void CreateInstance();
 	bool CheckValidationLayerSupport();
+	/// prints the validation layer warnings and errors, debug builds only
+	void CreateDebugMessenger();
 
 	void CreateSurface();
 
@@ -142,6 +248,8 @@ private:
 	void CreateRenderPass();
 
 	void CreateGraphicsPipeline();
+	/// reads a spir-v, throws when it was built for another SHADER_INTERFACE_VERSION
+	std::vector<char> ReadShader(const std::string& path);
 	VkShaderModule createShaderModule(const std::vector<char>& code);
 
 	void InitializeClusteRendering();
@@ -177,6 +285,34 @@ private:
 	void CreateCompDescriptorSets();
 	void ReleaseCompDescriptorSets();
 
+	/// light datas and light indexes are sized from the light count, grow them before they overflow
+	void ReserveLightBuffers(int lightCount);
+	void CreateLightBuffers();
+	/// the lights in [begin, end) changed on the host, every slot takes them the next time it is recorded
+	void MarkLightDataDirty(int begin, int end);
+	/// copies the changed lights into the light datas of a slot, its last frame must be done
+	void UploadLightData(uint32_t slot);
+	void ReleaseLightBuffers();
+	glm::uint LightIndexCapacity(int lightCapacity);
+
+	/// tile aabbs and light grids are sized from the cluste grid
+	void CreateGridBuffers();
+	void ReleaseGridBuffers();
+	void ResizeClusteGrid(unsigned int tileSize, unsigned int zSlices);
+	void UpdateGridTuner();
+	void ValidateCpuCull(VolumeTileAABB* aabbs, ViewSpaceLights& viewLights, ClusteLightList& output);
+	ClusteLightList GetCpuLightList(bool isCompact);
+	/// marks the whole grid dirty when anything but the lights changed since the last cpu cull
+	void UpdateCullDirty(ScreenToView& screenToView, int cullMode);
+	void StartCpuCull();
+	/// reads only the snapshot taken by StartCpuCull, not the camera or the depth readback state, depth is NULL when not ready
+	void CpuClusteCull(ScreenToView screenToView, glm::mat4x4 viewProject, unsigned int projectVersion, const float* depth);
+	void RecordDepthReadback(VkCommandBuffer commandBuffer);
+	void GatherCullStats(ViewSpaceLights& viewLights, ClusteLightList& output, bool isIncremental);
+	void RecordCullStats();
+	/// points the cpu cull and the descriptor sets at the light lists of a frame slot
+	void SetLightListSlot(uint32_t slot);
+
 	void CreateSemaphores();
 
 	void SetScreenToViewData(ScreenToView* stv);
@@ -185,6 +321,7 @@ private:
 
 private:
 	VkInstance instance;
+	VkDebugUtilsMessengerEXT debug_messenger;	/// VK_NULL_HANDLE without validation layers
 	VkPhysicalDevice physical_device;
 	uint32_t max_draw_mesh_tasks_count;
 	bool is_mesh_shading_supported;
@@ -211,46 +348,60 @@ private:
 	std::vector<VkFramebuffer> swap_chain_framebuffers;
 	VkCommandPool command_pool;
 	std::vector<VkCommandBuffer> command_buffers;
-	VkSemaphore image_available_semaphore;
-	VkSemaphore render_finished_semaphore;
+	VkSemaphore image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
+	VkSemaphore render_finished_semaphores[MAX_FRAMES_IN_FLIGHT];
 	VkSemaphore compute_finished_semaphore;
-	VkFence in_flight_fence;
+	VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
+	std::vector<VkFence> image_fences;	/// fence of the last frame drawn to each swap chain image, guards its command buffer and descriptor sets
+	uint32_t frame_slot;	/// frame in flight being recorded
 	VkImage depth_image;
 	VkDeviceMemory depth_image_memory;
 	VkImageView depth_image_view;
 
+	/// depth copied at the end of every frame for the cpu cull, only with a 32-bit float depth format,
+	/// a slot holds the depth of the last frame recorded in it and is read once its fence is waited
+	bool is_depth_readback_supported;
+	bool is_depth_readback_ready[MAX_FRAMES_IN_FLIGHT];
+	VkBuffer depth_readback_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory depth_readback_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* depth_readback_buffer_data[MAX_FRAMES_IN_FLIGHT];
+
 	uint32_t active_command_buffer_idx;
-	uint32_t last_command_buffer_idx;
 
 	VkDescriptorImageInfo* image_info;
 	VkDescriptorImageInfo* normal_image_info;
 
-	/// uniform buffers
-	VkBuffer transform_uniform_buffer;
-	VkDeviceMemory transform_uniform_buffer_memory;
-	VkDescriptorBufferInfo transform_uniform_buffer_info;
-	void* transform_uniform_buffer_data;
-
-	std::vector<VkBuffer> light_uniform_buffers;
-	std::vector<VkDeviceMemory> light_uniform_buffer_memorys;
-	std::vector<VkDescriptorBufferInfo> light_uniform_buffer_infos;
-	std::vector<void*> light_uniform_buffer_datas;
+	/// uniform buffers, one per frame in flight, Flush copies transform_data into the one of the submitted slot
+	TransformData transform_data;
+	VkBuffer transform_uniform_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory transform_uniform_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo transform_uniform_buffer_info[MAX_FRAMES_IN_FLIGHT];
+	void* transform_uniform_buffer_data[MAX_FRAMES_IN_FLIGHT];
 
 	/// cluste calculate
 	unsigned int tile_size_x;	/// ss width height
 	glm::uvec3 group_num;
+	unsigned int cluste_num;
+	unsigned int tile_size_state;
+	unsigned int z_slices_state;
+	ClusteGridTuner* grid_tuner;
+	double last_frame_time;
 	VkDescriptorPool comp_desc_pool;
 	VkDescriptorSetLayout comp_desc_layout;
 	VkPipelineLayout comp_pipeline_layout;
 	VkPipeline comp_pipelines[2];
-	VkDescriptorSet comp_desc_set[3];
-	VkCommandBuffer comp_command_buffers[2*3];
+	VkDescriptorSet comp_desc_set[MAX_FRAMES_IN_FLIGHT];	/// by frame slot, they point at its screen to view, light datas, light lists and counters
+	VkCommandBuffer comp_command_buffers[2 * MAX_FRAMES_IN_FLIGHT];	/// aabb pass and cull pass of every frame slot
 	VkQueue comp_queue;
 	VkCommandPool comp_command_pool;
-	VkFence comp_wait_fence;
+	unsigned int comp_buffer_serial;	/// bumped whenever a buffer of the compute descriptor sets is recreated
+	unsigned int comp_record_serials[MAX_FRAMES_IN_FLIGHT];	/// comp_buffer_serial each frame slot was recorded with
+	unsigned int comp_aabb_project_version;	/// projection the gpu tile aabbs were built for, UINT_MAX to rebuild them
+	bool comp_dispatched[MAX_FRAMES_IN_FLIGHT];	/// the frame slot ran the gpu cull, its timestamps are read after its fence
+	bool comp_aabb_dispatched[MAX_FRAMES_IN_FLIGHT];	/// the gpu cull of the frame slot also ran the aabb pass
 	VkShaderModule comp_cluste_shader_module;
 	VkShaderModule cluste_cull_shader_module;
-	VkQueryPool query_pool[2*3];
+	VkQueryPool query_pool[2 * MAX_FRAMES_IN_FLIGHT];
 
 	/// tile aabb
 	VkBuffer tile_aabbs_buffer;
@@ -258,41 +409,88 @@ private:
 	void* tile_aabbs_buffer_data;
 	VkDescriptorBufferInfo tile_aabbs_buffer_info;
 
-	/// screen to view
-	VkBuffer screen_to_view_buffer;
-	VkDeviceMemory screen_to_view_buffer_memory;
-	void* screen_to_view_buffer_data;
-	VkDescriptorBufferInfo screen_to_view_buffer_info;
-
-	/// light datas
-	VkBuffer light_datas_buffer;
-	VkDeviceMemory light_datas_buffer_memory;
-	void* light_datas_buffer_data;
-	VkDescriptorBufferInfo light_datas_buffer_info;
-
-	/// light indexes
-	VkBuffer local_light_indexes_buffer;
-	VkDeviceMemory local_light_indexes_buffer_memory;
-	VkBuffer gpu_light_indexes_buffer;
-	VkDeviceMemory gpu_light_indexes_buffer_memory;
-	void* light_indexes_buffer_data;
-	VkDescriptorBufferInfo local_light_indexes_buffer_info;
-	VkDescriptorBufferInfo gpu_light_indexes_buffer_info;
-
-	/// light grids
-	VkBuffer local_light_grids_buffer;
-	VkDeviceMemory local_light_grids_buffer_memory;
-	VkBuffer gpu_light_grids_buffer;
-	VkDeviceMemory gpu_light_grids_buffer_memory;
-	void* light_grids_buffer_data;
-	VkDescriptorBufferInfo local_light_grids_buffer_info;
-	VkDescriptorBufferInfo gpu_light_grids_buffer_info;
-
-	/// index count
-	VkBuffer index_count_buffer;
-	VkDeviceMemory index_count_buffer_memory;
-	void* index_count_buffer_data;
-	VkDescriptorBufferInfo index_count_buffer_info;
+	/// screen to view of the gpu cull, one per frame in flight
+	VkBuffer screen_to_view_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory screen_to_view_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* screen_to_view_buffer_data[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo screen_to_view_buffer_info[MAX_FRAMES_IN_FLIGHT];
+
+	/// light buffer capacity
+	int light_capacity;	/// lights in light datas
+	glm::uint light_index_capacity;	/// entries in light indexes
+	glm::uint cluste_light_cap;
+	glm::uint cluste_light_cap_state;
+	ClusteOverflow cluste_overflow;
+
+	/// light datas, one per frame in flight, filled from light_infos when the slot is recorded
+	VkBuffer light_datas_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory light_datas_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* light_datas_buffer_data[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo light_datas_buffer_info[MAX_FRAMES_IN_FLIGHT];
+	glm::ivec2 light_data_dirty[MAX_FRAMES_IN_FLIGHT];	/// lights [x, y) a slot has not taken yet, empty when x >= y
+
+	/// light shapes, same slots as light datas
+	VkBuffer light_shapes_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory light_shapes_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* light_shapes_buffer_data[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo light_shapes_buffer_info[MAX_FRAMES_IN_FLIGHT];
+
+	/// light indexes, once per frame in flight
+	VkBuffer local_light_indexes_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory local_light_indexes_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	VkBuffer gpu_light_indexes_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory gpu_light_indexes_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* light_indexes_slot_data[MAX_FRAMES_IN_FLIGHT];
+	void* light_indexes_buffer_data;	/// slot of the frame being recorded
+	VkDescriptorBufferInfo local_light_indexes_buffer_info[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo gpu_light_indexes_buffer_info[MAX_FRAMES_IN_FLIGHT];
+
+	/// light grids, once per frame in flight
+	VkBuffer local_light_grids_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory local_light_grids_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	VkBuffer gpu_light_grids_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory gpu_light_grids_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* light_grids_slot_data[MAX_FRAMES_IN_FLIGHT];
+	void* light_grids_buffer_data;	/// slot of the frame being recorded
+	VkDescriptorBufferInfo local_light_grids_buffer_info[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo gpu_light_grids_buffer_info[MAX_FRAMES_IN_FLIGHT];
+	unsigned int light_list_serials[MAX_FRAMES_IN_FLIGHT];	/// cull_serial of the light lists in each slot, 0 stale
+	unsigned int cull_serial;	/// bumped by every cpu cull with changed input
+
+	/// index count, cap and overflow of the gpu cull, once per frame in flight
+	VkBuffer index_count_buffer[MAX_FRAMES_IN_FLIGHT];
+	VkDeviceMemory index_count_buffer_memory[MAX_FRAMES_IN_FLIGHT];
+	void* index_count_buffer_data[MAX_FRAMES_IN_FLIGHT];
+	VkDescriptorBufferInfo index_count_buffer_info[MAX_FRAMES_IN_FLIGHT];
+
+	/// cpu cluste culling
+	ThreadPool* thread_pool;
+	AsyncJob* cull_job;
+	ClusteCuller* cluste_culler;
+	ClusteValidator* cluste_validator;
+	ClusteValidation cull_validation;
+	std::vector<LightGrid> validate_grids;	/// reference output
+	std::vector<glm::uint> validate_indices;
+	std::vector<LightGrid> validate_test_grids;	/// 32-bit copy of a compact output
+	std::vector<glm::uint> validate_test_indices;
+	std::vector<glm::uint> cull_counts;	/// light count of every cluste the cpu culls wrote, the mapped grids are slow to read
+	std::vector<LightGrid> ispc_grids;	/// sphere only lists of the ispc cull before RefineShapes
+	std::vector<glm::uint> ispc_indices;
+
+	/// input of the last cpu cull
+	ScreenToView cull_screen_to_view;
+	glm::uint cull_light_cap;
+	int cull_mode;	/// -1 when the light grid was not written by a cpu cull
+	int cull_light_format;	/// ClusteLightFormat of the light grid in the local buffers
+	glm::uint light_mask_words;
+	int recull_cluste_count;
+
+	ClusteCullStats cull_stats;
+	ClusteCullStats cull_stats_history[CULL_STATS_HISTORY];
+	int cull_stats_head;	/// next entry to write
+	int cull_stats_count;
+	FILE* cull_stats_log;
+	unsigned int cull_stats_frame;
 
 	bool isClusteShading;
 	bool isClusteShadingState;
@@ -300,12 +498,37 @@ private:
 	bool isIspcState;
 	bool isCpuClusteCull;
 	bool isCpuClusteCullState;
+	bool isMultiThreadCull;
+	bool isMultiThreadCullState;
+	bool isLightCentricCull;
+	bool isLightCentricCullState;
+	bool isSimdCull;
+	bool isSimdCullState;
+	bool isAutoTuneGrid;
+	bool isAutoTuneGridState;
+	bool isValidateCull;
+	bool isValidateCullState;
+	bool isIncrementalCull;
+	bool isIncrementalCullState;
+	bool isDepthBoundsCull;
+	bool isDepthBoundsCullState;
+	bool isActiveCull;
+	bool isActiveCullState;
+	bool isCompactLightList;
+	bool isCompactLightListState;
+	bool isBitmaskCull;
+	bool isBitmaskCullState;
+	bool isAsyncCull;
+	bool isAsyncCullState;
+	bool isCullStats;
+	bool isCullStatsState;
 	bool isMeshShader;
 	bool isMeshShaderState;
 
 	bool isTaskShaderInit;
 
 	double cpuCullTime;
+	double cull_wait_time;
 	uint64_t gpuCullTime;
 	bool compSupportTimeStamp;
 	float timestampPeriod;
@@ -0,0 +1,87 @@
+#include "VertexHash.h"
+
+#define VERTEX_HASH_MIN_SLOTS 64
+
+VertexHash::VertexHash()
+{
+	mask = 0;
+	count = 0;
+	Reserve(0);
+}
+
+VertexHash::~VertexHash()
+{
+}
+
+void VertexHash::Reserve(size_t keyCount)
+{
+	size_t slotNum = VERTEX_HASH_MIN_SLOTS;
+	while (slotNum < keyCount * 2)
+		slotNum <<= 1;
+
+	Slot empty = { 0, 0, 0, -1 };
+	/// assign keeps the memory of a bigger earlier table
+	slots.assign(slotNum, empty);
+	mask = slotNum - 1;
+	count = 0;
+}
+
+uint32_t VertexHash::Hash(int v, int t, int n)
+{
+	/// mix all 96 bits, the indices of neighbouring corners only differ in their low bits
+	uint64_t h = (uint64_t)(uint32_t)v * 0x9E3779B97F4A7C15ull;
+	h ^= (uint64_t)(uint32_t)t * 0xC2B2AE3D27D4EB4Full;
+	h ^= (uint64_t)(uint32_t)n * 0x165667B19E3779F9ull;
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 32;
+	return (uint32_t)h;
+}
+
+int VertexHash::FindOrInsert(int v, int t, int n, int newVertex)
+{
+	size_t idx = Hash(v, t, n) & mask;
+	while (true)
+	{
+		Slot& slot = slots[idx];
+		if (slot.vertex < 0)
+			break;
+		if (slot.v == v && slot.t == t && slot.n == n)
+			return slot.vertex;
+		idx = (idx + 1) & mask;
+	}
+
+	if ((count + 1) * 2 > slots.size())
+	{
+		Grow();
+		return FindOrInsert(v, t, n, newVertex);
+	}
+
+	Slot& slot = slots[idx];
+	slot.v = v;
+	slot.t = t;
+	slot.n = n;
+	slot.vertex = newVertex;
+	count++;
+	return newVertex;
+}
+
+void VertexHash::Grow()
+{
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(slots);
+
+	Slot empty = { 0, 0, 0, -1 };
+	slots.assign(oldSlots.size() * 2, empty);
+	mask = slots.size() - 1;
+	for (size_t i = 0; i < oldSlots.size(); i++)
+	{
+		const Slot& oldSlot = oldSlots[i];
+		if (oldSlot.vertex < 0)
+			continue;
+		size_t idx = Hash(oldSlot.v, oldSlot.t, oldSlot.n) & mask;
+		while (slots[idx].vertex >= 0)
+			idx = (idx + 1) & mask;
+		slots[idx] = oldSlot;
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef __VERTEX_HASH_H__
+#define __VERTEX_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/// (vertex, texcoord, normal) index triple to mesh vertex map for the obj vertex deduplication,
+/// open addressing with linear probing over one flat slot array, the whole triple is compared so distinct triples never merge
+class VertexHash
+{
+public:
+	VertexHash();
+	virtual ~VertexHash();
+
+	/// drops all keys and sizes the table for keyCount keys at half load, it doubles when more keys come in,
+	/// a welded triangle mesh has about half as many vertices as faces, so the face count leaves room for uv and normal seams
+	void Reserve(size_t keyCount);
+
+	/// the vertex of the triple, or newVertex after inserting it
+	int FindOrInsert(int v, int t, int n, int newVertex);
+
+	size_t GetCount() { return count; }
+
+private:
+	struct Slot
+	{
+		int v;
+		int t;
+		int n;
+		int vertex;	/// -1 for an empty slot
+	};
+
+	static uint32_t Hash(int v, int t, int n);
+	void Grow();
+
+private:
+	std::vector<Slot> slots;
+	size_t mask;
+	size_t count;
+};
+
+#endif // !__VERTEX_HASH_H__
@@ -30,24 +30,52 @@ bool SampleScene::OnEnter()
 	///model->SetRotation(rotate);
 	//model->LoadTestData();
 	Renderer* renderer = Application::Inst()->GetRenderer();
-	for (int i = 0; i < MAX_LIGHT_NUM; i++)
+	/// dx12 still shades with a fixed light array
+	int lightNum = SAMPLE_LIGHT_NUM;
+	if (Renderer::GetType() != Renderer::Vulkan && lightNum > MAX_LIGHT_NUM)
+		lightNum = MAX_LIGHT_NUM;
+	for (int i = 0; i < lightNum; i++)
 	{
 		int y = i % 2;
 		int left = i / 2;
 		int z = left % 2;
 		int x = left / 2;
 
-		light[i] = new PointLight();
-		light[i]->SetPosition(glm::vec3(-1200 + 800 * x, 100 + 400 * y, -250 + 500 * z));
-		light[i]->SetColor(glm::vec3(1, 1, 1));
-		light[i]->SetRadius(1000.0f);
-		light[i]->SetAmbientIntensity(0.1f);
-		light[i]->SetDiffuseIntensity(1.0f);
-		light[i]->SetSpecularIntensity(0.2f);
-		light[i]->SetAttenuationConstant(1.0f);
-		light[i]->SetAttenuationLinear(0);
-		light[i]->SetAttenuationExp(0.00001);
-		renderer->AddLight(light[i]);
+		PointLight* light = new PointLight();
+		light->SetPosition(glm::vec3(-1200 + 800 * x, 100 + 400 * y, -250 + 500 * z));
+		light->SetColor(glm::vec3(1, 1, 1));
+		light->SetRadius(1000.0f);
+		light->SetAmbientIntensity(0.1f);
+		light->SetDiffuseIntensity(1.0f);
+		light->SetSpecularIntensity(0.2f);
+		light->SetAttenuationConstant(1.0f);
+		light->SetAttenuationLinear(0);
+		light->SetAttenuationExp(0.00001);
+		renderer->AddLight(light);
+		lights.push_back(light);
+	}
+
+	/// dx12 would shade spot lights as point lights
+	if (Renderer::GetType() == Renderer::Vulkan)
+	{
+		for (int i = 0; i < SAMPLE_SPOT_LIGHT_NUM; i++)
+		{
+			SpotLight* light = new SpotLight();
+			light->SetPosition(glm::vec3(-1250 + 500 * i, 700, 0));
+			light->SetDirection(glm::vec3(0, -1, 0));
+			light->SetInnerAngle(glm::radians(20.0f));
+			light->SetOuterAngle(glm::radians(30.0f));
+			light->SetColor(glm::vec3(1, 0.8f, 0.6f));
+			light->SetRadius(900.0f);
+			light->SetAmbientIntensity(0.1f);
+			light->SetDiffuseIntensity(1.0f);
+			light->SetSpecularIntensity(0.2f);
+			light->SetAttenuationConstant(1.0f);
+			light->SetAttenuationLinear(0);
+			light->SetAttenuationExp(0.00001);
+			renderer->AddLight(light);
+			lights.push_back(light);
+		}
 	}
 
 	return true;
@@ -72,6 +100,9 @@ bool SampleScene::OnUpdate(float dt)
 				vRenderer->SetClusteShading(true);
 				vRenderer->SetCpuClusteCull(false);
 				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(false);
 				shadingMode = ClusteShading_Compute;
 			}
 			else if (shadingMode == ClusteShading_Compute)
@@ -79,20 +110,59 @@ bool SampleScene::OnUpdate(float dt)
 				vRenderer->SetClusteShading(true);
 				vRenderer->SetCpuClusteCull(true);
 				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(false);
 				shadingMode = ClusteShading_RawCpu;
 			}
 			else if (shadingMode == ClusteShading_RawCpu)
+			{
+				vRenderer->SetClusteShading(true);
+				vRenderer->SetCpuClusteCull(true);
+				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(true);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(false);
+				shadingMode = ClusteShading_RawCpuMT;
+			}
+			else if (shadingMode == ClusteShading_RawCpuMT)
+			{
+				vRenderer->SetClusteShading(true);
+				vRenderer->SetCpuClusteCull(true);
+				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(true);
+				vRenderer->SetSimdCull(false);
+				shadingMode = ClusteShading_LightCentric;
+			}
+			else if (shadingMode == ClusteShading_LightCentric)
 			{
 				vRenderer->SetClusteShading(true);
 				vRenderer->SetCpuClusteCull(true);
 				vRenderer->SetISPC(true);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(false);
 				shadingMode = ClusteShading_ISPC;
 			}
 			else if (shadingMode == ClusteShading_ISPC)
+			{
+				vRenderer->SetClusteShading(true);
+				vRenderer->SetCpuClusteCull(true);
+				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(true);
+				shadingMode = ClusteShading_Simd;
+			}
+			else if (shadingMode == ClusteShading_Simd)
 			{
 				vRenderer->SetClusteShading(false);
 				vRenderer->SetCpuClusteCull(false);
 				vRenderer->SetISPC(false);
+				vRenderer->SetMultiThreadCull(false);
+				vRenderer->SetLightCentricCull(false);
+				vRenderer->SetSimdCull(false);
 				shadingMode = NoClusteShading;
 			}
 			vRenderer->ClearLightBufferData();
@@ -102,6 +172,52 @@ bool SampleScene::OnUpdate(float dt)
 			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
 			vRenderer->SetMeshShading(!vRenderer->IsMeshShading());
 		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_G)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetAutoTuneGrid(!vRenderer->IsAutoTuneGrid());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_V)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetValidateCull(!vRenderer->IsValidateCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_I)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetIncrementalCull(!vRenderer->IsIncrementalCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_B)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetDepthBoundsCull(!vRenderer->IsDepthBoundsCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_A)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetActiveCull(!vRenderer->IsActiveCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_P)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetCompactLightList(!vRenderer->IsCompactLightList());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_K)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetBitmaskCull(!vRenderer->IsBitmaskCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_O)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetAsyncCull(!vRenderer->IsAsyncCull());
+		}
+		else if (Application::Inst()->GetPressedKey() == GLFW_KEY_L)
+		{
+			VulkanRenderer* vRenderer = (VulkanRenderer*)Application::Inst()->GetRenderer();
+			vRenderer->SetCullStats(!vRenderer->IsCullStats());
+			vRenderer->SetCullStatsLog(vRenderer->IsCullStatsLog() ? NULL : "cull_stats.csv");
+		}
 	}
 
 	return true;
@@ -167,9 +283,9 @@ void SampleScene::OnExit()
 		delete model;
 	}
 
-	for (int i = 0; i < MAX_LIGHT_NUM; i++)
+	for (int i = 0; i < lights.size(); i++)
 	{
-		if (light[i] != NULL)
-			delete light[i];
+		delete lights[i];
 	}
+	lights.clear();
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
 #ifndef __SAMPLE_SCENE_H__
 #define __SAMPLE_SCENE_H__
 
+#include <vector>
+
 #include "Scene.h"
 
+#define SAMPLE_LIGHT_NUM 16
+#define SAMPLE_SPOT_LIGHT_NUM 6	/// vulkan only, down the nave
+
 class Camera;
 class TOModel;
 class PointLight;
@@ -13,7 +18,10 @@ class SampleScene : public Scene
 		NoClusteShading,
 		ClusteShading_Compute,
 		ClusteShading_RawCpu,
+		ClusteShading_RawCpuMT,
+		ClusteShading_LightCentric,
 		ClusteShading_ISPC,
+		ClusteShading_Simd,
 	};
 public:
 	SampleScene();
@@ -35,7 +43,7 @@ private:
 	TOModel* model;
 	int last_control_state;
 
-	PointLight* light[MAX_LIGHT_NUM];
+	std::vector<PointLight*> lights;
 
 	ShadingMode shadingMode;
 };
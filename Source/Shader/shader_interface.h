@@ -0,0 +1,14 @@
+/*
+	Shader interface version, included by the renderers and by the glsl and hlsl shaders,
+	guarded on the version itself since glsl reserves names with two underscores
+*/
+
+#ifndef SHADER_INTERFACE_VERSION
+
+/// bump on any change of TransformData, the bindings or the light list formats,
+/// the renderers refuse shader binaries built with another version
+#define SHADER_INTERFACE_VERSION 1
+/// specialization constant holding the version in the spir-v
+#define SHADER_INTERFACE_CONSTANT_ID 0
+
+#endif // !SHADER_INTERFACE_VERSION
@@ -1,10 +1,40 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
-#define MAX_LIGHT_NUM 16
+#extension GL_GOOGLE_include_directive : enable
+#include "shader_interface.h"
+/// the renderer reads the default back from the spir-v and refuses a binary of another version
+layout(constant_id = SHADER_INTERFACE_CONSTANT_ID) const uint interfaceVersion = SHADER_INTERFACE_VERSION;
 
-struct LightGrid{
-    uint offset;
-    uint count;
+struct PointLight{
+    vec3 pos;
+	float radius;
+	vec3 color;
+    uint enabled;
+    float ambient_intensity;
+	float diffuse_intensity;
+	float specular_intensity;
+    float attenuation_constant;
+	float attenuation_linear;
+	float attenuation_exp;
+    vec2 padding;
+};
+
+/// LightShape type, must match ClusteLightType in ClusteData.h
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+#define LIGHT_TYPE_AREA 2
+
+struct LightShape{
+    vec3 boundCenter;
+    float boundRadius;
+    vec3 direction;
+    uint type;
+    vec3 tangent;
+    float spotCosOuter;
+    float spotCosInner;
+    float areaHalfWidth;
+    float areaHalfHeight;
+    float padding;
 };
 
 layout (std140, binding = 0, set = 0) uniform TransformData {
@@ -20,7 +50,10 @@ layout (std140, binding = 0, set = 0) uniform TransformData {
     float zFar;
     float scale;
     float bias;
-    vec4 light_pos[MAX_LIGHT_NUM];
+    mat4 world_model;
+    uint light_count;
+    uint lightListFormat;
+    uint lightMaskWords;
 } transform;
 
 layout(std140, binding = 1, set = 0) uniform MaterialData
@@ -29,37 +62,41 @@ layout(std140, binding = 1, set = 0) uniform MaterialData
     int has_normal_map;
 } material;
 
-layout(std140, binding = 2, set = 0) uniform PointLightData
-{
-    vec3 pos;
-	float radius;
-	vec3 color;
-    uint enabled;
-    float ambient_intensity;
-	float diffuse_intensity;
-	float specular_intensity;
-    float attenuation_constant;
-	float attenuation_linear;
-	float attenuation_exp;
-    vec2 padding;
-} pointLight[MAX_LIGHT_NUM];
+layout (std430, binding = 2, set = 0) readonly buffer lightSSBO{
+    PointLight pointLight[];
+};
+
+/// lightListFormat, compact lists hold two 16-bit light indices per uint and one packed offset/count per cluste,
+/// bitmasks hold lightMaskWords uints per cluste in the index buffer
+#define LIGHT_FORMAT_LIST 0
+#define LIGHT_FORMAT_COMPACT 1
+#define LIGHT_FORMAT_BITMASK 2
+#define PACKED_OFFSET_BITS 20
+#define PACKED_OFFSET_MASK 0xfffff
 
 layout (std430, binding = 3, set = 0) readonly buffer lightIndexSSBO{
     uint globalLightIndexList[];
 };
 layout (std430, binding = 4, set = 0) readonly buffer lightGridSSBO{
-    LightGrid lightGrid[];
+    uint lightGrid[];   /// offset, count pairs
 };
 
 layout(binding = 5, set = 0) uniform sampler2D albedoSampler;
 layout(binding = 6, set = 0) uniform sampler2D normalSampler;
 
+layout (std430, binding = 7, set = 0) readonly buffer lightShapeSSBO{
+    LightShape lightShape[];
+};
+
 layout (location = 0) in Interpolants {
     vec3 fragColor;
     vec3 fragTexCoord;
     vec3 fragPos;
     vec3 tanViewPos;
-    vec3 tanLightPos[16];
+    vec3 objPos;
+    vec3 tangent;
+    vec3 bitangent;
+    vec3 normal;
 } IN;
 
 layout(location = 0) out vec4 outColor;
@@ -73,6 +110,9 @@ float linearDepth(float depthSample){
 vec3 lightingColor(uint i);
 
 void main() {
+    /// never taken, keeps an optimized build from dropping the version constant
+    if (interfaceVersion != SHADER_INTERFACE_VERSION)
+        return;
     outColor = vec4(0,0,0,1);
 
     if(transform.isClusteShading)
@@ -86,11 +126,47 @@ void main() {
         ///outColor.xyz = vec3(color, color, color);
         ///return;
 
-        uint offset = lightGrid[tileIndex].offset;
-        uint visibleLightCount = lightGrid[tileIndex].count;
+        if (transform.lightListFormat == LIGHT_FORMAT_BITMASK)
+        {
+            uint maskBase = tileIndex * transform.lightMaskWords;
+            for(uint word = 0; word < transform.lightMaskWords; word++)
+            {
+                uint bits = globalLightIndexList[maskBase + word];
+                while(bits != 0)
+                {
+                    int bit = findLSB(bits);
+                    bits &= bits - 1;
+                    outColor.xyz += lightingColor(word * 32 + uint(bit));
+                }
+            }
+            return;
+        }
+
+        uint offset;
+        uint visibleLightCount;
+        if (transform.lightListFormat == LIGHT_FORMAT_COMPACT)
+        {
+            uint packed = lightGrid[tileIndex];
+            offset = packed & PACKED_OFFSET_MASK;
+            visibleLightCount = packed >> PACKED_OFFSET_BITS;
+        }
+        else
+        {
+            offset = lightGrid[tileIndex * 2];
+            visibleLightCount = lightGrid[tileIndex * 2 + 1];
+        }
         for(int idx = 0; idx < visibleLightCount; idx++)
         {
-            uint i = globalLightIndexList[offset + idx];
+            uint i;
+            if (transform.lightListFormat == LIGHT_FORMAT_COMPACT)
+            {
+                uint slot = offset + idx;
+                i = (globalLightIndexList[slot >> 1] >> ((slot & 1) * 16)) & 0xffff;
+            }
+            else
+            {
+                i = globalLightIndexList[offset + idx];
+            }
 
             // final color
             outColor.xyz += lightingColor(i);
@@ -98,8 +174,12 @@ void main() {
     }
     else
     {
-        for(int i = 0; i < MAX_LIGHT_NUM; i++)
+        for(uint i = 0; i < transform.light_count; i++)
         {
+            // removed lights stay in the buffer disabled, the culls already skip them
+            if(pointLight[i].enabled == 0)
+                continue;
+
             // final color
             outColor.xyz += lightingColor(i);
         }
@@ -108,6 +188,26 @@ void main() {
 
 vec3 lightingColor(uint i)
 {
+    // light position, an area light shades from the point of its rectangle nearest to the fragment
+    LightShape shape = lightShape[i];
+    vec3 lightPos = pointLight[i].pos;
+    float shapeFactor = 1.0;
+    if (shape.type == LIGHT_TYPE_SPOT)
+    {
+        float cosAngle = dot(normalize(IN.fragPos - lightPos), shape.direction);
+        shapeFactor = smoothstep(shape.spotCosOuter, max(shape.spotCosInner, shape.spotCosOuter + 0.0001), cosAngle);
+    }
+    else if (shape.type == LIGHT_TYPE_AREA)
+    {
+        vec3 d = IN.fragPos - lightPos;
+        if (dot(d, shape.direction) < 0.0)
+        {
+            return vec3(0.0);
+        }
+        vec3 bitangent = cross(shape.direction, shape.tangent);
+        lightPos += shape.tangent * clamp(dot(d, shape.tangent), -shape.areaHalfWidth, shape.areaHalfWidth);
+        lightPos += bitangent * clamp(dot(d, bitangent), -shape.areaHalfHeight, shape.areaHalfHeight);
+    }
     // diffuse
     vec3 albedo;
     if (material.has_albedo_map > 0)
@@ -132,7 +232,8 @@ vec3 lightingColor(uint i)
         normal = vec3(0, 0, 1);
     }
     // diffuse
-    vec3 lightDir = normalize(IN.tanLightPos[i]);
+    vec3 l = vec3(vec4(lightPos, 1.0) * transform.world_model) - IN.objPos;
+    vec3 lightDir = normalize(vec3(dot(IN.tangent, l), dot(IN.bitangent, l), dot(IN.normal, l)));
     float lambertian = max(dot(lightDir, normal), 0.0);
     vec3 diffuse = pointLight[i].diffuse_intensity * albedo * lambertian * pointLight[i].color;
     // specular
@@ -142,9 +243,9 @@ vec3 lightingColor(uint i)
     float spec = pow(specAngle, 32);
     vec3 specular = pointLight[i].specular_intensity * spec * pointLight[i].color;
     // attenuation
-    float distance    = length(pointLight[i].pos - IN.fragPos);
+    float distance    = length(lightPos - IN.fragPos);
     ///float attenuation = 1.0 / (pointLight[i].attenuation_constant + pointLight[i].attenuation_linear * distance + pointLight[i].attenuation_exp * (distance * distance)); 
-    float attenuation = pow(smoothstep(pointLight[i].radius, 0, distance), 2);
+    float attenuation = pow(smoothstep(pointLight[i].radius, 0, distance), 2) * shapeFactor;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
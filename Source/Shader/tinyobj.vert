@@ -1,6 +1,9 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
-#define MAX_LIGHT_NUM 16
+#extension GL_GOOGLE_include_directive : enable
+#include "shader_interface.h"
+/// the renderer reads the default back from the spir-v and refuses a binary of another version
+layout(constant_id = SHADER_INTERFACE_CONSTANT_ID) const uint interfaceVersion = SHADER_INTERFACE_VERSION;
 layout (std140, binding = 0, set = 0) uniform TransformData {
     mat4 mvp;
     mat4 model;
@@ -14,7 +17,10 @@ layout (std140, binding = 0, set = 0) uniform TransformData {
     float zFar;
     float scale;
     float bias;
-    vec4 light_pos[MAX_LIGHT_NUM];
+    mat4 world_model;
+    uint light_count;
+    uint lightListFormat;
+    uint lightMaskWords;
 } transform;
 
 layout(std140, binding = 1, set = 0) uniform MaterialData
@@ -23,21 +29,6 @@ layout(std140, binding = 1, set = 0) uniform MaterialData
     int has_normal_map;
 } material;
 
-layout(std140, binding = 2, set = 0) uniform PointLightData
-{
-    vec3 pos;
-	float radius;
-	vec3 color;
-    uint enabled;
-    float ambient_intensity;
-	float diffuse_intensity;
-	float specular_intensity;
-    float attenuation_constant;
-	float attenuation_linear;
-	float attenuation_exp;
-    vec2 padding;
-} pointLight[MAX_LIGHT_NUM];
-
 layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec4 inColor;
 layout(location = 2) in vec4 inTexcoord;
@@ -49,21 +40,28 @@ layout (location = 0) out Interpolants {
     vec3 fragTexCoord;
     vec3 fragPos;
     vec3 tanViewPos;
-    vec3 tanLightPos[16];
+    vec3 objPos;
+    vec3 tangent;
+    vec3 bitangent;
+    vec3 normal;
 } OUT;
 
 void main() {
+    /// never taken, keeps an optimized build from dropping the version constant
+    if (interfaceVersion != SHADER_INTERFACE_VERSION)
+        return;
     gl_Position = transform.mvp * inPosition;
     OUT.fragColor = vec3(inColor);
     OUT.fragTexCoord = vec3(inTexcoord);
     OUT.fragPos = vec3(transform.model * inPosition);
 
-    vec3 bitangent = cross(vec3(inNormal), vec3(inTangent));
+    vec3 bitangent = inTangent.w * cross(vec3(inNormal), vec3(inTangent));
 	vec3 v =  transform.cam_pos - vec3(inPosition);
     OUT.tanViewPos  = vec3(dot(vec3(inTangent), v), dot(bitangent, v), dot(vec3(inNormal), v));
-    for(int i = 0; i < MAX_LIGHT_NUM; i++)
-    {
-        vec3 l = vec3(transform.light_pos[i] - inPosition);
-        OUT.tanLightPos[i] = vec3(dot(vec3(inTangent), l), dot(bitangent, l), dot(vec3(inNormal), l));
-    }
+
+    /// light count is unbounded, the tangent space light direction is built per fragment
+    OUT.objPos = vec3(inPosition);
+    OUT.tangent = vec3(inTangent);
+    OUT.bitangent = bitangent;
+    OUT.normal = vec3(inNormal);
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 cbuffer Transform : register(b0)
 {
     TransformData transform;
+    /// never read, the renderer reads the default back from the reflection and refuses a binary of another version
+    uint interfaceVersion = SHADER_INTERFACE_VERSION;
 }
 
 cbuffer PointLights : register(b1)
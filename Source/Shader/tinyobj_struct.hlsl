@@ -8,6 +8,8 @@
 // PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
 //
 //*********************************************************
+#include "shader_interface.h"
+
 #define MAX_LIGHT_NUM 16
 struct TransformData
 {
@@ -23,6 +25,11 @@ struct TransformData
     float zFar;
     float scale;
     float bias;
+    matrix world_model;
+    uint light_count;
+    uint lightListFormat;
+    uint lightMaskWords;
+    uint light_padding;
     vector light_pos[MAX_LIGHT_NUM];
 };
 
@@ -13,6 +13,8 @@
 cbuffer Transform : register(b0)
 {
     TransformData transform;
+    /// never read, the renderer reads the default back from the reflection and refuses a binary of another version
+    uint interfaceVersion = SHADER_INTERFACE_VERSION;
 }
 
 cbuffer PointLights : register(b1)
@@ -29,7 +31,7 @@ PSInput VSMain(float4 inPosition : POSITION, float4 inColor : COLOR, float4 inTe
     OUT.fragTexCoord = inTexcoord.xyz;
     OUT.fragPos = mul(transform.model, inPosition).xyz;
 
-    float3 bitangent = cross(inNormal.xyz, inTangent.xyz);
+    float3 bitangent = inTangent.w * cross(inNormal.xyz, inTangent.xyz);
     float3 v = transform.cam_pos - inPosition.xyz;
     OUT.tanViewPos = float3(dot(inTangent.xyz, v), dot(bitangent, v), dot(inNormal.xyz, v));
     for (int i = 0; i < MAX_LIGHT_NUM; i++)
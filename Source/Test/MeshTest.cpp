@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Common/ThreadPool.h"
+#include "Renderer/MeshAsset.h"
+#include "Renderer/MeshCache.h"
+#include "Renderer/ObjLoader.h"
+#include "Renderer/VertexHash.h"
+
+/// checks of the platform independent mesh path, ObjLoader against tinyobj, VertexHash, MeshBuilder and MeshCache,
+/// no window, gpu or ispc needed, the test obj is written into the working directory
+/// usage: MeshTest [file.obj]	a given obj is checked against tinyobj too, without it only the generated one
+
+static int fail_count = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond); fail_count++; } } while (0)
+
+typedef std::tuple<int, int, int> IndexTriple;
+
+static bool WriteText(const std::string& path, const char* text)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	fputs(text, file);
+	fclose(file);
+	return true;
+}
+
+/// two objects, quads and a pentagon to triangulate, shared positions with texcoord and normal seams, two materials
+static bool WriteTestObj(const std::string& objPath, const std::string& mtlPath)
+{
+	const char* mtl =
+		"newmtl red\n"
+		"Kd 1 0 0\n"
+		"map_Kd red.png\n"
+		"newmtl blue\n"
+		"Kd 0 0 1\n"
+		"map_bump blue_n.png\n";
+	const char* obj =
+		"mtllib mesh_test.mtl\n"
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\nv 0.5 1.5 0.5\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvt 0.5 0.5\n"
+		"vn 0 0 -1\nvn 0 0 1\nvn 0 -1 0\nvn 0 1 0\nvn 1 0 0\nvn -1 0 0\n"
+		"o box\n"
+		"usemtl red\n"
+		"f 1/1/1 4/4/1 3/3/1 2/2/1\n"
+		"f 5/1/2 6/2/2 7/3/2 8/4/2\n"
+		"f 1/1/3 2/2/3 6/3/3 5/4/3\n"
+		"usemtl blue\n"
+		"f 2/1/5 3/2/5 7/3/5 6/4/5\n"
+		"f 1/1/6 5/2/6 8/3/6 4/4/6\n"
+		"usemtl red\n"
+		"f 4/1/4 8/2/4 7/3/4 3/4/4\n"
+		"o roof\n"
+		"usemtl blue\n"
+		"f 4/1/4 3/2/4 9/5/4 8/4/4 7/3/4\n"
+		"f 4/1 9/5 3/2\n";
+	return WriteText(mtlPath, mtl) && WriteText(objPath, obj);
+}
+
+/// the obj corner as the builder lays it out, texcoord v flipped, missing texcoords and normals are zeros
+static bool IsCornerVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx, const Vertex& vertex)
+{
+	int v = idx.vertex_index;
+	bool isSame = vertex.pos.x == attrib.vertices[v * 3 + 0] && vertex.pos.y == attrib.vertices[v * 3 + 1] && vertex.pos.z == attrib.vertices[v * 3 + 2];
+	int t = idx.texcoord_index;
+	if (t >= 0)
+		isSame = isSame && vertex.texcoord.x == attrib.texcoords[t * 2 + 0] && vertex.texcoord.y == 1.0f - attrib.texcoords[t * 2 + 1];
+	else
+		isSame = isSame && vertex.texcoord.x == 0.0f && vertex.texcoord.y == 0.0f;
+	int n = idx.normal_index;
+	if (n >= 0)
+		isSame = isSame && vertex.normal.x == attrib.normals[n * 3 + 0] && vertex.normal.y == attrib.normals[n * 3 + 1] && vertex.normal.z == attrib.normals[n * 3 + 2];
+	else
+		isSame = isSame && vertex.normal.x == 0.0f && vertex.normal.y == 0.0f && vertex.normal.z == 0.0f;
+	return isSame;
+}
+
+/// the parallel loader has to give what a triangulating tinyobj::LoadObj gives
+static void CheckLoader(const std::string& objPath, const std::string& basePath, ThreadPool* pool, tinyobj::attrib_t& attrib,
+	std::vector<tinyobj::shape_t>& shapes, std::vector<tinyobj::material_t>& materials, std::vector<std::string>& mtlPaths)
+{
+	tinyobj::attrib_t refAttrib;
+	std::vector<tinyobj::shape_t> refShapes;
+	std::vector<tinyobj::material_t> refMaterials;
+	std::string warn, err;
+	CHECK(tinyobj::LoadObj(&refAttrib, &refShapes, &refMaterials, &warn, &err, objPath.c_str(), (basePath + "/").c_str(), true));
+
+	ObjLoader loader(pool);
+	CHECK(loader.Load(objPath, basePath, attrib, shapes, materials, warn, err));
+	mtlPaths = loader.GetMtlPaths();
+
+	CHECK(attrib.vertices == refAttrib.vertices);
+	CHECK(attrib.texcoords == refAttrib.texcoords);
+	CHECK(attrib.normals == refAttrib.normals);
+	CHECK(materials.size() == refMaterials.size());
+	for (size_t i = 0; i < materials.size() && i < refMaterials.size(); i++)
+		CHECK(materials[i].name == refMaterials[i].name && materials[i].diffuse_texname == refMaterials[i].diffuse_texname);
+
+	CHECK(shapes.size() == refShapes.size());
+	for (size_t i = 0; i < shapes.size() && i < refShapes.size(); i++)
+	{
+		const tinyobj::mesh_t& mesh = shapes[i].mesh;
+		const tinyobj::mesh_t& refMesh = refShapes[i].mesh;
+		CHECK(shapes[i].name == refShapes[i].name);
+		CHECK(mesh.indices.size() == refMesh.indices.size());
+		for (size_t j = 0; j < mesh.indices.size() && j < refMesh.indices.size(); j++)
+		{
+			CHECK(mesh.indices[j].vertex_index == refMesh.indices[j].vertex_index && mesh.indices[j].texcoord_index == refMesh.indices[j].texcoord_index &&
+				mesh.indices[j].normal_index == refMesh.indices[j].normal_index);
+		}
+		CHECK(mesh.material_ids == refMesh.material_ids);
+		CHECK(mesh.num_face_vertices == refMesh.num_face_vertices);
+	}
+}
+
+/// every distinct (v, t, n) triple gets one vertex, the same triple always the same one
+static void CheckVertexHash(const std::vector<tinyobj::shape_t>& shapes)
+{
+	for (size_t i = 0; i < shapes.size(); i++)
+	{
+		const std::vector<tinyobj::index_t>& indices = shapes[i].mesh.indices;
+		std::map<IndexTriple, int> refVertexs;
+		VertexHash hash;
+		hash.Reserve(1);	/// small on purpose, it has to grow
+		for (size_t j = 0; j < indices.size(); j++)
+		{
+			IndexTriple key(indices[j].vertex_index, indices[j].texcoord_index, indices[j].normal_index);
+			int newVertex = (int)refVertexs.size();
+			int vertex = hash.FindOrInsert(indices[j].vertex_index, indices[j].texcoord_index, indices[j].normal_index, newVertex);
+			std::map<IndexTriple, int>::iterator it = refVertexs.find(key);
+			if (it == refVertexs.end())
+			{
+				CHECK(vertex == newVertex);
+				refVertexs[key] = vertex;
+			}
+			else
+				CHECK(vertex == it->second);
+		}
+		CHECK(hash.GetCount() == refVertexs.size());
+	}
+}
+
+/// triples that differ in one index only, dense enough that they share probe chains, inserted twice while the table grows
+static void CheckVertexHashCollisions()
+{
+	VertexHash hash;
+	hash.Reserve(1);
+	int keyNum = 0;
+	for (int round = 0; round < 2; round++)
+	{
+		int vertex = 0;
+		for (int v = 0; v < 16; v++)
+			for (int t = -1; t < 15; t++)
+				for (int n = -1; n < 15; n++, vertex++)
+					CHECK(hash.FindOrInsert(v, t, n, keyNum) == (round == 0 ? keyNum++ : vertex));
+	}
+	CHECK(keyNum == 16 * 16 * 16 && hash.GetCount() == (size_t)keyNum);
+}
+
+/// the built corners point at the vertex of their tinyobj corner, sub meshes follow the materials, meshlets map back to the corners
+static void CheckBuilder(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, bool isFlipWinding, bool isMeshlet,
+	const std::vector<MeshAsset>& assets)
+{
+	CHECK(assets.size() == shapes.size());
+	for (size_t i = 0; i < assets.size() && i < shapes.size(); i++)
+	{
+		const tinyobj::mesh_t& mesh = shapes[i].mesh;
+		const MeshAsset& asset = assets[i];
+		CHECK(asset.indices.size() == mesh.indices.size());
+
+		std::set<IndexTriple> triples;
+		for (size_t j = 0; j < mesh.indices.size(); j++)
+			triples.insert(IndexTriple(mesh.indices[j].vertex_index, mesh.indices[j].texcoord_index, mesh.indices[j].normal_index));
+		/// tangent seams may split a few more
+		CHECK(asset.vertexs.size() >= triples.size());
+
+		for (size_t j = 0; j < asset.indices.size() && j < mesh.indices.size(); j++)
+		{
+			size_t k = j % 3;
+			size_t corner = j - k + ((isFlipWinding && k != 0) ? 3 - k : k);
+			CHECK(asset.indices[j] >= 0 && asset.indices[j] < (int)asset.vertexs.size());
+			if (asset.indices[j] >= 0 && asset.indices[j] < (int)asset.vertexs.size())
+				CHECK(IsCornerVertex(attrib, mesh.indices[corner], asset.vertexs[asset.indices[j]]));
+		}
+
+		int indexEnd = 0;
+		for (size_t k = 0; k < asset.subMeshes.size(); k++)
+		{
+			const SubMeshRange& subMesh = asset.subMeshes[k];
+			CHECK(subMesh.indexStart == indexEnd && subMesh.indexCount > 0);
+			for (int j = subMesh.indexStart / 3; j < (subMesh.indexStart + subMesh.indexCount) / 3; j++)
+				CHECK(mesh.material_ids[j] == subMesh.mid);
+			indexEnd += subMesh.indexCount;
+		}
+		CHECK(indexEnd == (int)asset.indices.size());
+
+		CHECK(asset.meshlets.size() == (isMeshlet ? asset.subMeshes.size() : 0));
+		for (size_t k = 0; k < asset.meshlets.size(); k++)
+		{
+			const MeshletData& data = asset.meshlets[k];
+			const SubMeshRange& subMesh = asset.subMeshes[k];
+			int corner = subMesh.indexStart;
+			for (size_t m = 0; m < data.meshlets.size(); m++)
+			{
+				const Meshlet& meshlet = data.meshlets[m];
+				CHECK(meshlet.vertexCount <= MAX_MESH_SHADER_VERTICES);
+				for (glm::uint p = 0; p < meshlet.primCount; p++, corner++)
+				{
+					uint32_t local = data.primitiveIndices[meshlet.primBegin + p];
+					CHECK(local < meshlet.vertexCount);
+					CHECK((int)data.vertexIndices[meshlet.vertexBegin + local] == asset.indices[corner]);
+				}
+			}
+			CHECK(corner == subMesh.indexStart + subMesh.indexCount);
+		}
+	}
+}
+
+/// what is baked comes back unchanged from the file, other options or a changed obj reject the cache
+static void CheckCache(const std::string& objPath, const std::vector<std::string>& mtlPaths, const std::vector<MeshAsset>& assets,
+	const std::vector<tinyobj::material_t>& materials, bool isFlipWinding, bool isMeshlet)
+{
+	std::string cachePath = MeshCache::GetPath(objPath, isFlipWinding, isMeshlet);
+	{
+		MeshCache baked;
+		baked.Bake(objPath, mtlPaths, assets, materials, isFlipWinding, isMeshlet);
+		CHECK(baked.Write(cachePath));
+	}
+
+	MeshCache cache;
+	CHECK(cache.Open(cachePath, objPath, isFlipWinding, isMeshlet));
+	CHECK(!MeshCache().Open(cachePath, objPath, !isFlipWinding, isMeshlet));
+	CHECK(!MeshCache().Open(cachePath, objPath, isFlipWinding, !isMeshlet));
+
+	int m = 0;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const MeshAsset& asset = assets[i];
+		if (asset.vertexs.empty())
+			continue;
+		if (m >= cache.GetMeshCount())
+		{
+			CHECK(m < cache.GetMeshCount());
+			break;
+		}
+		const MeshCache::MeshRecord& mesh = cache.GetMesh(m++);
+		CHECK(mesh.vertexCount == asset.vertexs.size() && memcmp(cache.GetVertexs(mesh), asset.vertexs.data(), asset.vertexs.size() * sizeof(Vertex)) == 0);
+		CHECK(mesh.indexCount == asset.indices.size() && memcmp(cache.GetIndices(mesh), asset.indices.data(), asset.indices.size() * sizeof(int)) == 0);
+		CHECK(memcmp(mesh.boundMin, &asset.boundMin, sizeof(mesh.boundMin)) == 0 && memcmp(mesh.boundMax, &asset.boundMax, sizeof(mesh.boundMax)) == 0);
+		CHECK(mesh.subMeshCount == asset.subMeshes.size());
+		for (size_t k = 0; k < asset.subMeshes.size() && k < mesh.subMeshCount; k++)
+		{
+			const MeshCache::SubMeshRecord& subMesh = cache.GetSubMeshes(mesh)[k];
+			CHECK(subMesh.indexStart == asset.subMeshes[k].indexStart && subMesh.indexCount == asset.subMeshes[k].indexCount && subMesh.mid == asset.subMeshes[k].mid);
+			if (!isMeshlet)
+			{
+				CHECK(subMesh.meshletCount == 0);
+				continue;
+			}
+			const MeshletData& data = asset.meshlets[k];
+			CHECK(subMesh.meshletCount == data.meshlets.size() && memcmp(cache.GetMeshlets(subMesh), data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet)) == 0);
+			CHECK(subMesh.vertexIndexCount == data.vertexIndices.size() &&
+				memcmp(cache.GetMeshletVertexIndices(subMesh), data.vertexIndices.data(), data.vertexIndices.size() * sizeof(uint32_t)) == 0);
+			CHECK(subMesh.primitiveIndexCount == data.primitiveIndices.size() &&
+				memcmp(cache.GetMeshletPrimitiveIndices(subMesh), data.primitiveIndices.data(), data.primitiveIndices.size() * sizeof(uint32_t)) == 0);
+		}
+	}
+	CHECK(m == cache.GetMeshCount());
+
+	std::vector<tinyobj::material_t> cachedMaterials;
+	cache.GetMaterials(cachedMaterials);
+	CHECK(cachedMaterials.size() == materials.size());
+	for (size_t i = 0; i < cachedMaterials.size() && i < materials.size(); i++)
+	{
+		CHECK(cachedMaterials[i].name == materials[i].name && cachedMaterials[i].diffuse_texname == materials[i].diffuse_texname &&
+			cachedMaterials[i].bump_texname == materials[i].bump_texname && memcmp(cachedMaterials[i].diffuse, materials[i].diffuse, sizeof(materials[i].diffuse)) == 0);
+	}
+}
+
+static void CheckObj(const std::string& objPath, ThreadPool* pool)
+{
+	std::string basePath = ".";
+	size_t slashIdx = objPath.find_last_of("/");
+	if (slashIdx != std::string::npos)
+		basePath = objPath.substr(0, slashIdx);
+
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::vector<std::string> mtlPaths;
+	CheckLoader(objPath, basePath, pool, attrib, shapes, materials, mtlPaths);
+	CheckVertexHash(shapes);
+
+	for (int option = 0; option < 4; option++)
+	{
+		bool isFlipWinding = (option & 1) != 0;
+		bool isMeshlet = (option & 2) != 0;
+		std::vector<MeshAsset> assets;
+		MeshBuilder::BuildShapes(pool, attrib, shapes, isFlipWinding, isMeshlet, assets);
+		CheckBuilder(attrib, shapes, isFlipWinding, isMeshlet, assets);
+		CheckCache(objPath, mtlPaths, assets, materials, isFlipWinding, isMeshlet);
+	}
+	printf("%s: %zu shapes, %zu materials checked\n", objPath.c_str(), shapes.size(), materials.size());
+}
+
+/// the cache of the generated obj goes stale when the obj changes
+static void CheckStaleCache(const std::string& objPath)
+{
+	std::string cachePath = MeshCache::GetPath(objPath, false, false);
+	CHECK(MeshCache().Open(cachePath, objPath, false, false));
+	FILE* file = fopen(objPath.c_str(), "ab");
+	CHECK(file != NULL);
+	if (file == NULL)
+		return;
+	fputs("# changed\n", file);
+	fclose(file);
+	CHECK(!MeshCache().Open(cachePath, objPath, false, false));
+}
+
+int main(int argc, char* argv[])
+{
+	ThreadPool pool;
+
+	std::string objPath = "mesh_test.obj";
+	if (!WriteTestObj(objPath, "mesh_test.mtl"))
+	{
+		fprintf(stderr, "failed to write %s\n", objPath.c_str());
+		return 1;
+	}
+	CheckVertexHashCollisions();
+	CheckObj(objPath, &pool);
+	CheckStaleCache(objPath);
+
+	for (int i = 1; i < argc; i++)
+		CheckObj(argv[i], &pool);
+
+	printf("%d checks failed\n", fail_count);
+	return fail_count == 0 ? 0 : 1;
+}